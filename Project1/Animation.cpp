@@ -1,12 +1,15 @@
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
 #include "Animation.h"
-#include "SceneObject.h"
+
+const double Animation::STEP = 0.010;
+
+static const double TWO_PI = 6.283185307179586;
 
 Animation::Animation(const AnimationRepeat& repeat) {
 	m_Repeating = repeat;
-	m_CurrentStage = 0;
-	m_CurrentStep = 0;
-	m_PrevStage = 0;
-	m_ReverseRepeatForward = false;
 }
 
 /*
@@ -15,95 +18,231 @@ Adds an animation stage to the vector of stages
 */
 void Animation::AddStage(const AnimationStage& stage) {
 	m_Stages.push_back(stage);
+	m_Compiled = false;
+}
+
+/*
+Sets how the position is interpolated between the ends of the stages, rotations and scales always follow the stage exactly
+@param interpolation - The interpolation
+*/
+void Animation::SetInterpolation(AnimationInterpolation interpolation) {
+	m_Interpolation = interpolation;
 }
 
 /*
-Handles the animation logic for the provided object.
-1. Gets the current stage and resets the translate cache if the last stage ended.
-2. Applies the transformation based on the animation type of the current stage
-3. Determines what the next stage should be based on the repeat, or clears the animation if AnimationRepeat::NO_REPEAT was specified
-@param object - A pointer to the object to animate
+Turns the stages into tracks of keys that can be evaluated at any time, starting from the given state of the object.
+The first pass starts where the object is, every pass after it starts where the previous one ended, so repeating animations only need the first two passes
+@param model - The model matrix of the object
+@param position - The absolute position of the object
+@param rotation - The absolute rotation of the object in degrees
+@param startTime - The time in seconds the animation starts at, the first step is done at startTime + STEP
 */
-void Animation::Animate(SceneObject* object) {
-	AnimationStage stage = m_Stages.at(m_CurrentStage);
+void Animation::Compile(const glm::mat4& model, const glm::vec3& position, const glm::vec3& rotation, double startTime) {
+	m_StartTime = startTime;
+	m_Base = glm::translate(glm::mat4(1.0f), -position) * model;
+	m_StartDegrees = rotation;
+
+	std::vector<int> pass = GetPass();
+	m_Intro = BuildTrack(pass, position);
+	if (m_Repeating != AnimationRepeat::NO_REPEAT) {
+		m_Loop = BuildTrack(pass, m_Intro.Keys.back().Position);
+		const AnimationKey& end = m_Loop.Keys.back();
+		m_LoopTranslation = end.Position - m_Loop.Keys.front().Position;
+		m_LoopScale = end.Scale;
+		m_LoopDegrees = end.Degrees;
 
-	// Reset translation cache
-	if (m_CurrentStage != m_PrevStage) {
-		m_TranslationCache = glm::vec3(-100);
-		m_PrevStage = m_CurrentStage;
+		// The rotation of a pass as an angle around an axis, so it can be raised to the number of passes.
+		// A pass that turns full circles comes back slightly off due to rounding, it is snapped shut so it can't drift over time
+		glm::quat q = end.Rotation;
+		if (q.w < 0)
+			q = -q;
+		double sinHalf = std::sqrt((double)q.x * q.x + (double)q.y * q.y + (double)q.z * q.z);
+		double angle = 2.0 * std::atan2(sinHalf, (double)q.w);
+		m_LoopAngle = 0;
+		if (angle > 1e-4) {
+			m_LoopAxis = glm::vec3(q.x, q.y, q.z) * (float)(1.0 / sinHalf);
+			m_LoopAngle = angle;
+		}
 	}
+	m_Compiled = true;
+}
 
-	// Apply transformation
-	ApplyTransformation(object, stage);
+/*
+@returns If the animation was compiled since the last stage was added
+*/
+bool Animation::IsCompiled() const {
+	return m_Compiled;
+}
+
+/*
+@param time - The time in seconds
+@returns If an AnimationRepeat::NO_REPEAT animation is done at the given time, repeating animations are never done
+*/
+bool Animation::IsFinished(double time) const {
+	return m_Repeating == AnimationRepeat::NO_REPEAT && (time - m_StartTime) / STEP >= m_Intro.Duration;
+}
 
-	m_CurrentStep++;
+/*
+Evaluates the animation at the given time, without depending on any earlier evaluation.
+Translations are absolute, rotations and scales are applied on top of the model matrix the animation started with
+@param time - The time in seconds, must be after the time Compile was called with
+@param model - Set to the model matrix at the given time
+@param position - Set to the absolute position at the given time
+@param rotation - Set to the absolute rotation in degrees at the given time
+*/
+void Animation::Evaluate(double time, glm::mat4& model, glm::vec3& position, glm::vec3& rotation) const {
+	double step = std::max((time - m_StartTime) / STEP, 0.0);
+
+	glm::quat relativeRotation;
+	glm::vec3 relativeScale, relativeDegrees;
+	glm::quat baseRotation(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 baseScale(1.0f);
+	double baseDegrees[3] = { m_StartDegrees.x, m_StartDegrees.y, m_StartDegrees.z };
+	if (m_Repeating == AnimationRepeat::NO_REPEAT || step < m_Intro.Duration || m_Loop.Duration <= 0) {
+		EvaluateTrack(m_Intro, std::min(step, m_Intro.Duration), position, relativeRotation, relativeScale, relativeDegrees);
+	} else {
+		// Every pass of the loop is the first one moved, turned and scaled by the passes before it
+		double loopStep = step - m_Intro.Duration;
+		double passes = std::floor(loopStep / m_Loop.Duration);
+		EvaluateTrack(m_Loop, loopStep - passes * m_Loop.Duration, position, relativeRotation, relativeScale, relativeDegrees);
+
+		const AnimationKey& introEnd = m_Intro.Keys.back();
+		position += m_LoopTranslation * (float)passes;
+		baseRotation = introEnd.Rotation;
+		if (m_LoopAngle != 0)
+			baseRotation = baseRotation * glm::angleAxis((float)std::fmod(m_LoopAngle * passes, TWO_PI), m_LoopAxis);
+		for (int i = 0; i < 3; i++) {
+			baseScale[i] = introEnd.Scale[i] * (float)std::pow((double)m_LoopScale[i], passes);
+			baseDegrees[i] += introEnd.Degrees[i] + m_LoopDegrees[i] * passes;
+		}
+	}
 
-	// Check for end of stage, and determine next stage based on repeat
-	HandleEndOfStage(object, stage);
+	for (int i = 0; i < 3; i++) {
+		double degrees = std::fmod(baseDegrees[i] + relativeDegrees[i], 360.0);
+		rotation[i] = (float)(degrees < 0 ? degrees + 360.0 : degrees);
+	}
+	model = glm::translate(glm::mat4(1.0f), position) * m_Base * glm::mat4_cast(baseRotation * relativeRotation) * glm::scale(glm::mat4(1.0f), baseScale * relativeScale);
 }
 
 /*
-Applies the transformation specified by the AnimationType of the given stage
-@param object - The object to apply the transformation to
-@param stage - The current stage
+@returns The order the stages are played in during one pass, repeating animations play this over and over
 */
-void Animation::ApplyTransformation(SceneObject* object, const AnimationStage stage) {
-	switch (stage.Type) {
-	case AnimationType::ROTATE:
-		object->Rotate(stage.AdditionalInput, stage.Transformation);
-		break;
-	case AnimationType::SCALE:
-		object->Scale(stage.Transformation);
-		break;
-	case AnimationType::TRANSLATE:
-		object->Translate(stage.Transformation);
-		break;
-	case AnimationType::MOVETO:
-		glm::vec3 trans;
-		if (m_TranslationCache == glm::vec3(-100)) {
-			glm::vec3 diff = stage.Transformation - object->m_Position;
-			trans = diff / (float)stage.End;
-			m_TranslationCache = trans;
-		} else
-			trans = m_TranslationCache;
-		object->Translate(trans);
-		break;
+std::vector<int> Animation::GetPass() const {
+	std::vector<int> pass;
+	int count = (int)m_Stages.size();
+	for (int i = 0; i < count; i++)
+		pass.push_back(i);
+	// Back and forth without playing the first and last stage twice in a row
+	if (m_Repeating == AnimationRepeat::REVERSE) {
+		for (int i = count - 2; i > 0; i--)
+			pass.push_back(i);
 	}
+	return pass;
 }
 
 /*
-Handles the end of the current stage
-@param object - The object to clear the animation for if AnimationRepeat::NO_REPEAT was specified
-@param stage - The current stage to end
+Makes the keys for one pass through the stages
+@param pass - The indices of the stages in the order they are played
+@param position - The absolute position at the start of the pass
+@returns The track, rotation, scale and degrees are relative to the start of the pass
 */
-void Animation::HandleEndOfStage(SceneObject* object, const AnimationStage stage) {
-	if (m_CurrentStep < stage.End) return;
-	m_CurrentStep = 0;
-	m_PrevStage = m_CurrentStage;
-	switch (m_Repeating) {
-	case AnimationRepeat::NO_REPEAT:
-		m_CurrentStage++;
-		if (m_CurrentStage >= m_Stages.size())
-			object->ClearAnimation();
-		break;
-	case AnimationRepeat::REPEAT:
-		m_CurrentStage = (m_CurrentStage + 1) % m_Stages.size();
-		break;
-	case AnimationRepeat::REVERSE:
-		if (m_Stages.size() == 1)
+AnimationTrack Animation::BuildTrack(const std::vector<int>& pass, const glm::vec3& position) const {
+	AnimationTrack track;
+	AnimationKey key;
+	key.Time = 0;
+	key.Position = position;
+	key.Rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	key.Scale = glm::vec3(1.0f);
+	key.Degrees = glm::vec3(0.0f);
+	key.Axis = glm::vec3(0.0f, 1.0f, 0.0f);
+	key.Angle = 0;
+
+	for (size_t i = 0; i < pass.size(); i++) {
+		const AnimationStage& stage = m_Stages[pass[i]];
+		int steps = std::max(stage.End, 1);
+		AnimationKey next = key;
+		next.Time += steps;
+		switch (stage.Type) {
+		case AnimationType::ROTATE:
+			// The axis is normalized like glm::rotate does, the degrees keep track of it like SceneObject::Rotate does
+			if (glm::length(stage.Transformation) > 0) {
+				key.Axis = glm::normalize(stage.Transformation);
+				key.Angle = stage.AdditionalInput * steps;
+				next.Rotation = key.Rotation * glm::angleAxis(key.Angle, key.Axis);
+				next.Degrees += glm::degrees(stage.AdditionalInput) * stage.Transformation * (float)steps;
+			}
+			break;
+		case AnimationType::SCALE:
+			for (int c = 0; c < 3; c++)
+				next.Scale[c] *= std::pow(stage.Transformation[c], (float)steps);
+			break;
+		case AnimationType::TRANSLATE:
+			next.Position += stage.Transformation * (float)steps;
+			break;
+		case AnimationType::MOVETO:
+			next.Position = stage.Transformation;
 			break;
-		if (m_ReverseRepeatForward)
-			m_CurrentStage++;
-		else
-			m_CurrentStage--;
-
-		if (m_CurrentStage < 0) {
-			m_CurrentStage = 1;
-			m_ReverseRepeatForward = true;
-		} else if (m_CurrentStage >= m_Stages.size()) {
-			m_CurrentStage = m_Stages.size() - 2;
-			m_ReverseRepeatForward = false;
 		}
-		break;
+		track.Keys.push_back(key);
+		key = next;
+		key.Axis = glm::vec3(0.0f, 1.0f, 0.0f);
+		key.Angle = 0;
+	}
+	track.Keys.push_back(key);
+	track.Duration = key.Time;
+	return track;
+}
+
+/*
+Runs a Catmull-Rom spline through p1 and p2
+*/
+static glm::vec3 CatmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t) {
+	float t2 = t * t;
+	float t3 = t2 * t;
+	return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+/*
+Evaluates a track between the two keys around the given step
+@param track - The track
+@param step - The step since the start of the track, between 0 and the duration of the track
+@param position - Set to the absolute position
+@param rotation - Set to the rotation relative to the start of the track
+@param scale - Set to the scale relative to the start of the track
+@param degrees - Set to the rotation in degrees relative to the start of the track
+*/
+void Animation::EvaluateTrack(const AnimationTrack& track, double step, glm::vec3& position, glm::quat& rotation, glm::vec3& scale, glm::vec3& degrees) const {
+	const std::vector<AnimationKey>& keys = track.Keys;
+	size_t last = keys.size() - 1;
+	if (last == 0) {
+		position = keys[0].Position;
+		rotation = keys[0].Rotation;
+		scale = keys[0].Scale;
+		degrees = keys[0].Degrees;
+		return;
 	}
-}
\ No newline at end of file
+
+	// The last key at or before the step
+	size_t i = std::upper_bound(keys.begin(), keys.end(), step, [](double s, const AnimationKey& key) { return s < key.Time; }) - keys.begin();
+	i = std::min(std::max(i, (size_t)1), last) - 1;
+	const AnimationKey& a = keys[i];
+	const AnimationKey& b = keys[i + 1];
+	float t = (float)std::min(std::max((step - a.Time) / (b.Time - a.Time), 0.0), 1.0);
+
+	if (m_Interpolation == AnimationInterpolation::CATMULL_ROM)
+		position = CatmullRom(keys[i > 0 ? i - 1 : i].Position, a.Position, b.Position, keys[std::min(i + 2, last)].Position, t);
+	else
+		position = glm::mix(a.Position, b.Position, t);
+
+	// The rotation continues around the axis of the stage, so turns of more than half a circle keep their direction
+	rotation = a.Angle != 0 ? a.Rotation * glm::angleAxis(a.Angle * t, a.Axis) : a.Rotation;
+
+	// Scales are multiplied every step, so they grow geometrically; mirrored scales can only be blended
+	for (int c = 0; c < 3; c++) {
+		if (a.Scale[c] > 0 && b.Scale[c] > 0)
+			scale[c] = a.Scale[c] * std::pow(b.Scale[c] / a.Scale[c], t);
+		else
+			scale[c] = a.Scale[c] + (b.Scale[c] - a.Scale[c]) * t;
+	}
+	degrees = glm::mix(a.Degrees, b.Degrees, t);
+}
@@ -1,11 +1,7 @@
 #pragma once
 #include <vector>
 #include "glm/glm.hpp"
-
-/*
-Forward declaration of SceneObject to counter-act circular dependency
-*/
-class SceneObject;
+#include "glm/gtc/quaternion.hpp"
 
 /*
 The type of animations that you can apply.
@@ -28,6 +24,15 @@ enum class AnimationRepeat {
 	NO_REPEAT, REPEAT, REVERSE
 };
 
+/*
+How the position is interpolated between the ends of the stages
+LINEAR moves at a constant speed within a stage, exactly like stepping through it
+CATMULL_ROM runs a spline through the ends of the stages, which rounds off the corners of a path
+*/
+enum class AnimationInterpolation {
+	LINEAR, CATMULL_ROM
+};
+
 struct AnimationStage {
 	AnimationType Type; // The type of animation
 	float AdditionalInput; // Additional input (used for rotation angle)
@@ -38,23 +43,58 @@ struct AnimationStage {
 	}
 };
 
+/*
+The state of an animation at the end of a stage, the keys of a track are evaluated in between
+*/
+struct AnimationKey {
+	double Time; // The time of the key in steps since the start of the track
+	glm::vec3 Position; // The absolute position
+	glm::quat Rotation; // The rotation relative to the start of the track
+	glm::vec3 Scale; // The scale relative to the start of the track
+	glm::vec3 Degrees; // The rotation relative to the start of the track in degrees, not wrapped
+	glm::vec3 Axis; // The axis of the rotation to the next key
+	float Angle; // The angle of the rotation to the next key in radians, can be more than half a turn
+};
+
+/*
+One pass through the stages
+*/
+struct AnimationTrack {
+	std::vector<AnimationKey> Keys; // The keys, one per stage end plus the start
+	double Duration = 0; // The length of the pass in steps
+};
+
 class Animation {
+public:
+	static const double STEP; // The length of a step in seconds
 private:
 	AnimationRepeat m_Repeating; // The repeating type of this animation
-	int m_CurrentStage; // The current stage of this animation
-	int m_PrevStage; // The previous stage of this animation (used to invalidate m_TranslationCache)
+	AnimationInterpolation m_Interpolation = AnimationInterpolation::LINEAR; // The interpolation of the position
 	std::vector<AnimationStage> m_Stages; // The stages of this animation
-	int m_CurrentStep; // The current step in the current stage (when equal to AnimationStage.End, the current stage is done)
-	glm::vec3 m_TranslationCache = glm::vec3(-100); // The cache of the translation for AnimationType::MOVETO
-	bool m_ReverseRepeatForward; // The current direction for the AnimationRepeat::REVERSE logic
+	bool m_Compiled = false; // If the tracks below are made, AddStage invalidates them
+	double m_StartTime = 0; // The time in seconds the animation started at
+	glm::mat4 m_Base; // The model matrix at the start without its translation, the tracks are applied on top of it
+	glm::vec3 m_StartDegrees; // The absolute rotation at the start in degrees
+	AnimationTrack m_Intro; // The first pass, from where the object was when the animation started
+	AnimationTrack m_Loop; // Every pass after the first one for repeating animations
+	glm::vec3 m_LoopTranslation; // The translation of one pass of m_Loop
+	glm::vec3 m_LoopAxis; // The axis of the rotation of one pass of m_Loop
+	double m_LoopAngle = 0; // The angle of the rotation of one pass of m_Loop in radians, 0 when a pass turns full circles
+	glm::vec3 m_LoopScale; // The scale of one pass of m_Loop
+	glm::vec3 m_LoopDegrees; // The rotation of one pass of m_Loop in degrees
 
 public:
 	// Methods documented in Animation.cpp
 	Animation(const AnimationRepeat& repeat = AnimationRepeat::REPEAT);
 	void AddStage(const AnimationStage& stage);
-	void Animate(SceneObject* object);
+	void SetInterpolation(AnimationInterpolation interpolation);
+	void Compile(const glm::mat4& model, const glm::vec3& position, const glm::vec3& rotation, double startTime);
+	bool IsCompiled() const;
+	bool IsFinished(double time) const;
+	void Evaluate(double time, glm::mat4& model, glm::vec3& position, glm::vec3& rotation) const;
 
 private:
-	void ApplyTransformation(SceneObject* object, const AnimationStage stage);
-	void HandleEndOfStage(SceneObject* object, const AnimationStage stage);
+	std::vector<int> GetPass() const;
+	AnimationTrack BuildTrack(const std::vector<int>& pass, const glm::vec3& position) const;
+	void EvaluateTrack(const AnimationTrack& track, double step, glm::vec3& position, glm::quat& rotation, glm::vec3& scale, glm::vec3& degrees) const;
 };
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <unordered_map>
+
+#include "AssetCache.h"
+#include "AssetLoader.h"
+#include "TextureArrays.h"
+
+/*
+Takes ownership of a layer of the TextureArrays
+@param layer - The layer
+*/
+Texture::Texture(GLuint layer) {
+	Layer = layer;
+}
+
+/*
+Destructor, gives the layer back
+*/
+Texture::~Texture() {
+	TextureArrays::Free(Layer);
+}
+
+/*
+@returns The layer shaders should sample, the placeholder layer until the image is resident
+*/
+GLuint Texture::GetSampledLayer() const {
+	return Resident ? Layer : TextureArrays::PLACEHOLDER_LAYER;
+}
+
+namespace AssetCache {
+	std::unordered_map<std::string, std::weak_ptr<Mesh>> meshes; // The loaded meshes by canonical path
+	std::unordered_map<std::string, std::weak_ptr<Texture>> textures; // The loaded textures by canonical path
+
+	/*
+	Removes the entries of assets that were freed
+	*/
+	template<typename T>
+	static void RemoveExpired(std::unordered_map<std::string, std::weak_ptr<T>>& registry) {
+		for (auto it = registry.begin(); it != registry.end();) {
+			if (it->second.expired())
+				it = registry.erase(it);
+			else
+				++it;
+		}
+	}
+
+	/*
+	Counts the assets in a registry that are still in use
+	*/
+	template<typename T>
+	static size_t CountLive(const std::unordered_map<std::string, std::weak_ptr<T>>& registry) {
+		size_t count = 0;
+		for (auto it = registry.begin(); it != registry.end(); ++it) {
+			if (!it->second.expired())
+				count++;
+		}
+		return count;
+	}
+
+	/*
+	Turns a path into an absolute path without ".", ".." or symbolic links, so different spellings of the same file share one asset
+	@param path - The path to canonicalize
+	@returns The canonical path, or the path as given if the file does not exist
+	*/
+	std::string CanonicalPath(const char* path) {
+#ifdef _WIN32
+		char buffer[_MAX_PATH];
+		if (_fullpath(buffer, path, _MAX_PATH) != nullptr)
+			return buffer;
+#else
+		char* resolved = realpath(path, nullptr);
+		if (resolved != nullptr) {
+			std::string result = resolved;
+			free(resolved);
+			return result;
+		}
+#endif
+		return path;
+	}
+
+	/*
+	Returns the mesh of the model, starting to load it if no scene object uses it yet
+	@param modelPath - The path of the .obj file
+	@returns The shared mesh, which may not be resident yet
+	*/
+	std::shared_ptr<Mesh> GetMesh(const char* modelPath) {
+		std::string key = CanonicalPath(modelPath);
+		std::shared_ptr<Mesh> mesh = meshes[key].lock();
+		if (mesh)
+			return mesh;
+
+		RemoveExpired(meshes);
+		mesh = std::make_shared<Mesh>();
+		AssetLoader::LoadMesh(mesh, modelPath);
+		meshes[key] = mesh;
+		return mesh;
+	}
+
+	/*
+	Returns the texture of the image, starting to load it if no scene object uses it yet
+	@param texturePath - The path of the .bmp file
+	@returns The shared texture, which shows a placeholder until the image is resident
+	*/
+	std::shared_ptr<Texture> GetTexture(const char* texturePath) {
+		std::string key = CanonicalPath(texturePath);
+		std::shared_ptr<Texture> texture = textures[key].lock();
+		if (texture)
+			return texture;
+
+		RemoveExpired(textures);
+		texture = std::make_shared<Texture>(TextureArrays::Allocate());
+		AssetLoader::LoadTexture(texture, texturePath);
+		textures[key] = texture;
+		return texture;
+	}
+
+	/*
+	@returns The amount of unique meshes that are loaded
+	*/
+	size_t LiveMeshCount() {
+		return CountLive(meshes);
+	}
+
+	/*
+	@returns The amount of unique textures that are loaded
+	*/
+	size_t LiveTextureCount() {
+		return CountLive(textures);
+	}
+}
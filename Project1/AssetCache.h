@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <GL/glew.h>
+#include "Mesh.h"
+
+/*
+A texture that can be shared between scene objects, see AssetCache.
+The image is a layer of the TextureArrays, the layer is given back together with the object.
+Until the AssetLoader made the image resident the placeholder layer is sampled
+*/
+class Texture {
+public:
+	GLuint Layer; // The layer of the image in the TextureArrays, the placeholder layer if the array had no room
+	bool Resident = false; // If the image was uploaded into its layer
+
+	// Methods are documented in AssetCache.cpp
+	explicit Texture(GLuint layer);
+	~Texture();
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+	GLuint GetSampledLayer() const;
+};
+
+/*
+Registry of the meshes and textures that are in use, keyed by their canonical path.
+Asking for the same file twice returns the same object, so every unique file is read and uploaded once.
+New assets are loaded by the AssetLoader in the background: meshes are not resident until then, textures show a placeholder.
+The registry only holds weak references: an asset is freed as soon as the last scene object using it is destroyed
+*/
+namespace AssetCache {
+	// Documented in AssetCache.cpp
+	std::string CanonicalPath(const char* path);
+	std::shared_ptr<Mesh> GetMesh(const char* modelPath);
+	std::shared_ptr<Texture> GetTexture(const char* texturePath);
+	size_t LiveMeshCount();
+	size_t LiveTextureCount();
+}
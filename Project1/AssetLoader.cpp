@@ -0,0 +1,494 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "AssetCache.h"
+#include "TextureArrays.h"
+#include "TextureCache.h"
+#include "TextureProcessing.h"
+
+namespace AssetLoader {
+	const int STAGING_SEGMENTS = 3; // The staging buffer is split in one segment per frame, a segment is written again 3 frames later
+
+	/*
+	A file for the workers to load, either a mesh or a texture
+	*/
+	struct Request {
+		std::shared_ptr<Mesh> mesh; // The mesh to load the model into, or nullptr
+		std::shared_ptr<Texture> texture; // The texture to decode the image for, or nullptr
+		std::string path; // The path of the file
+	};
+
+	/*
+	One mip level of an image, uploaded a band of rows at a time.
+	A row is a row of pixels for uncompressed images and a row of 4x4 blocks for compressed ones
+	*/
+	struct Level {
+		unsigned int width, height; // The size of the level in pixels
+		size_t offset; // The offset of the level in the pixels of the result
+		size_t rowBytes; // The size of a row
+		unsigned int rows; // The amount of rows
+	};
+
+	/*
+	A loaded file waiting to be uploaded
+	*/
+	struct Result {
+		std::shared_ptr<Mesh> mesh; // The mesh, its Data is complete
+		std::shared_ptr<Texture> texture; // The texture the pixels are for
+		bool loaded = false; // If the file could be read, failed assets keep their placeholder
+		GLenum format = GL_RGBA; // GL_RGBA for uncompressed levels, otherwise the compressed format of the blocks
+		std::vector<unsigned char> pixels; // The RGBA rows or the blocks of every level
+		std::vector<Level> levels; // The mip levels, largest first
+		unsigned int level = 0; // The level that is being uploaded
+		unsigned int uploadedRows = 0; // The amount of rows of that level that were uploaded
+		bool done = false; // If the asset is resident (or failed)
+	};
+
+	/*
+	Rows of an image that were copied into the staging buffer this frame
+	*/
+	struct Band {
+		Result* result;
+		unsigned int level; // The mip level
+		unsigned int row, rows; // The first row and the amount of rows
+		size_t offset; // The offset of the rows in the segment
+	};
+
+	std::vector<std::thread> workers; // The threads that load the files
+	std::mutex mutex; // Guards requests, results and stopping
+	std::condition_variable wake; // Signalled when there is a request or the loader stops
+	std::deque<Request> requests; // Files waiting for a worker
+	std::deque<Result> results; // Files the workers are done with
+	bool stopping = false; // Tells the workers to quit
+
+	std::deque<Result> uploads; // Loaded files the GL thread is uploading
+	size_t pending = 0; // The amount of requested assets that are not resident yet
+	size_t uploadedBytes = 0; // The amount of bytes uploaded in the last Update
+	std::unique_ptr<Mesh> placeholderMesh; // The box shown for meshes that are not resident
+	bool compressTextures = false; // If images are block compressed, set by Start when the driver supports S3TC
+
+	GLuint staging = 0; // The staging buffer
+	unsigned char* persistent = nullptr; // The persistent mapping of the whole staging buffer, nullptr when it is mapped every frame
+	size_t segmentSize = 0; // The size of a segment
+	int segment = 0; // The segment of the current frame
+	GLsync fences[STAGING_SEGMENTS] = {}; // Signalled when the GPU is done reading a segment
+
+	/*
+	Reads an image for a request, resized to the layer size of the TextureArrays.
+	Block compressed (from the TextureCache, compressing it first if needed) when the driver supports it, the layers have the same format then
+	*/
+	static bool ProcessTexture(const char* texturePath, Result& result) {
+		const unsigned int size = TextureArrays::LAYER_SIZE;
+		if (compressTextures) {
+			CompressedTexture compressed;
+			if (!TextureCache::Load(texturePath, size, compressed) && !TextureCache::Compress(texturePath, size, compressed))
+				return false;
+			// The layers are BC1, the cache never makes anything else for 24-bit images
+			if (compressed.format != BlockFormat::BC1)
+				return false;
+			size_t blockSize = 8;
+			result.format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			result.pixels = std::move(compressed.data);
+			size_t offset = 0;
+			for (unsigned int i = 0; i < compressed.levels; i++) {
+				Level level;
+				level.width = std::max(1u, compressed.width >> i);
+				level.height = std::max(1u, compressed.height >> i);
+				level.offset = offset;
+				level.rowBytes = (level.width + 3) / 4 * blockSize;
+				level.rows = (level.height + 3) / 4;
+				result.levels.push_back(level);
+				offset += level.rowBytes * level.rows;
+			}
+			return true;
+		}
+
+		unsigned int width, height;
+		std::vector<unsigned char> rgba;
+		if (!TextureProcessing::LoadBMP(texturePath, width, height, rgba))
+			return false;
+		if (width != size || height != size) {
+			rgba = TextureProcessing::Resize(rgba.data(), width, height, size, size, MipFilter::KAISER);
+			width = height = size;
+		}
+		std::vector<std::vector<unsigned char>> levels = TextureProcessing::BuildMipChain(std::move(rgba), width, height, MipFilter::KAISER);
+		result.format = GL_RGBA;
+		for (size_t i = 0; i < levels.size(); i++) {
+			Level level;
+			level.width = std::max(1u, width >> i);
+			level.height = std::max(1u, height >> i);
+			level.offset = result.pixels.size();
+			level.rowBytes = (size_t)level.width * 4;
+			level.rows = level.height;
+			result.levels.push_back(level);
+			result.pixels.insert(result.pixels.end(), levels[i].begin(), levels[i].end());
+		}
+		return true;
+	}
+
+	/*
+	Reads the file of a request
+	*/
+	static void Process(const Request& request, Result& result) {
+		result.mesh = request.mesh;
+		result.texture = request.texture;
+		if (request.mesh)
+			result.loaded = request.mesh->Load(request.path.c_str());
+		else
+			result.loaded = ProcessTexture(request.path.c_str(), result);
+	}
+
+	/*
+	The loop of a worker thread
+	*/
+	static void Work() {
+		for (;;) {
+			Request request;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [] { return stopping || !requests.empty(); });
+				if (stopping)
+					return;
+				request = std::move(requests.front());
+				requests.pop_front();
+			}
+			Result result;
+			Process(request, result);
+			std::lock_guard<std::mutex> lock(mutex);
+			results.push_back(std::move(result));
+		}
+	}
+
+	/*
+	Hands a request to the workers, or loads it right away when there are none
+	*/
+	static void Enqueue(Request request) {
+		pending++;
+		if (workers.empty()) {
+			Result result;
+			Process(request, result);
+			std::lock_guard<std::mutex> lock(mutex);
+			results.push_back(std::move(result));
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			requests.push_back(std::move(request));
+		}
+		wake.notify_one();
+	}
+
+	/*
+	Starts the worker threads, without them every file is loaded on the calling thread when it is asked for (uploads still wait for Update).
+	Must be called on the GL thread before any texture is requested, it checks if textures can be block compressed and makes the TextureArrays
+	@param threadCount - The amount of workers, 0 uses one per core
+	*/
+	void Start(unsigned int threadCount) {
+		compressTextures = glewIsSupported("GL_EXT_texture_compression_s3tc") != 0;
+		TextureArrays::Init(compressTextures);
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		stopping = false;
+		for (unsigned int i = 0; i < threadCount; i++)
+			workers.push_back(std::thread(Work));
+	}
+
+	/*
+	Stops the workers and frees the staging buffer, the placeholder and the TextureArrays, assets that were not uploaded yet keep their placeholder.
+	Must be called on the GL thread while the context still exists, after the scene objects are gone
+	*/
+	void Stop() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (size_t i = 0; i < workers.size(); i++)
+			workers[i].join();
+		workers.clear();
+		requests.clear();
+		results.clear();
+		uploads.clear();
+		pending = 0;
+
+		for (int i = 0; i < STAGING_SEGMENTS; i++) {
+			if (fences[i] != nullptr)
+				glDeleteSync(fences[i]);
+			fences[i] = nullptr;
+		}
+		if (staging != 0) {
+			if (persistent != nullptr) {
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			}
+			glDeleteBuffers(1, &staging);
+		}
+		staging = 0;
+		persistent = nullptr;
+		placeholderMesh.reset();
+		TextureArrays::Clear();
+	}
+
+	/*
+	Loads the model into the mesh in the background, the mesh is resident once Update uploaded it
+	@param mesh - The mesh, Data must not be touched until it is resident
+	@param modelPath - The path of the .obj file
+	*/
+	void LoadMesh(const std::shared_ptr<Mesh>& mesh, const char* modelPath) {
+		Request request;
+		request.mesh = mesh;
+		request.path = modelPath;
+		Enqueue(std::move(request));
+	}
+
+	/*
+	Decodes the image in the background (as BC1 blocks from the TextureCache if the driver supports S3TC), Update makes the texture resident once all levels are in its layer
+	@param texture - The texture, showing the placeholder layer until then
+	@param texturePath - The path of the .bmp file
+	*/
+	void LoadTexture(const std::shared_ptr<Texture>& texture, const char* texturePath) {
+		Request request;
+		request.texture = texture;
+		request.path = texturePath;
+		Enqueue(std::move(request));
+	}
+
+	/*
+	Makes the staging buffer, persistently mapped when the driver supports it
+	*/
+	static void CreateStaging() {
+		segmentSize = DEFAULT_BUDGET;
+		glGenBuffers(1, &staging);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+		if (glewIsSupported("GL_ARB_buffer_storage")) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_PIXEL_UNPACK_BUFFER, segmentSize * STAGING_SEGMENTS, nullptr, flags);
+			persistent = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, segmentSize * STAGING_SEGMENTS, flags);
+		} else {
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, segmentSize, nullptr, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	/*
+	Returns the memory of the segment of this frame, waiting for the GPU if it still reads from it
+	*/
+	static unsigned char* BeginStaging() {
+		if (staging == 0)
+			CreateStaging();
+		if (persistent != nullptr) {
+			segment = (segment + 1) % STAGING_SEGMENTS;
+			if (fences[segment] != nullptr) {
+				glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+				glDeleteSync(fences[segment]);
+				fences[segment] = nullptr;
+			}
+			return persistent + segment * segmentSize;
+		}
+
+		// Orphaning gives a fresh buffer, the driver keeps the old one alive for the uploads that still read it
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, segmentSize, nullptr, GL_STREAM_DRAW);
+		unsigned char* memory = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, segmentSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return memory;
+	}
+
+	/*
+	Uploads rows of a level of the image of a result into the layer of its texture
+	@param data - The rows, an offset when the staging buffer is bound
+	*/
+	static void UploadRows(const Result& result, unsigned int levelIndex, unsigned int row, unsigned int rows, const void* data) {
+		const Level& level = result.levels[levelIndex];
+		GLint layer = (GLint)result.texture->Layer;
+		glBindTexture(GL_TEXTURE_2D_ARRAY, TextureArrays::GetName());
+		if (result.format == GL_RGBA) {
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, levelIndex, 0, row, layer, level.width, rows, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		} else {
+			// Compressed uploads work on whole blocks, only the last band of a level may end on a partial block
+			unsigned int y = row * 4;
+			unsigned int height = std::min(rows * 4, level.height - y);
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, levelIndex, 0, y, layer, level.width, height, 1, result.format, (GLsizei)(rows * level.rowBytes), data);
+		}
+	}
+
+	/*
+	Uploads the rows that were copied into the segment of this frame
+	*/
+	static void EndStaging(const std::vector<Band>& bands) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+		size_t base = 0;
+		if (persistent != nullptr)
+			base = segment * segmentSize;
+		else
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		for (size_t i = 0; i < bands.size(); i++) {
+			const Band& band = bands[i];
+			UploadRows(*band.result, band.level, band.row, band.rows, (const void*)(base + band.offset));
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (persistent != nullptr)
+			fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	/*
+	Uploads what the workers loaded, at most byteBudget bytes (at least one mesh or row of an image, so everything gets there eventually).
+	Images are uploaded a band of rows at a time into the layer of their texture, which becomes resident when the last row is in.
+	Must be called on the GL thread, once per frame before anything is drawn since it changes the GL bindings
+	@param byteBudget - The amount of bytes to upload, images upload at most one segment of the staging buffer per call
+	@returns The amount of assets that became resident, objects must switch from their placeholders when this is not 0
+	*/
+	int Update(size_t byteBudget) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			while (!results.empty()) {
+				uploads.push_back(std::move(results.front()));
+				results.pop_front();
+			}
+		}
+		uploadedBytes = 0;
+		if (uploads.empty())
+			return 0;
+
+		int resident = 0;
+		std::vector<Band> bands;
+		unsigned char* memory = nullptr;
+		size_t staged = 0;
+		for (size_t i = 0; i < uploads.size() && uploadedBytes < byteBudget; i++) {
+			Result& result = uploads[i];
+			if (!result.loaded || (result.texture && result.texture->Layer == TextureArrays::PLACEHOLDER_LAYER)) {
+				result.done = true;
+				continue;
+			}
+
+			if (result.mesh) {
+				const MeshData& data = result.mesh->Data;
+				size_t bytes = data.vertices.size() * 16 + data.indices.size() * sizeof(GLushort);
+				if (uploadedBytes > 0 && uploadedBytes + bytes > byteBudget)
+					break;
+				result.mesh->GetBuffers(VertexFormat::COMPACT);
+				result.mesh->Resident = true;
+				result.done = true;
+				uploadedBytes += bytes;
+				resident++;
+				continue;
+			}
+
+			bool full = false;
+			while (result.level < result.levels.size() && !full) {
+				const Level& level = result.levels[result.level];
+				const unsigned char* rowData = &result.pixels[level.offset + result.uploadedRows * level.rowBytes];
+				unsigned int rows;
+				if (level.rowBytes > DEFAULT_BUDGET) {
+					// Too wide for the staging buffer, uploaded straight from memory
+					rows = level.rows;
+					UploadRows(result, result.level, 0, rows, rowData);
+				} else {
+					size_t room = std::min(byteBudget - uploadedBytes, DEFAULT_BUDGET - staged);
+					rows = (unsigned int)std::min((size_t)(level.rows - result.uploadedRows), room / level.rowBytes);
+					if (rows == 0 && uploadedBytes == 0)
+						rows = 1;
+					if (rows == 0) {
+						full = true;
+						break;
+					}
+					if (memory == nullptr)
+						memory = BeginStaging();
+					memcpy(memory + staged, rowData, rows * level.rowBytes);
+					bands.push_back(Band{ &result, result.level, result.uploadedRows, rows, staged });
+					staged += rows * level.rowBytes;
+				}
+				uploadedBytes += rows * level.rowBytes;
+				result.uploadedRows += rows;
+				if (result.uploadedRows == level.rows) {
+					result.level++;
+					result.uploadedRows = 0;
+				}
+			}
+			if (result.level == result.levels.size()) {
+				// The last rows are uploaded below, before anything samples the layer
+				result.texture->Resident = true;
+				result.done = true;
+				resident++;
+			}
+			if (full)
+				break;
+		}
+		if (memory != nullptr)
+			EndStaging(bands);
+
+		size_t before = uploads.size();
+		uploads.erase(std::remove_if(uploads.begin(), uploads.end(), [](const Result& result) { return result.done; }), uploads.end());
+		pending -= before - uploads.size();
+		return resident;
+	}
+
+	/*
+	Waits until every requested asset is resident, for when the first frame must show the whole scene (benchmarks and screenshots)
+	*/
+	void Finish() {
+		while (pending > 0) {
+			if (Update(SIZE_MAX) == 0)
+				std::this_thread::yield();
+		}
+	}
+
+	/*
+	@returns The amount of requested assets that are not resident yet
+	*/
+	size_t GetPendingCount() {
+		return pending;
+	}
+
+	/*
+	@returns The amount of bytes uploaded in the last Update
+	*/
+	size_t GetUploadedBytes() {
+		return uploadedBytes;
+	}
+
+	/*
+	Adds one side of the placeholder box
+	*/
+	static void AddFace(MeshData& data, const glm::vec3& normal, const glm::vec3& u, const glm::vec3& v) {
+		unsigned int first = (unsigned int)data.vertices.size();
+		const glm::vec2 corners[4] = { glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(1, 1), glm::vec2(0, 1) };
+		for (int i = 0; i < 4; i++) {
+			data.vertices.push_back((normal + u * (corners[i].x * 2 - 1) + v * (corners[i].y * 2 - 1)) * 0.5f);
+			data.normals.push_back(normal);
+			data.uvs.push_back(corners[i]);
+		}
+		const unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+		for (int i = 0; i < 6; i++)
+			data.indices.push_back(first + quad[i]);
+	}
+
+	/*
+	@returns The box of 1 metre that is shown for meshes that are not resident, made on the first call (on the GL thread)
+	*/
+	Mesh* GetPlaceholderMesh() {
+		if (placeholderMesh)
+			return placeholderMesh.get();
+		placeholderMesh.reset(new Mesh());
+		MeshData& data = placeholderMesh->Data;
+		AddFace(data, glm::vec3(1, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+		AddFace(data, glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 1, 0));
+		AddFace(data, glm::vec3(0, 1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, -1));
+		AddFace(data, glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1));
+		AddFace(data, glm::vec3(0, 0, 1), glm::vec3(1, 0, 0), glm::vec3(0, 1, 0));
+		AddFace(data, glm::vec3(0, 0, -1), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0));
+		data.CalculateBounds();
+		placeholderMesh->Resident = true;
+		return placeholderMesh.get();
+	}
+}
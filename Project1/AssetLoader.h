@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <GL/glew.h>
+
+/*
+Forward declarations to counter-act circular dependency
+*/
+class Mesh;
+class Texture;
+
+/*
+Loads meshes and textures in the background so the first frame doesn't wait for the scene.
+Worker threads parse the models and decode the images, the GL thread uploads the results in Update under a byte budget per frame.
+Textures go through a staging buffer bound as pixel unpack buffer: persistently mapped when GL_ARB_buffer_storage is available, orphaned and mapped every frame otherwise.
+Until an asset is resident the objects that use it show a placeholder: the grey checker layer of the TextureArrays and a 1 metre box
+*/
+namespace AssetLoader {
+	const size_t DEFAULT_BUDGET = 4 * 1024 * 1024; // The amount of bytes uploaded per frame, also the size of one segment of the staging buffer
+
+	// Documented in AssetLoader.cpp
+	void Start(unsigned int threadCount = 0);
+	void Stop();
+	void LoadMesh(const std::shared_ptr<Mesh>& mesh, const char* modelPath);
+	void LoadTexture(const std::shared_ptr<Texture>& texture, const char* texturePath);
+	int Update(size_t byteBudget = DEFAULT_BUDGET);
+	void Finish();
+	size_t GetPendingCount();
+	size_t GetUploadedBytes();
+	Mesh* GetPlaceholderMesh();
+}
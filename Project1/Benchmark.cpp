@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "Benchmark.h"
+
+namespace Benchmark {
+	// The camera path, a closed Catmull-Rom spline: from the walking start past the street lanterns and the bus stop,
+	// up over the buildings to a far overview and back low along the basketball court
+	const glm::vec3 PATH[] = {
+		glm::vec3(0.0f, 1.75f, 3.0f),
+		glm::vec3(15.0f, 3.0f, 40.0f),
+		glm::vec3(40.0f, 10.0f, 85.0f),
+		glm::vec3(-20.0f, 20.0f, 95.0f),
+		glm::vec3(-80.0f, 30.0f, 50.0f),
+		glm::vec3(-90.0f, 45.0f, -40.0f),
+		glm::vec3(-30.0f, 12.0f, -60.0f),
+		glm::vec3(20.0f, 5.0f, -30.0f),
+		glm::vec3(10.0f, 2.0f, -5.0f),
+	};
+	const int PATH_POINTS = sizeof(PATH) / sizeof(PATH[0]);
+	const glm::vec3 LOOK_AT = glm::vec3(-10.0f, 0.0f, 15.0f); // The middle of the scene, the camera looks half along the path and half at this
+	const float LOOK_AHEAD = 0.01f; // How far ahead on the path the camera looks, as a part of the whole path
+
+	EGLDisplay display = EGL_NO_DISPLAY; // The EGL display, surfaceless when Mesa supports it
+	EGLContext context = EGL_NO_CONTEXT; // The GL context
+	GLuint framebuffer = 0, colourBuffer = 0, depthBuffer = 0; // The offscreen framebuffer everything is drawn into
+
+	bool timerQueries = false; // If GL_ARB_timer_query is supported
+	GLuint queries[QUERY_LAG] = {}; // The GPU timer of the last QUERY_LAG frames, by frame index
+	std::vector<FrameSample> samples; // The frames measured so far
+	std::chrono::steady_clock::time_point frameStart; // When the current frame started
+	std::chrono::steady_clock::time_point previousStart; // When the previous frame started
+	bool started = false; // If a frame was measured before, so frame_ms has something to compare with
+
+	/*
+	Makes an OpenGL 4.3 compatibility context (what freeglut gives the window) without a window, and a framebuffer object to draw into
+	that stays bound for the whole run
+	@param width - The width of the framebuffer
+	@param height - The height of the framebuffer
+	@returns False if there is no EGL display or it can't make an OpenGL 4.3 context
+	*/
+	bool CreateContext(int width, int height) {
+		// Mesa's surfaceless platform needs no display server, any other EGL gets the default display
+		const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay != nullptr && clientExtensions != nullptr && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != nullptr)
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		if (display == EGL_NO_DISPLAY)
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		EGLint major, minor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+			printf("Could not initialise EGL\n");
+			return false;
+		}
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			printf("EGL %d.%d has no desktop OpenGL\n", major, minor);
+			return false;
+		}
+
+		const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		EGLConfig config = nullptr;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+			config = nullptr; // EGL_KHR_no_config_context, nothing is drawn to an EGL surface anyway
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+			printf("Could not make an OpenGL 4.3 context with EGL %d.%d\n", major, minor);
+			return false;
+		}
+
+		// GLEW built for GLX reports a missing GLX display after it loaded the GL entry points, which is fine without a window
+		GLenum error = glewInit();
+		if (error != GLEW_OK)
+			printf("glewInit: %s\n", glewGetErrorString(error));
+		printf("Benchmarking on %s (%s)\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+		glGenRenderbuffers(1, &colourBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, colourBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glGenRenderbuffers(1, &depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colourBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			printf("The offscreen framebuffer is incomplete\n");
+			return false;
+		}
+		glViewport(0, 0, width, height);
+
+		timerQueries = glewIsSupported("GL_ARB_timer_query") != 0;
+		if (timerQueries)
+			glGenQueries(QUERY_LAG, queries);
+		else
+			printf("No GL_ARB_timer_query, GPU times are not measured\n");
+		samples.clear();
+		started = false;
+		return true;
+	}
+
+	/*
+	Deletes the framebuffer, the queries and the context
+	*/
+	void DestroyContext() {
+		if (context == EGL_NO_CONTEXT)
+			return;
+		if (timerQueries)
+			glDeleteQueries(QUERY_LAG, queries);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colourBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, context);
+		eglTerminate(display);
+		context = EGL_NO_CONTEXT;
+		display = EGL_NO_DISPLAY;
+	}
+
+	/*
+	@returns The point of the closed spline at a position along it
+	@param t - The position, 0 to 1 is the whole path
+	*/
+	static glm::vec3 GetPathPoint(float t) {
+		float f = (t - floorf(t)) * PATH_POINTS;
+		int i = std::min((int)f, PATH_POINTS - 1);
+		float s = f - i;
+		const glm::vec3& p0 = PATH[(i + PATH_POINTS - 1) % PATH_POINTS];
+		const glm::vec3& p1 = PATH[i];
+		const glm::vec3& p2 = PATH[(i + 1) % PATH_POINTS];
+		const glm::vec3& p3 = PATH[(i + 2) % PATH_POINTS];
+		return 0.5f * (2.0f * p1 + (p2 - p0) * s + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * (s * s) + (3.0f * p1 - p0 - 3.0f * p2 + p3) * (s * s * s));
+	}
+
+	/*
+	Returns the camera at a position along the path, the same on every run and every machine
+	@param t - The position, 0 to 1 is the whole path and it loops after that
+	@param position - Set to the position of the camera
+	@param front - Set to the direction the camera looks in
+	*/
+	void GetCameraPath(float t, glm::vec3& position, glm::vec3& front) {
+		position = GetPathPoint(t);
+		glm::vec3 ahead = glm::normalize(GetPathPoint(t + LOOK_AHEAD) - position);
+		front = glm::normalize(ahead + glm::normalize(LOOK_AT - position));
+	}
+
+	/*
+	Starts measuring a frame, must be followed by EndFrame before the next one
+	*/
+	void BeginFrame() {
+		size_t frame = samples.size();
+		if (timerQueries && frame >= QUERY_LAG) {
+			// The query of QUERY_LAG frames ago is reused, its result is usually in by now
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(queries[frame % QUERY_LAG], GL_QUERY_RESULT, &elapsed);
+			samples[frame - QUERY_LAG].gpu_ms = elapsed / 1e6;
+		}
+		previousStart = frameStart;
+		frameStart = std::chrono::steady_clock::now();
+		if (timerQueries)
+			glBeginQuery(GL_TIME_ELAPSED, queries[frame % QUERY_LAG]);
+	}
+
+	/*
+	Stops measuring the frame and stores it
+	@param counts - The draw calls, commands, visible objects and triangles of the frame, the times are filled in
+	*/
+	void EndFrame(const FrameSample& counts) {
+		if (timerQueries)
+			glEndQuery(GL_TIME_ELAPSED);
+		FrameSample sample = counts;
+		sample.cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+		sample.frame_ms = started ? std::chrono::duration<double, std::milli>(frameStart - previousStart).count() : sample.cpu_ms;
+		sample.gpu_ms = -1.0;
+		started = true;
+		samples.push_back(sample);
+	}
+
+	/*
+	Waits for the GPU times of the last frames
+	@returns Every frame measured since CreateContext
+	*/
+	const std::vector<FrameSample>& Finish() {
+		if (timerQueries) {
+			size_t first = samples.size() > (size_t)QUERY_LAG ? samples.size() - QUERY_LAG : 0;
+			for (size_t frame = first; frame < samples.size(); frame++) {
+				GLuint64 elapsed = 0;
+				glGetQueryObjectui64v(queries[frame % QUERY_LAG], GL_QUERY_RESULT, &elapsed);
+				samples[frame].gpu_ms = elapsed / 1e6;
+			}
+		}
+		return samples;
+	}
+
+	/*
+	The spread of one measurement over the frames
+	*/
+	struct Statistics {
+		double min = 0, avg = 0, p50 = 0, p99 = 0, max = 0;
+		bool valid = false; // False if no frame had the measurement
+	};
+
+	/*
+	@param values - The measurement of every frame, negative values are left out
+	@returns The minimum, average, median, 99th percentile (nearest rank) and maximum
+	*/
+	static Statistics Summarize(std::vector<double> values) {
+		Statistics statistics;
+		values.erase(std::remove_if(values.begin(), values.end(), [](double value) { return value < 0.0; }), values.end());
+		if (values.empty())
+			return statistics;
+		std::sort(values.begin(), values.end());
+		statistics.valid = true;
+		statistics.min = values.front();
+		statistics.max = values.back();
+		for (double value : values)
+			statistics.avg += value;
+		statistics.avg /= values.size();
+		statistics.p50 = values[(size_t)ceil(0.50 * values.size()) - 1];
+		statistics.p99 = values[(size_t)ceil(0.99 * values.size()) - 1];
+		return statistics;
+	}
+
+	/*
+	@returns One column of the samples
+	*/
+	template <typename T>
+	static std::vector<double> Column(const std::vector<FrameSample>& samples, T FrameSample::* member) {
+		std::vector<double> values;
+		values.reserve(samples.size());
+		for (const FrameSample& sample : samples)
+			values.push_back((double)(sample.*member));
+		return values;
+	}
+
+	/*
+	Writes one line per frame
+	@param path - The path of the .csv file
+	@param samples - The frames
+	@returns True if the file was written
+	*/
+	bool WriteCsv(const std::string& path, const std::vector<FrameSample>& samples) {
+		FILE* file = fopen(path.c_str(), "w");
+		if (file == nullptr) {
+			printf("Could not write %s\n", path.c_str());
+			return false;
+		}
+		fprintf(file, "frame,cpu_ms,gpu_ms,frame_ms,draw_calls,commands,visible,triangles\n");
+		for (size_t i = 0; i < samples.size(); i++) {
+			const FrameSample& s = samples[i];
+			fprintf(file, "%zu,%.4f,%.4f,%.4f,%d,%d,%d,%zu\n", i, s.cpu_ms, s.gpu_ms, s.frame_ms, s.draw_calls, s.commands, s.visible, s.triangles);
+		}
+		return fclose(file) == 0;
+	}
+
+	/*
+	Writes one statistics object of the JSON file, null if the measurement was never made
+	*/
+	static void WriteStatistics(FILE* file, const char* name, const Statistics& statistics, bool last) {
+		if (statistics.valid)
+			fprintf(file, "  \"%s\": { \"min\": %.4f, \"avg\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n", name,
+				statistics.min, statistics.avg, statistics.p50, statistics.p99, statistics.max, last ? "" : ",");
+		else
+			fprintf(file, "  \"%s\": null%s\n", name, last ? "" : ",");
+	}
+
+	/*
+	Writes the settings of the run and the statistics of every measurement
+	@param path - The path of the .json file
+	@param info - The settings of the run
+	@param samples - The frames
+	@returns True if the file was written
+	*/
+	bool WriteJson(const std::string& path, const BenchmarkInfo& info, const std::vector<FrameSample>& samples) {
+		FILE* file = fopen(path.c_str(), "w");
+		if (file == nullptr) {
+			printf("Could not write %s\n", path.c_str());
+			return false;
+		}
+		fprintf(file, "{\n");
+		fprintf(file, "  \"gl_renderer\": \"%s\",\n", (const char*)glGetString(GL_RENDERER));
+		fprintf(file, "  \"gl_version\": \"%s\",\n", (const char*)glGetString(GL_VERSION));
+		fprintf(file, "  \"renderer\": \"%s\",\n", info.renderer.c_str());
+		fprintf(file, "  \"lod\": %s,\n", info.lod ? "true" : "false");
+		fprintf(file, "  \"texture_filter\": \"%s\",\n", info.texture_filter.c_str());
+		fprintf(file, "  \"width\": %d,\n", info.width);
+		fprintf(file, "  \"height\": %d,\n", info.height);
+		fprintf(file, "  \"warmup\": %d,\n", info.warmup);
+		fprintf(file, "  \"frames\": %zu,\n", samples.size());
+		WriteStatistics(file, "cpu_ms", Summarize(Column(samples, &FrameSample::cpu_ms)), false);
+		WriteStatistics(file, "gpu_ms", Summarize(Column(samples, &FrameSample::gpu_ms)), false);
+		WriteStatistics(file, "frame_ms", Summarize(Column(samples, &FrameSample::frame_ms)), false);
+		WriteStatistics(file, "draw_calls", Summarize(Column(samples, &FrameSample::draw_calls)), false);
+		WriteStatistics(file, "commands", Summarize(Column(samples, &FrameSample::commands)), false);
+		WriteStatistics(file, "visible", Summarize(Column(samples, &FrameSample::visible)), false);
+		WriteStatistics(file, "triangles", Summarize(Column(samples, &FrameSample::triangles)), true);
+		fprintf(file, "}\n");
+		return fclose(file) == 0;
+	}
+
+	/*
+	Prints the statistics of the times and the average counts
+	@param info - The settings of the run
+	@param samples - The frames
+	*/
+	void PrintSummary(const BenchmarkInfo& info, const std::vector<FrameSample>& samples) {
+		printf("%zu frames, %s renderer, levels of detail %s, %s texture filter\n", samples.size(), info.renderer.c_str(), info.lod ? "on" : "off", info.texture_filter.c_str());
+		const char* names[] = { "cpu_ms", "gpu_ms", "frame_ms" };
+		Statistics statistics[] = {
+			Summarize(Column(samples, &FrameSample::cpu_ms)),
+			Summarize(Column(samples, &FrameSample::gpu_ms)),
+			Summarize(Column(samples, &FrameSample::frame_ms)),
+		};
+		for (int i = 0; i < 3; i++) {
+			if (statistics[i].valid)
+				printf("  %-9s min %8.3f  avg %8.3f  p50 %8.3f  p99 %8.3f  max %8.3f\n", names[i], statistics[i].min, statistics[i].avg, statistics[i].p50, statistics[i].p99, statistics[i].max);
+		}
+		Statistics drawCalls = Summarize(Column(samples, &FrameSample::draw_calls));
+		Statistics triangles = Summarize(Column(samples, &FrameSample::triangles));
+		Statistics visible = Summarize(Column(samples, &FrameSample::visible));
+		printf("  avg %.1f draw calls, %.0f triangles, %.1f visible objects per frame\n", drawCalls.avg, triangles.avg, visible.avg);
+	}
+}
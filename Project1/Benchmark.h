@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+/*
+The measurements of one frame of a benchmark run
+*/
+struct FrameSample {
+	double cpu_ms = 0.0; // The time the CPU spent on the frame, from the start of the frame until every GL call was made
+	double gpu_ms = -1.0; // The time the GPU spent on the frame, measured with a GL_TIME_ELAPSED query, -1 without timer queries
+	double frame_ms = 0.0; // The time since the start of the previous frame, includes the driver waiting for the GPU
+	int draw_calls = 0; // The amount of draw calls
+	int commands = 0; // The amount of multi draw indirect commands, 0 for the instanced renderer
+	int visible = 0; // The amount of objects that were not culled
+	size_t triangles = 0; // The amount of triangles drawn, 0 when the renderer doesn't count them
+};
+
+/*
+What a benchmark run measured, written at the top of the JSON file so runs can be compared
+*/
+struct BenchmarkInfo {
+	std::string renderer; // "indirect" or "instanced"
+	bool lod = true; // If the levels of detail were used
+	std::string texture_filter; // The name of the TextureFilter
+	int warmup = 0; // The amount of frames drawn before measuring
+	int width = 0, height = 0; // The size of the framebuffer
+};
+
+/*
+Runs the scene without a window: an offscreen EGL context (surfaceless on Mesa, so it works on llvmpipe without a GPU or display server)
+that draws into a framebuffer object, a camera path that is the same on every run, and per frame CPU and GPU timers.
+The GPU timers are read QUERY_LAG frames late so measuring doesn't make the CPU wait for the GPU
+*/
+namespace Benchmark {
+	const int QUERY_LAG = 4; // The amount of GPU timer queries in flight
+
+	// Documented in Benchmark.cpp
+	bool CreateContext(int width, int height);
+	void DestroyContext();
+	void GetCameraPath(float t, glm::vec3& position, glm::vec3& front);
+	void BeginFrame();
+	void EndFrame(const FrameSample& counts);
+	const std::vector<FrameSample>& Finish();
+	bool WriteCsv(const std::string& path, const std::vector<FrameSample>& samples);
+	bool WriteJson(const std::string& path, const BenchmarkInfo& info, const std::vector<FrameSample>& samples);
+	void PrintSummary(const BenchmarkInfo& info, const std::vector<FrameSample>& samples);
+}
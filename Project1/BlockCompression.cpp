@@ -0,0 +1,560 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLOCK_COMPRESSION_SSE
+#endif
+
+#include "BlockCompression.h"
+
+namespace BlockCompression {
+	const int REFINE_ITERATIONS = 2; // The amount of least squares passes CompressionQuality::HIGH makes over its endpoints
+	const int POWER_ITERATIONS = 8; // The amount of power iterations used to find the principal axis of the colours
+
+	/*
+	The colours of the 16 pixels of a block as planar floats, so four pixels fit in one SSE register
+	*/
+	struct Block {
+		float r[16], g[16], b[16];
+	};
+
+	/*
+	Statistics of the colours of a block
+	*/
+	struct BlockStatistics {
+		float mean[3]; // The average colour
+		float minimum[3], maximum[3]; // The bounding box of the colours
+		float covariance[6]; // The covariance matrix: rr, rg, rb, gg, gb, bb
+	};
+
+	/*
+	The two end colours of a block, before they are quantized to 565
+	*/
+	struct Endpoints {
+		float c0[3], c1[3];
+	};
+
+	/*
+	Returns the amount of bytes the blocks of an image take
+	@param width - The width of the image in pixels
+	@param height - The height of the image in pixels
+	@param format - The block format
+	@returns The size in bytes, images that are not a multiple of 4 are padded to whole blocks
+	*/
+	size_t GetCompressedSize(unsigned int width, unsigned int height, BlockFormat format) {
+		size_t blockSize = format == BlockFormat::BC1 ? 8 : 16;
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+	}
+
+	/*
+	Splits the colours of 16 RGBA pixels into planar floats
+	*/
+	static void LoadBlock(const unsigned char* rgba, Block& block) {
+		for (int i = 0; i < 16; i++) {
+			block.r[i] = rgba[i * 4];
+			block.g[i] = rgba[i * 4 + 1];
+			block.b[i] = rgba[i * 4 + 2];
+		}
+	}
+
+#ifdef BLOCK_COMPRESSION_SSE
+	/*
+	@returns The sum of the four lanes
+	*/
+	static float HorizontalSum(__m128 v) {
+		__m128 pairs = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+
+	/*
+	@returns The smallest of the four lanes
+	*/
+	static float HorizontalMin(__m128 v) {
+		__m128 pairs = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(_mm_min_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+
+	/*
+	@returns The largest of the four lanes
+	*/
+	static float HorizontalMax(__m128 v) {
+		__m128 pairs = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(_mm_max_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+#endif
+
+	/*
+	Calculates the mean, bounding box and covariance of the colours of a block
+	*/
+	static void GetStatistics(const Block& block, BlockStatistics& stats) {
+		const float* channels[3] = { block.r, block.g, block.b };
+#ifdef BLOCK_COMPRESSION_SSE
+		__m128 centered[3][4];
+		for (int c = 0; c < 3; c++) {
+			__m128 v[4];
+			for (int i = 0; i < 4; i++)
+				v[i] = _mm_loadu_ps(channels[c] + i * 4);
+			stats.mean[c] = HorizontalSum(_mm_add_ps(_mm_add_ps(v[0], v[1]), _mm_add_ps(v[2], v[3]))) / 16.0f;
+			stats.minimum[c] = HorizontalMin(_mm_min_ps(_mm_min_ps(v[0], v[1]), _mm_min_ps(v[2], v[3])));
+			stats.maximum[c] = HorizontalMax(_mm_max_ps(_mm_max_ps(v[0], v[1]), _mm_max_ps(v[2], v[3])));
+			__m128 mean = _mm_set1_ps(stats.mean[c]);
+			for (int i = 0; i < 4; i++)
+				centered[c][i] = _mm_sub_ps(v[i], mean);
+		}
+		int entry = 0;
+		for (int a = 0; a < 3; a++) {
+			for (int b = a; b < 3; b++) {
+				__m128 sum = _mm_setzero_ps();
+				for (int i = 0; i < 4; i++)
+					sum = _mm_add_ps(sum, _mm_mul_ps(centered[a][i], centered[b][i]));
+				stats.covariance[entry++] = HorizontalSum(sum);
+			}
+		}
+#else
+		for (int c = 0; c < 3; c++) {
+			float sum = 0;
+			stats.minimum[c] = stats.maximum[c] = channels[c][0];
+			for (int i = 0; i < 16; i++) {
+				sum += channels[c][i];
+				stats.minimum[c] = std::min(stats.minimum[c], channels[c][i]);
+				stats.maximum[c] = std::max(stats.maximum[c], channels[c][i]);
+			}
+			stats.mean[c] = sum / 16.0f;
+		}
+		int entry = 0;
+		for (int a = 0; a < 3; a++) {
+			for (int b = a; b < 3; b++) {
+				float sum = 0;
+				for (int i = 0; i < 16; i++)
+					sum += (channels[a][i] - stats.mean[a]) * (channels[b][i] - stats.mean[b]);
+				stats.covariance[entry++] = sum;
+			}
+		}
+#endif
+	}
+
+	/*
+	Picks the closest palette colour for every pixel
+	@param block - The pixels
+	@param palette - The four colours of the block, in the order of their indices
+	@param indices - Set to the index of every pixel
+	@returns The sum of the squared errors
+	*/
+	static float SelectIndices(const Block& block, const float palette[4][3], unsigned char indices[16]) {
+		float error = 0;
+		int i = 0;
+#ifdef BLOCK_COMPRESSION_SSE
+		__m128 total = _mm_setzero_ps();
+		for (; i < 16; i += 4) {
+			__m128 r = _mm_loadu_ps(block.r + i);
+			__m128 g = _mm_loadu_ps(block.g + i);
+			__m128 b = _mm_loadu_ps(block.b + i);
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int p = 0; p < 4; p++) {
+				__m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[p][0]));
+				__m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[p][1]));
+				__m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[p][2]));
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex), _mm_and_si128(closer, _mm_set1_epi32(p)));
+			}
+			total = _mm_add_ps(total, best);
+			int32_t lanes[4];
+			_mm_storeu_si128((__m128i*)lanes, bestIndex);
+			for (int lane = 0; lane < 4; lane++)
+				indices[i + lane] = (unsigned char)lanes[lane];
+		}
+		error = HorizontalSum(total);
+#endif
+		// All pixels without SSE
+		for (; i < 16; i++) {
+			float best = FLT_MAX;
+			for (int p = 0; p < 4; p++) {
+				float dr = block.r[i] - palette[p][0];
+				float dg = block.g[i] - palette[p][1];
+				float db = block.b[i] - palette[p][2];
+				float distance = dr * dr + dg * dg + db * db;
+				if (distance < best) {
+					best = distance;
+					indices[i] = (unsigned char)p;
+				}
+			}
+			error += best;
+		}
+		return error;
+	}
+
+	/*
+	Quantizes a colour to 5 bits of red, 6 of green and 5 of blue
+	*/
+	static uint16_t To565(const float colour[3]) {
+		int r = (int)std::min(std::max(colour[0], 0.0f), 255.0f);
+		int g = (int)std::min(std::max(colour[1], 0.0f), 255.0f);
+		int b = (int)std::min(std::max(colour[2], 0.0f), 255.0f);
+		return (uint16_t)(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+	}
+
+	/*
+	Expands a 565 colour to 8 bits per channel the way the GPU does, by repeating the high bits
+	*/
+	static void From565(uint16_t packed, int colour[3]) {
+		int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+		colour[0] = (r << 3) | (r >> 2);
+		colour[1] = (g << 2) | (g >> 4);
+		colour[2] = (b << 3) | (b >> 2);
+	}
+
+	/*
+	Makes the four colours of a block in 4-colour mode
+	*/
+	static void GetPalette(uint16_t q0, uint16_t q1, int palette[4][3]) {
+		From565(q0, palette[0]);
+		From565(q1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	}
+
+	/*
+	Encodes the colours of a block with the given endpoints, always in 4-colour mode so the block is valid for BC1 and BC3 alike
+	@param block - The pixels
+	@param endpoints - The end colours, they are swapped if needed
+	@param indices - Set to the index of every pixel
+	@param out - Set to the 8 bytes of the colour block
+	@returns The sum of the squared errors
+	*/
+	static float EncodeColours(const Block& block, const Endpoints& endpoints, unsigned char indices[16], unsigned char* out) {
+		uint16_t q0 = To565(endpoints.c0), q1 = To565(endpoints.c1);
+		if (q0 < q1)
+			std::swap(q0, q1);
+
+		int palette[4][3];
+		GetPalette(q0, q1, palette);
+		float floatPalette[4][3];
+		for (int p = 0; p < 4; p++) {
+			for (int c = 0; c < 3; c++)
+				floatPalette[p][c] = (float)(q0 == q1 ? palette[0][c] : palette[p][c]);
+		}
+		float error = SelectIndices(block, floatPalette, indices);
+
+		out[0] = (unsigned char)(q0 & 0xFF);
+		out[1] = (unsigned char)(q0 >> 8);
+		out[2] = (unsigned char)(q1 & 0xFF);
+		out[3] = (unsigned char)(q1 >> 8);
+		for (int row = 0; row < 4; row++) {
+			unsigned char bits = 0;
+			for (int column = 0; column < 4; column++)
+				bits |= (q0 == q1 ? 0 : indices[row * 4 + column]) << (column * 2);
+			out[4 + row] = bits;
+		}
+		return error;
+	}
+
+	/*
+	The corners of the bounding box of the colours, moved inwards a bit since the extremes are rarely worth a palette entry.
+	The diagonal of the box is chosen by the sign of the covariance of red and blue with green
+	*/
+	static Endpoints GetBoxEndpoints(const BlockStatistics& stats) {
+		Endpoints endpoints;
+		for (int c = 0; c < 3; c++) {
+			float inset = (stats.maximum[c] - stats.minimum[c]) / 16.0f;
+			endpoints.c0[c] = stats.maximum[c] - inset;
+			endpoints.c1[c] = stats.minimum[c] + inset;
+		}
+		if (stats.covariance[1] < 0)
+			std::swap(endpoints.c0[0], endpoints.c1[0]);
+		if (stats.covariance[4] < 0)
+			std::swap(endpoints.c0[2], endpoints.c1[2]);
+		return endpoints;
+	}
+
+	/*
+	The ends of the principal axis of the colours, found by power iteration on the covariance matrix
+	@returns False if the colours have no clear axis (e.g. a single colour)
+	*/
+	static bool GetAxisEndpoints(const Block& block, const BlockStatistics& stats, Endpoints& endpoints) {
+		const float* cov = stats.covariance;
+		float axis[3] = { stats.maximum[0] - stats.minimum[0], stats.maximum[1] - stats.minimum[1], stats.maximum[2] - stats.minimum[2] };
+		for (int i = 0; i < POWER_ITERATIONS; i++) {
+			float next[3] = {
+				cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+				cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+				cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2],
+			};
+			float length = std::max(std::max(fabsf(next[0]), fabsf(next[1])), fabsf(next[2]));
+			if (length < 1e-6f)
+				return false;
+			for (int c = 0; c < 3; c++)
+				axis[c] = next[c] / length;
+		}
+
+		float lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		float low = FLT_MAX, high = -FLT_MAX;
+		for (int i = 0; i < 16; i++) {
+			float t = ((block.r[i] - stats.mean[0]) * axis[0] + (block.g[i] - stats.mean[1]) * axis[1] + (block.b[i] - stats.mean[2]) * axis[2]) / lengthSquared;
+			low = std::min(low, t);
+			high = std::max(high, t);
+		}
+		for (int c = 0; c < 3; c++) {
+			endpoints.c0[c] = stats.mean[c] + axis[c] * high;
+			endpoints.c1[c] = stats.mean[c] + axis[c] * low;
+		}
+		return true;
+	}
+
+	/*
+	Finds the endpoints that fit the given indices best, by solving the least squares problem for both end colours at once
+	@returns False if the indices don't determine the endpoints (all pixels use the same weight)
+	*/
+	static bool RefineEndpoints(const Block& block, const unsigned char indices[16], Endpoints& endpoints) {
+		static const float WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f }; // The weight of c0 for every index
+		const float* channels[3] = { block.r, block.g, block.b };
+		float aa = 0, ab = 0, bb = 0;
+		float ax[3] = {}, bx[3] = {};
+		for (int i = 0; i < 16; i++) {
+			float a = WEIGHTS[indices[i]];
+			float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < 3; c++) {
+				ax[c] += a * channels[c][i];
+				bx[c] += b * channels[c][i];
+			}
+		}
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+			return false;
+		for (int c = 0; c < 3; c++) {
+			endpoints.c0[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+			endpoints.c1[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	/*
+	Encodes the colours of a block, trying more endpoints for CompressionQuality::HIGH and keeping the ones with the smallest error
+	*/
+	static void EncodeColourBlock(const unsigned char* rgba, CompressionQuality quality, unsigned char* out) {
+		Block block;
+		LoadBlock(rgba, block);
+		BlockStatistics stats;
+		GetStatistics(block, stats);
+
+		unsigned char indices[16];
+		float error = EncodeColours(block, GetBoxEndpoints(stats), indices, out);
+		if (quality == CompressionQuality::FAST || error == 0)
+			return;
+
+		unsigned char candidate[8], candidateIndices[16];
+		Endpoints endpoints;
+		if (GetAxisEndpoints(block, stats, endpoints)) {
+			float candidateError = EncodeColours(block, endpoints, candidateIndices, candidate);
+			if (candidateError < error) {
+				error = candidateError;
+				memcpy(out, candidate, 8);
+				memcpy(indices, candidateIndices, 16);
+			}
+		}
+		for (int i = 0; i < REFINE_ITERATIONS; i++) {
+			if (!RefineEndpoints(block, indices, endpoints))
+				break;
+			float candidateError = EncodeColours(block, endpoints, candidateIndices, candidate);
+			if (candidateError >= error)
+				break;
+			error = candidateError;
+			memcpy(out, candidate, 8);
+			memcpy(indices, candidateIndices, 16);
+		}
+	}
+
+	/*
+	Makes the eight alphas of a BC3 alpha block, in the order of their indices
+	*/
+	static void GetAlphaPalette(int a0, int a1, int palette[8]) {
+		palette[0] = a0;
+		palette[1] = a1;
+		for (int i = 2; i < 8; i++)
+			palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+	}
+
+	/*
+	Encodes the alpha of a block between its smallest and largest alpha, in 8-alpha mode
+	*/
+	static void EncodeAlphaBlock(const unsigned char* rgba, unsigned char* out) {
+		int low = 255, high = 0;
+		for (int i = 0; i < 16; i++) {
+			low = std::min(low, (int)rgba[i * 4 + 3]);
+			high = std::max(high, (int)rgba[i * 4 + 3]);
+		}
+		out[0] = (unsigned char)high;
+		out[1] = (unsigned char)low;
+
+		uint64_t bits = 0;
+		if (high != low) {
+			int palette[8];
+			GetAlphaPalette(high, low, palette);
+			for (int i = 0; i < 16; i++) {
+				int alpha = rgba[i * 4 + 3];
+				int best = 0;
+				for (int p = 1; p < 8; p++) {
+					if (std::abs(palette[p] - alpha) < std::abs(palette[best] - alpha))
+						best = p;
+				}
+				bits |= (uint64_t)best << (i * 3);
+			}
+		}
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = (unsigned char)(bits >> (i * 8));
+	}
+
+	/*
+	Encodes one block
+	@param rgba - The 16 RGBA pixels of the block, row by row
+	@param format - The block format
+	@param quality - How hard to look for the best endpoints
+	@param block - Set to the 8 (BC1) or 16 (BC3) bytes of the block
+	*/
+	void EncodeBlock(const unsigned char* rgba, BlockFormat format, CompressionQuality quality, unsigned char* block) {
+		if (format == BlockFormat::BC3) {
+			EncodeAlphaBlock(rgba, block);
+			block += 8;
+		}
+		EncodeColourBlock(rgba, quality, block);
+	}
+
+	/*
+	Decodes one block the way the GPU does
+	@param block - The 8 (BC1) or 16 (BC3) bytes of the block
+	@param format - The block format
+	@param rgba - Set to the 16 RGBA pixels of the block, row by row
+	*/
+	void DecodeBlock(const unsigned char* block, BlockFormat format, unsigned char* rgba) {
+		const unsigned char* colours = block;
+		if (format == BlockFormat::BC3)
+			colours += 8;
+
+		uint16_t q0 = (uint16_t)(colours[0] | colours[1] << 8);
+		uint16_t q1 = (uint16_t)(colours[2] | colours[3] << 8);
+		int palette[4][3];
+		int paletteAlpha[4] = { 255, 255, 255, 255 };
+		GetPalette(q0, q1, palette);
+		// BC1 blocks with q0 <= q1 have three colours and transparent black, BC3 colour blocks are always 4-colour
+		if (format == BlockFormat::BC1 && q0 <= q1) {
+			for (int c = 0; c < 3; c++) {
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			paletteAlpha[3] = 0;
+		}
+		for (int i = 0; i < 16; i++) {
+			int index = (colours[4 + i / 4] >> ((i % 4) * 2)) & 3;
+			for (int c = 0; c < 3; c++)
+				rgba[i * 4 + c] = (unsigned char)palette[index][c];
+			rgba[i * 4 + 3] = (unsigned char)paletteAlpha[index];
+		}
+
+		if (format == BlockFormat::BC3) {
+			int alphas[8];
+			if (block[0] > block[1]) {
+				GetAlphaPalette(block[0], block[1], alphas);
+			} else {
+				alphas[0] = block[0];
+				alphas[1] = block[1];
+				for (int i = 2; i < 6; i++)
+					alphas[i] = ((6 - i) * block[0] + (i - 1) * block[1]) / 5;
+				alphas[6] = 0;
+				alphas[7] = 255;
+			}
+			uint64_t bits = 0;
+			for (int i = 0; i < 6; i++)
+				bits |= (uint64_t)block[2 + i] << (i * 8);
+			for (int i = 0; i < 16; i++)
+				rgba[i * 4 + 3] = (unsigned char)alphas[(bits >> (i * 3)) & 7];
+		}
+	}
+
+	/*
+	Compresses a whole image, blocks on the right and top edge repeat the last column and row of pixels
+	@param rgba - The pixels, row by row
+	@param width - The width of the image
+	@param height - The height of the image
+	@param format - The block format
+	@param quality - How hard to look for the best endpoints
+	@returns The blocks, row by row
+	*/
+	std::vector<unsigned char> Compress(const unsigned char* rgba, unsigned int width, unsigned int height, BlockFormat format, CompressionQuality quality) {
+		size_t blockSize = format == BlockFormat::BC1 ? 8 : 16;
+		std::vector<unsigned char> blocks(GetCompressedSize(width, height, format));
+		unsigned char pixels[64];
+		unsigned char* out = blocks.data();
+		for (unsigned int by = 0; by < height; by += 4) {
+			for (unsigned int bx = 0; bx < width; bx += 4) {
+				for (unsigned int y = 0; y < 4; y++) {
+					unsigned int sy = std::min(by + y, height - 1);
+					for (unsigned int x = 0; x < 4; x++) {
+						unsigned int sx = std::min(bx + x, width - 1);
+						memcpy(pixels + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+					}
+				}
+				EncodeBlock(pixels, format, quality, out);
+				out += blockSize;
+			}
+		}
+		return blocks;
+	}
+
+	/*
+	Decodes the blocks of a whole image, to measure what the compression lost
+	@param blocks - The blocks, row by row
+	@param width - The width of the image
+	@param height - The height of the image
+	@param format - The block format
+	@returns The RGBA pixels, row by row
+	*/
+	std::vector<unsigned char> Decompress(const unsigned char* blocks, unsigned int width, unsigned int height, BlockFormat format) {
+		size_t blockSize = format == BlockFormat::BC1 ? 8 : 16;
+		std::vector<unsigned char> rgba((size_t)width * height * 4);
+		unsigned char pixels[64];
+		for (unsigned int by = 0; by < height; by += 4) {
+			for (unsigned int bx = 0; bx < width; bx += 4) {
+				DecodeBlock(blocks, format, pixels);
+				blocks += blockSize;
+				for (unsigned int y = 0; y < 4 && by + y < height; y++) {
+					for (unsigned int x = 0; x < 4 && bx + x < width; x++)
+						memcpy(&rgba[((size_t)(by + y) * width + bx + x) * 4], pixels + (y * 4 + x) * 4, 4);
+				}
+			}
+		}
+		return rgba;
+	}
+
+	/*
+	Measures the peak signal to noise ratio of the colours of two images, alpha is ignored
+	@param rgbaA - The pixels of the first image
+	@param rgbaB - The pixels of the second image
+	@param pixelCount - The amount of pixels in both
+	@returns The PSNR in dB, infinity if the images are the same
+	*/
+	double ComputePSNR(const unsigned char* rgbaA, const unsigned char* rgbaB, size_t pixelCount) {
+		double sum = 0;
+		for (size_t i = 0; i < pixelCount; i++) {
+			for (int c = 0; c < 3; c++) {
+				double difference = (double)rgbaA[i * 4 + c] - rgbaB[i * 4 + c];
+				sum += difference * difference;
+			}
+		}
+		if (sum == 0)
+			return std::numeric_limits<double>::infinity();
+		double mse = sum / (pixelCount * 3.0);
+		return 10.0 * std::log10(255.0 * 255.0 / mse);
+	}
+}
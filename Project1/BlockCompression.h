@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/*
+The block formats the encoder can write, both store 4x4 pixels per block
+*/
+enum class BlockFormat {
+	BC1, // 8 bytes per block, RGB (DXT1)
+	BC3, // 16 bytes per block, RGB plus a separately interpolated alpha (DXT5)
+};
+
+/*
+How much time the encoder spends on the endpoints of every block
+*/
+enum class CompressionQuality {
+	FAST, // The inset bounding box of the colours
+	HIGH, // The principal axis of the colours, refined by least squares
+};
+
+/*
+A CPU encoder for the S3TC block formats, with an SSE2 path for the per-block maths.
+Images are RGBA8, the blocks are written in the same row order as the pixels (so BMP images stay bottom-up, like GL expects)
+*/
+namespace BlockCompression {
+	// Documented in BlockCompression.cpp
+	size_t GetCompressedSize(unsigned int width, unsigned int height, BlockFormat format);
+	void EncodeBlock(const unsigned char* rgba, BlockFormat format, CompressionQuality quality, unsigned char* block);
+	void DecodeBlock(const unsigned char* block, BlockFormat format, unsigned char* rgba);
+	std::vector<unsigned char> Compress(const unsigned char* rgba, unsigned int width, unsigned int height, BlockFormat format, CompressionQuality quality);
+	std::vector<unsigned char> Decompress(const unsigned char* blocks, unsigned int width, unsigned int height, BlockFormat format);
+	double ComputePSNR(const unsigned char* rgbaA, const unsigned char* rgbaB, size_t pixelCount);
+}
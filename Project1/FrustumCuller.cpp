@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE
+#endif
+
+#include "FrustumCuller.h"
+
+FrustumCuller::FrustumCuller() {
+	m_VisibleCount = 0;
+}
+
+/*
+Removes all objects, keeping the memory for the next frame
+*/
+void FrustumCuller::Clear() {
+	m_CenterX.clear();
+	m_CenterY.clear();
+	m_CenterZ.clear();
+	m_Radius.clear();
+	m_ExtentX.clear();
+	m_ExtentY.clear();
+	m_ExtentZ.clear();
+	m_Visible.clear();
+	m_VisibleCount = 0;
+}
+
+/*
+Adds the bounds of an object, transformed to world space
+@param model - The model matrix of the object
+@param mesh - The mesh of the object, its bounds were calculated when it was loaded
+@returns The index of the object, to pass to IsVisible
+*/
+size_t FrustumCuller::Add(const glm::mat4& model, const MeshData& mesh) {
+	glm::vec3 center, worldExtent;
+	float radius;
+	mesh.TransformBounds(model, center, worldExtent, radius);
+	return Add(center, worldExtent, radius);
+}
+
+/*
+Adds bounds that are already in world space
+@param center - The center of the bounds
+@param extent - The half size of the bounding box
+@param radius - The radius of the bounding sphere
+@returns The index of the object, to pass to IsVisible
+*/
+size_t FrustumCuller::Add(const glm::vec3& center, const glm::vec3& extent, float radius) {
+	m_CenterX.push_back(center.x);
+	m_CenterY.push_back(center.y);
+	m_CenterZ.push_back(center.z);
+	m_Radius.push_back(radius);
+	m_ExtentX.push_back(extent.x);
+	m_ExtentY.push_back(extent.y);
+	m_ExtentZ.push_back(extent.z);
+	m_Visible.push_back(1);
+	return m_Visible.size() - 1;
+}
+
+/*
+Tests every object against the frustum of the camera
+@param viewProjection - The projection matrix times the view matrix
+@returns The amount of visible objects
+*/
+int FrustumCuller::Cull(const glm::mat4& viewProjection) {
+	// Gribb-Hartmann: the planes are sums and differences of the rows of the matrix (glm is column major)
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; r++)
+		rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+	for (int axis = 0; axis < 3; axis++) {
+		m_Planes[axis * 2] = rows[3] + rows[axis];
+		m_Planes[axis * 2 + 1] = rows[3] - rows[axis];
+	}
+	for (int p = 0; p < 6; p++)
+		m_Planes[p] = m_Planes[p] * (1.0f / glm::length(glm::vec3(m_Planes[p])));
+
+	size_t count = m_Visible.size();
+	size_t i = 0;
+	m_VisibleCount = 0;
+
+#ifdef FRUSTUM_CULLER_SSE
+	__m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+	for (int p = 0; p < 6; p++) {
+		nx[p] = _mm_set1_ps(m_Planes[p].x);
+		ny[p] = _mm_set1_ps(m_Planes[p].y);
+		nz[p] = _mm_set1_ps(m_Planes[p].z);
+		nw[p] = _mm_set1_ps(m_Planes[p].w);
+		ax[p] = _mm_set1_ps(fabsf(m_Planes[p].x));
+		ay[p] = _mm_set1_ps(fabsf(m_Planes[p].y));
+		az[p] = _mm_set1_ps(fabsf(m_Planes[p].z));
+	}
+	for (; i + 4 <= count; i += 4) {
+		__m128 cx = _mm_loadu_ps(&m_CenterX[i]);
+		__m128 cy = _mm_loadu_ps(&m_CenterY[i]);
+		__m128 cz = _mm_loadu_ps(&m_CenterZ[i]);
+		__m128 radius = _mm_loadu_ps(&m_Radius[i]);
+		__m128 ex = _mm_loadu_ps(&m_ExtentX[i]);
+		__m128 ey = _mm_loadu_ps(&m_ExtentY[i]);
+		__m128 ez = _mm_loadu_ps(&m_ExtentZ[i]);
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_add_ps(_mm_mul_ps(nz[p], cz), nw[p]));
+			__m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+			__m128 reach = _mm_min_ps(radius, boxRadius);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+		}
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; lane++) {
+			m_Visible[i + lane] = (mask >> lane) & 1;
+			m_VisibleCount += (mask >> lane) & 1;
+		}
+	}
+#endif
+
+	// The objects that don't fill a group of 4, or all of them without SSE
+	for (; i < count; i++) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++) {
+			const glm::vec4& plane = m_Planes[p];
+			float distance = plane.x * m_CenterX[i] + plane.y * m_CenterY[i] + plane.z * m_CenterZ[i] + plane.w;
+			float boxRadius = fabsf(plane.x) * m_ExtentX[i] + fabsf(plane.y) * m_ExtentY[i] + fabsf(plane.z) * m_ExtentZ[i];
+			inside = distance + std::min(m_Radius[i], boxRadius) >= 0.0f;
+		}
+		m_Visible[i] = inside ? 1 : 0;
+		m_VisibleCount += inside ? 1 : 0;
+	}
+	return m_VisibleCount;
+}
+
+/*
+@param index - The index returned by Add
+@returns If the object was (partly) inside the frustum at the last Cull
+*/
+bool FrustumCuller::IsVisible(size_t index) const {
+	return m_Visible[index] != 0;
+}
+
+/*
+@returns The amount of objects
+*/
+size_t FrustumCuller::GetCount() const {
+	return m_Visible.size();
+}
+
+/*
+@returns The amount of visible objects of the last Cull
+*/
+int FrustumCuller::GetVisibleCount() const {
+	return m_VisibleCount;
+}
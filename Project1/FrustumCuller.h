@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+
+/*
+Tests the world space bounds of many objects against the view frustum in one pass.
+The bounds are kept as a structure of arrays so the test runs on 4 objects at a time with SSE (a scalar loop is used without SSE).
+An object is culled when its bounding sphere or its bounding box, whichever is tighter for a plane, lies fully outside one of the 6 planes
+*/
+class FrustumCuller {
+private:
+	std::vector<float> m_CenterX, m_CenterY, m_CenterZ; // The world space centers of the bounds
+	std::vector<float> m_Radius; // The world space radii of the bounding spheres
+	std::vector<float> m_ExtentX, m_ExtentY, m_ExtentZ; // The world space half sizes of the bounding boxes
+	std::vector<unsigned char> m_Visible; // 1 if the object is (partly) inside the frustum, set by Cull
+	glm::vec4 m_Planes[6]; // The frustum planes of the last Cull, normals pointing inwards
+	int m_VisibleCount; // The amount of visible objects of the last Cull
+
+public:
+	// Methods are documented in FrustumCuller.cpp
+	FrustumCuller();
+	void Clear();
+	size_t Add(const glm::mat4& model, const MeshData& mesh);
+	size_t Add(const glm::vec3& center, const glm::vec3& extent, float radius);
+	int Cull(const glm::mat4& viewProjection);
+	bool IsVisible(size_t index) const;
+	size_t GetCount() const;
+	int GetVisibleCount() const;
+};
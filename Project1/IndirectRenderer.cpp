@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+
+#include "IndirectRenderer.h"
+#include "StateCache.h"
+#include "ObjectStore.h"
+#include "TextureArrays.h"
+
+const float DEFAULT_LOD_THRESHOLD = 1.0f; // The screen space error in pixels a level of detail may have
+const float LOD_HYSTERESIS = 0.75f; // The part of the threshold the error of a coarser level must stay below before it is taken
+const float MIN_LOD_DISTANCE = 0.1f; // The distance used for objects around the camera, the near plane
+
+/*
+The commands of one glMultiDrawElementsIndirect, they share a program and an arena
+*/
+struct MultiDraw {
+	size_t batch; // The first batch of the draw, provides the program and the arena
+	GLsizei first; // The first command
+	GLsizei count; // The amount of commands
+};
+
+IndirectRenderer::IndirectRenderer() {
+	m_CommandBuffer = 0;
+	m_DrawDataBuffer = 0;
+	m_DrawIndexBuffer = 0;
+	m_DrawCalls = 0;
+	m_LodThreshold = DEFAULT_LOD_THRESHOLD;
+	m_LodEnabled = true;
+	m_Triangles = 0;
+	m_FullTriangles = 0;
+}
+
+/*
+@returns The amount of indices of a model including its levels of detail, which follow the full model in its index buffer
+*/
+static GLsizei GetStoredIndexCount(const MeshBuffers& buffers) {
+	return (GLsizei)buffers.lods.back().first_index + buffers.lods.back().index_count;
+}
+
+/*
+Destructor, deletes the GL objects
+*/
+IndirectRenderer::~IndirectRenderer() {
+	Clear();
+}
+
+/*
+Groups the objects into batches by model and program, copies the models into the arenas and makes the buffers of the commands.
+Must be called after the buffers of the objects were initialised, and again whenever objects are added, removed or change model or shader.
+Textures, materials and lights are read every frame, changing them needs no rebuild
+@param objects - The objects to draw
+*/
+void IndirectRenderer::Build(const std::vector<SceneObject*>& objects) {
+	Clear();
+	size_t objectCount = 0;
+	for (size_t i = 0; i < objects.size(); i++) {
+		SceneObject* object = objects[i];
+		if (object == nullptr || object->GetBuffers() == nullptr)
+			continue;
+		size_t b = 0;
+		while (b < m_Batches.size() && (m_Batches[b].objects[0]->GetBuffers() != object->GetBuffers() || m_Batches[b].program != object->GetProgram()))
+			b++;
+		if (b == m_Batches.size()) {
+			m_Batches.push_back(IndirectBatch());
+			m_Batches[b].program = object->GetProgram();
+		}
+		m_Batches[b].objects.push_back(object);
+		m_Batches[b].ids.push_back(object->GetStoreId());
+		m_Batches[b].lods.push_back(0);
+		objectCount++;
+	}
+
+	std::vector<GLuint> programs;
+	size_t cullStart = 0;
+	for (size_t b = 0; b < m_Batches.size(); b++) {
+		IndirectBatch& batch = m_Batches[b];
+		batch.cull_start = cullStart;
+		cullStart += batch.ids.size();
+		batch.program_rank = (uint32_t)(std::find(programs.begin(), programs.end(), batch.program) - programs.begin());
+		if (batch.program_rank == programs.size())
+			programs.push_back(batch.program);
+		batch.uniform_indirect_draw = glGetUniformLocation(batch.program, "indirect_draw");
+	}
+
+	// An instance reads its DrawData entry at the value of this attribute, which is baseInstance + gl_InstanceID
+	std::vector<GLuint> drawIndices(objectCount);
+	std::iota(drawIndices.begin(), drawIndices.end(), 0u);
+	glGenBuffers(1, &m_DrawIndexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_DrawIndexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, drawIndices.size() * sizeof(GLuint), drawIndices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &m_CommandBuffer);
+	glGenBuffers(1, &m_DrawDataBuffer);
+	BuildArenas();
+}
+
+/*
+Puts the model of every batch in the arena of its vertex format and index type, copying the buffers of every model once
+*/
+void IndirectRenderer::BuildArenas() {
+	for (size_t b = 0; b < m_Batches.size(); b++) {
+		IndirectBatch& batch = m_Batches[b];
+		const MeshBuffers* buffers = batch.objects[0]->GetBuffers();
+		size_t a = 0;
+		while (a < m_Arenas.size() && (m_Arenas[a].format != buffers->format || m_Arenas[a].index_type != buffers->index_type))
+			a++;
+		if (a == m_Arenas.size()) {
+			m_Arenas.push_back(MeshArena());
+			m_Arenas[a].format = buffers->format;
+			m_Arenas[a].index_type = buffers->index_type;
+		}
+		MeshArena& arena = m_Arenas[a];
+		batch.arena = a;
+		batch.mesh = std::find(arena.meshes.begin(), arena.meshes.end(), buffers) - arena.meshes.begin();
+		if (batch.mesh == arena.meshes.size())
+			arena.meshes.push_back(buffers);
+	}
+
+	for (size_t a = 0; a < m_Arenas.size(); a++) {
+		MeshArena& arena = m_Arenas[a];
+		size_t indexSize = arena.index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+		size_t vertexBytes = 0, indexBytes = 0;
+		for (size_t m = 0; m < arena.meshes.size(); m++) {
+			vertexBytes += (size_t)arena.meshes[m]->vertex_count * arena.meshes[m]->packed.stride;
+			indexBytes += (size_t)GetStoredIndexCount(*arena.meshes[m]) * indexSize;
+		}
+
+		// Copy the models one after the other with their levels of detail, the indices stay relative to the first vertex of their model
+		glGenBuffers(1, &arena.vbo);
+		glGenBuffers(1, &arena.ibo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, arena.vbo);
+		glBufferData(GL_COPY_WRITE_BUFFER, vertexBytes, nullptr, GL_STATIC_DRAW);
+		GLint vertex = 0;
+		size_t offset = 0;
+		for (size_t m = 0; m < arena.meshes.size(); m++) {
+			const MeshBuffers* mesh = arena.meshes[m];
+			size_t bytes = (size_t)mesh->vertex_count * mesh->packed.stride;
+			glBindBuffer(GL_COPY_READ_BUFFER, mesh->vbo);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset, bytes);
+			arena.base_vertex.push_back(vertex);
+			vertex += mesh->vertex_count;
+			offset += bytes;
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, arena.ibo);
+		glBufferData(GL_COPY_WRITE_BUFFER, indexBytes, nullptr, GL_STATIC_DRAW);
+		GLuint index = 0;
+		for (size_t m = 0; m < arena.meshes.size(); m++) {
+			const MeshBuffers* mesh = arena.meshes[m];
+			glBindBuffer(GL_COPY_READ_BUFFER, mesh->ibo);
+			GLsizei count = GetStoredIndexCount(*mesh);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, index * indexSize, count * indexSize);
+			arena.first_index.push_back(index);
+			index += count;
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		glGenVertexArrays(1, &arena.vao);
+		glBindVertexArray(arena.vao);
+		glBindBuffer(GL_ARRAY_BUFFER, arena.vbo);
+		VertexPacking::SetupAttributes(arena.format);
+		glBindBuffer(GL_ARRAY_BUFFER, m_DrawIndexBuffer);
+		glVertexAttribIPointer(VertexAttribute::DRAW_INDEX, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+		glVertexAttribDivisor(VertexAttribute::DRAW_INDEX, 1);
+		glEnableVertexAttribArray(VertexAttribute::DRAW_INDEX);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.ibo);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+}
+
+/*
+Deletes all batches, arenas and buffers
+*/
+void IndirectRenderer::Clear() {
+	for (size_t a = 0; a < m_Arenas.size(); a++) {
+		glDeleteVertexArrays(1, &m_Arenas[a].vao);
+		glDeleteBuffers(1, &m_Arenas[a].vbo);
+		glDeleteBuffers(1, &m_Arenas[a].ibo);
+	}
+	if (m_CommandBuffer != 0) {
+		glDeleteBuffers(1, &m_CommandBuffer);
+		glDeleteBuffers(1, &m_DrawDataBuffer);
+		glDeleteBuffers(1, &m_DrawIndexBuffer);
+	}
+	m_CommandBuffer = m_DrawDataBuffer = m_DrawIndexBuffer = 0;
+	m_Arenas.clear();
+	m_Batches.clear();
+	m_Commands.clear();
+	m_DrawData.clear();
+}
+
+/*
+Culls the objects against the view frustum, writes the commands and DrawData of the visible ones and draws them with one multi draw per program and arena.
+ObjectStore::UpdateTransforms must have been called with the same view matrix, the culling and depth sorting use its results
+@param view - The view matrix
+@param projection - The projection matrix
+*/
+void IndirectRenderer::Render(const glm::mat4* view, const glm::mat4* projection) {
+	m_DrawCalls = 0;
+
+	const glm::mat4* models = ObjectStore::Models();
+	const glm::mat4* modelViews = ObjectStore::ModelViews();
+	const glm::vec3* centers = ObjectStore::WorldCenters();
+	const glm::vec3* extents = ObjectStore::WorldExtents();
+	const float* radii = ObjectStore::WorldRadii();
+	m_Culler.Clear();
+	for (size_t b = 0; b < m_Batches.size(); b++) {
+		const std::vector<uint32_t>& ids = m_Batches[b].ids;
+		for (size_t i = 0; i < ids.size(); i++) {
+			uint32_t index = ObjectStore::IndexOf(ids[i]);
+			m_Culler.Add(centers[index], extents[index], radii[index]);
+		}
+	}
+	m_Culler.Cull(*projection * *view);
+
+	// The arena takes the place of the vao in the key, so the commands of one multi draw are next to each other
+	m_Queue.Clear();
+	for (size_t b = 0; b < m_Batches.size(); b++) {
+		IndirectBatch& batch = m_Batches[b];
+		float depth = FLT_MAX; // The distance of the nearest visible object in the batch
+		for (size_t i = 0; i < batch.ids.size(); i++) {
+			if (m_Culler.IsVisible(batch.cull_start + i))
+				depth = std::min(depth, -modelViews[ObjectStore::IndexOf(batch.ids[i])][3].z);
+		}
+		if (depth != FLT_MAX)
+			m_Queue.Push(RenderQueue::MakeKey(batch.program_rank, 0, 0, (uint32_t)batch.arena, depth), (uint32_t)b);
+	}
+	m_Queue.Sort();
+
+	// The pixels one unit covers at a distance of one unit, the projected error of a level is its error times this, divided by the distance
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	float pixelsPerUnit = viewport[3] * 0.5f * (*projection)[1][1];
+
+	m_Commands.clear();
+	m_DrawData.clear();
+	m_Triangles = 0;
+	m_FullTriangles = 0;
+	std::vector<MultiDraw> draws;
+	const std::vector<DrawItem>& items = m_Queue.GetItems();
+	for (size_t item = 0; item < items.size(); item++) {
+		IndirectBatch& batch = m_Batches[items[item].index];
+		const MeshArena& arena = m_Arenas[batch.arena];
+		const MeshBuffers& buffers = *arena.meshes[batch.mesh];
+		if (draws.empty() || m_Batches[draws.back().batch].program != batch.program || m_Batches[draws.back().batch].arena != batch.arena)
+			draws.push_back(MultiDraw{ items[item].index, (GLsizei)m_Commands.size(), 0 });
+
+		// Measure the distance to the nearest point of the bounding sphere, the largest axis scale scales the error of the model
+		size_t visible = 0;
+		for (size_t i = 0; i < batch.ids.size(); i++) {
+			if (!m_Culler.IsVisible(batch.cull_start + i))
+				continue;
+			visible++;
+			if (!m_LodEnabled) {
+				batch.lods[i] = 0;
+				continue;
+			}
+			uint32_t index = ObjectStore::IndexOf(batch.ids[i]);
+			const glm::mat4& model = models[index];
+			float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+			float distance = std::max(glm::length(glm::vec3(*view * glm::vec4(centers[index], 1.0f))) - radii[index], MIN_LOD_DISTANCE);
+			batch.lods[i] = SelectLod(buffers, batch.lods[i], pixelsPerUnit * scale / distance);
+		}
+		m_FullTriangles += (size_t)buffers.index_count / 3 * visible;
+
+		// One command per level of detail in use
+		for (size_t lod = 0; lod < buffers.lods.size(); lod++) {
+			DrawElementsIndirectCommand command;
+			command.count = (GLuint)buffers.lods[lod].index_count;
+			command.instanceCount = 0;
+			command.firstIndex = arena.first_index[batch.mesh] + buffers.lods[lod].first_index;
+			command.baseVertex = arena.base_vertex[batch.mesh];
+			command.baseInstance = (GLuint)m_DrawData.size();
+			for (size_t i = 0; i < batch.ids.size(); i++) {
+				if (batch.lods[i] != lod || !m_Culler.IsVisible(batch.cull_start + i))
+					continue;
+				SceneObject* object = batch.objects[i];
+				const PackedVertices& packed = object->GetBuffers()->packed;
+				DrawData data;
+				data.model = models[ObjectStore::IndexOf(batch.ids[i])];
+				data.position_offset = glm::vec4(packed.position_offset, 0.0f);
+				data.position_scale = glm::vec4(packed.position_scale, 0.0f);
+				data.uv_offset_scale = glm::vec4(packed.uv_offset.x, packed.uv_offset.y, packed.uv_scale.x, packed.uv_scale.y);
+				data.layer = object->GetTexture()->GetSampledLayer();
+				data.material_index = object->GetMaterialIndex();
+				data.light_index = object->GetLightIndex();
+				data.oct_normals = packed.oct_normals ? 1 : 0;
+				m_DrawData.push_back(data);
+				command.instanceCount++;
+			}
+			if (command.instanceCount == 0)
+				continue;
+			m_Commands.push_back(command);
+			draws.back().count++;
+			m_Triangles += (size_t)command.count / 3 * command.instanceCount;
+		}
+	}
+	if (draws.empty())
+		return;
+
+	// Two uploads per frame, however many objects there are
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, m_Commands.size() * sizeof(DrawElementsIndirectCommand), m_Commands.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_DrawDataBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_DrawData.size() * sizeof(DrawData), m_DrawData.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, m_DrawDataBuffer);
+
+	StateCache::BindTexture(TextureArrays::GetName());
+	for (size_t d = 0; d < draws.size(); d++) {
+		const IndirectBatch& batch = m_Batches[draws[d].batch];
+		const MeshArena& arena = m_Arenas[batch.arena];
+		StateCache::UseProgram(batch.program);
+		StateCache::Uniform1i(batch.uniform_indirect_draw, 1);
+		StateCache::BindVertexArray(arena.vao);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, arena.index_type, (void*)(draws[d].first * sizeof(DrawElementsIndirectCommand)), draws[d].count, 0);
+		m_DrawCalls++;
+	}
+	StateCache::BindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/*
+Picks the level of detail of an object: finer while the error of its level shows on screen,
+then coarser while the error of the next level stays well below the threshold
+@param buffers - The model of the object
+@param current - The level the object was drawn with last
+@param pixelsPerUnit - The pixels one unit of the model covers at the distance of the object
+@returns The level to draw the object with
+*/
+unsigned char IndirectRenderer::SelectLod(const MeshBuffers& buffers, unsigned char current, float pixelsPerUnit) const {
+	size_t lod = std::min<size_t>(current, buffers.lods.size() - 1);
+	while (lod > 0 && buffers.lods[lod].error * pixelsPerUnit > m_LodThreshold)
+		lod--;
+	while (lod + 1 < buffers.lods.size() && buffers.lods[lod + 1].error * pixelsPerUnit <= m_LodThreshold * LOD_HYSTERESIS)
+		lod++;
+	return (unsigned char)lod;
+}
+
+/*
+@returns The amount of batches, the most commands a frame can have
+*/
+int IndirectRenderer::GetBatchCount() {
+	return (int)m_Batches.size();
+}
+
+/*
+@returns The amount of multi draw calls of the last frame
+*/
+int IndirectRenderer::GetDrawCalls() {
+	return m_DrawCalls;
+}
+
+/*
+@returns The amount of draw commands of the last frame, one per visible model, program and level of detail
+*/
+int IndirectRenderer::GetCommandCount() {
+	return (int)m_Commands.size();
+}
+
+/*
+@returns The amount of objects that were inside the view frustum in the last frame
+*/
+int IndirectRenderer::GetVisibleCount() {
+	return m_Culler.GetVisibleCount();
+}
+
+/*
+@returns The amount of objects that were culled in the last frame
+*/
+int IndirectRenderer::GetCulledCount() {
+	return (int)m_Culler.GetCount() - m_Culler.GetVisibleCount();
+}
+
+/*
+Sets the screen space error in pixels a level of detail may have, higher values draw fewer triangles
+@param pixels - The threshold
+*/
+void IndirectRenderer::SetLodThreshold(float pixels) {
+	m_LodThreshold = pixels;
+}
+
+/*
+@returns The screen space error in pixels a level of detail may have
+*/
+float IndirectRenderer::GetLodThreshold() {
+	return m_LodThreshold;
+}
+
+/*
+Turns the levels of detail on or off, when off every object is drawn with its full model
+@param enabled - If the levels of detail are used
+*/
+void IndirectRenderer::SetLodEnabled(bool enabled) {
+	m_LodEnabled = enabled;
+}
+
+/*
+@returns If the levels of detail are used
+*/
+bool IndirectRenderer::IsLodEnabled() {
+	return m_LodEnabled;
+}
+
+/*
+@returns The amount of triangles drawn in the last frame
+*/
+size_t IndirectRenderer::GetTriangleCount() {
+	return m_Triangles;
+}
+
+/*
+@returns The amount of triangles the last frame would have drawn without levels of detail
+*/
+size_t IndirectRenderer::GetFullTriangleCount() {
+	return m_FullTriangles;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "SceneObject.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+
+/*
+The layout of glMultiDrawElementsIndirect commands
+*/
+struct DrawElementsIndirectCommand {
+	GLuint count; // The amount of indices
+	GLuint instanceCount; // The amount of instances
+	GLuint firstIndex; // The first index in the index buffer of the arena
+	GLint baseVertex; // Added to every index, the first vertex of the mesh in the vertex buffer of the arena
+	GLuint baseInstance; // The first entry of the draw in the DrawData buffer
+};
+
+/*
+Everything one instance needs that a single or instanced draw passes in uniforms and attributes, in std430 layout.
+Must match DrawData in vertexshader.vert
+*/
+struct DrawData {
+	glm::mat4 model; // The model matrix
+	glm::vec4 position_offset; // The position dequantization offset in xyz
+	glm::vec4 position_scale; // The position dequantization scale in xyz
+	glm::vec4 uv_offset_scale; // The uv dequantization offset in xy and scale in zw
+	GLuint layer; // The layer of the texture in the TextureArrays
+	GLint material_index; // The entry of the material in the MaterialData block
+	GLint light_index; // The entry of the light in the FrameData block
+	GLuint oct_normals; // 1 if the normals are octahedral encoded
+};
+static_assert(sizeof(DrawData) == 128, "DrawData must match the std430 layout in vertexshader.vert");
+
+/*
+The vertex and index buffers of every model in one vertex format and index type, so they can be drawn with one vao
+*/
+struct MeshArena {
+	VertexFormat format = VertexFormat::COMPACT; // The layout of the vertices
+	GLenum index_type = GL_UNSIGNED_SHORT; // The type of the indices
+	GLuint vao = 0, vbo = 0, ibo = 0; // The vao, the shared vertex buffer and the shared index buffer
+	std::vector<const MeshBuffers*> meshes; // The models in the arena, in the order they are stored
+	std::vector<GLint> base_vertex; // The first vertex of every model
+	std::vector<GLuint> first_index; // The first index of every model
+};
+
+/*
+The objects with the same model and program, one command of a multi draw per level of detail in use
+*/
+struct IndirectBatch {
+	std::vector<SceneObject*> objects; // The objects in this batch
+	std::vector<uint32_t> ids; // The ObjectStore ids of the objects
+	size_t arena = 0; // The arena the model is stored in
+	size_t mesh = 0; // The model in the arena
+	size_t cull_start = 0; // The index of the first object in the culler
+	GLuint program = 0; // The program the objects are drawn with
+	GLint uniform_indirect_draw = -1; // The uniform that tells the program to read the DrawData buffer
+	uint32_t program_rank = 0; // Small id of the program, used for the sort key
+	std::vector<unsigned char> lods; // The level of detail every object was drawn with in the last frame it was visible
+};
+
+/*
+Draws the whole scene with one glMultiDrawElementsIndirect per program and arena.
+Build copies every model into a shared vertex and index buffer per vertex format and index type (on the GPU, the mesh buffers stay as they are).
+Every frame the objects are culled, the visible ones are written to a DrawData buffer that the vertex shader reads (bound as a shader storage buffer)
+and one draw command per model is written to the indirect buffer. The commands are sorted by program, arena and then front to back.
+The vertex shader finds its DrawData entry through an instance attribute that counts up from the base instance of the command,
+which works without GL_ARB_shader_draw_parameters. The amount of GL calls does not depend on the amount of objects.
+Every object is drawn with the coarsest level of detail of its model whose error, projected to the screen, stays below the threshold.
+A coarser level is only taken once its error is below a part of the threshold (LOD_HYSTERESIS), so objects at the switching distance don't pop back and forth
+*/
+class IndirectRenderer {
+public:
+	static const GLuint DRAW_DATA_BINDING = 0; // The shader storage binding point of the DrawData buffer
+
+private:
+	std::vector<MeshArena> m_Arenas; // The shared buffers
+	std::vector<IndirectBatch> m_Batches; // The objects grouped by model and program
+	RenderQueue m_Queue; // The batches in draw order
+	FrustumCuller m_Culler; // The world bounds of all objects, in batch order
+	std::vector<DrawElementsIndirectCommand> m_Commands; // The commands of the last frame
+	std::vector<DrawData> m_DrawData; // The visible instances of the last frame
+	GLuint m_CommandBuffer; // The indirect buffer
+	GLuint m_DrawDataBuffer; // The shader storage buffer with m_DrawData
+	GLuint m_DrawIndexBuffer; // 0, 1, 2, ... one per object, the per-instance attribute that indexes m_DrawData
+	int m_DrawCalls; // The amount of multi draw calls of the last frame
+	float m_LodThreshold; // The screen space error in pixels a level of detail may have
+	bool m_LodEnabled; // If the levels of detail are used, otherwise every object is drawn with its full model
+	size_t m_Triangles; // The amount of triangles drawn in the last frame
+	size_t m_FullTriangles; // The amount of triangles the last frame would have drawn with the full models
+
+	void BuildArenas();
+	unsigned char SelectLod(const MeshBuffers& buffers, unsigned char current, float pixelsPerUnit) const;
+
+public:
+	// Methods are documented in IndirectRenderer.cpp
+	IndirectRenderer();
+	~IndirectRenderer();
+	IndirectRenderer(const IndirectRenderer&) = delete;
+	IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+	void Build(const std::vector<SceneObject*>& objects);
+	void Clear();
+	void Render(const glm::mat4* view, const glm::mat4* projection);
+	int GetBatchCount();
+	int GetDrawCalls();
+	int GetCommandCount();
+	int GetVisibleCount();
+	int GetCulledCount();
+	void SetLodThreshold(float pixels);
+	float GetLodThreshold();
+	void SetLodEnabled(bool enabled);
+	bool IsLodEnabled();
+	size_t GetTriangleCount();
+	size_t GetFullTriangleCount();
+};
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "InstancedRenderer.h"
+#include "StateCache.h"
+#include "ObjectStore.h"
+
+InstancedRenderer::InstancedRenderer() {
+	m_DrawCalls = 0;
+}
+
+/*
+Destructor, deletes the GL objects of the batches
+*/
+InstancedRenderer::~InstancedRenderer() {
+	Clear();
+}
+
+/*
+Returns if two objects can be drawn in the same instanced draw call
+*/
+static bool CanBatch(SceneObject* a, SceneObject* b) {
+	return a->GetBuffers() == b->GetBuffers()
+		&& a->GetProgram() == b->GetProgram()
+		&& a->GetMaterial() == b->GetMaterial()
+		&& a->GetLight() == b->GetLight();
+}
+
+/*
+Returns the rank of a value in a list of values seen so far, adding it if it is new
+*/
+template <typename T>
+static uint32_t Rank(std::vector<T>& seen, T value) {
+	for (size_t i = 0; i < seen.size(); i++) {
+		if (seen[i] == value)
+			return (uint32_t)i;
+	}
+	seen.push_back(value);
+	return (uint32_t)(seen.size() - 1);
+}
+
+/*
+Groups the objects into batches and makes a vao per batch.
+Must be called after the buffers of the objects were initialised, and again whenever objects are added, removed or change model, shader or material
+@param objects - The objects to draw
+*/
+void InstancedRenderer::Build(const std::vector<SceneObject*>& objects) {
+	Clear();
+	for (size_t i = 0; i < objects.size(); i++) {
+		SceneObject* object = objects[i];
+		if (object == nullptr || object->GetBuffers() == nullptr)
+			continue;
+		size_t b = 0;
+		while (b < m_Batches.size() && !CanBatch(m_Batches[b].objects[0], object))
+			b++;
+		if (b == m_Batches.size())
+			m_Batches.push_back(InstanceBatch());
+		m_Batches[b].objects.push_back(object);
+		m_Batches[b].ids.push_back(object->GetStoreId());
+	}
+
+	std::vector<GLuint> programs;
+	std::vector<const Material*> materials;
+	for (size_t b = 0; b < m_Batches.size(); b++) {
+		InstanceBatch& batch = m_Batches[b];
+		SceneObject* first = batch.objects[0];
+		const MeshBuffers* buffers = first->GetBuffers();
+		batch.program_rank = Rank(programs, first->GetProgram());
+		batch.material_rank = Rank(materials, first->GetMaterial());
+		batch.vao_rank = (uint32_t)b; // Every batch has its own vao
+
+		glGenBuffers(1, &batch.instance_vbo);
+		glGenVertexArrays(1, &batch.vao);
+		glBindVertexArray(batch.vao);
+
+		// The model, same as the vao of the mesh
+		glBindBuffer(GL_ARRAY_BUFFER, buffers->vbo);
+		VertexPacking::SetupAttributes(buffers->format);
+
+		// One model matrix and texture layer per instance, a mat4 attribute takes 4 locations
+		glBindBuffer(GL_ARRAY_BUFFER, batch.instance_vbo);
+		for (GLuint column = 0; column < 4; column++) {
+			GLuint location = VertexAttribute::INSTANCE_MODEL + column;
+			glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+			glVertexAttribDivisor(location, 1);
+			glEnableVertexAttribArray(location);
+		}
+		glVertexAttribIPointer(VertexAttribute::INSTANCE_LAYER, 1, GL_UNSIGNED_INT, sizeof(InstanceData), (void*)offsetof(InstanceData, layer));
+		glVertexAttribDivisor(VertexAttribute::INSTANCE_LAYER, 1);
+		glEnableVertexAttribArray(VertexAttribute::INSTANCE_LAYER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers->ibo);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+}
+
+/*
+Deletes all batches
+*/
+void InstancedRenderer::Clear() {
+	for (size_t b = 0; b < m_Batches.size(); b++) {
+		glDeleteVertexArrays(1, &m_Batches[b].vao);
+		glDeleteBuffers(1, &m_Batches[b].instance_vbo);
+	}
+	m_Batches.clear();
+}
+
+/*
+Culls the objects against the view frustum and draws every batch that has visible objects with one instanced draw call, sorted by state and then front to back.
+ObjectStore::UpdateTransforms must have been called with the same view matrix, the culling and depth sorting use its results
+@param view - The view matrix
+@param projection - The projection matrix
+*/
+void InstancedRenderer::Render(const glm::mat4* view, const glm::mat4* projection) {
+	m_DrawCalls = 0;
+
+	// The bounds of all objects in batch order, so the culler tests them in one pass
+	const glm::mat4* models = ObjectStore::Models();
+	const glm::mat4* modelViews = ObjectStore::ModelViews();
+	const glm::vec3* centers = ObjectStore::WorldCenters();
+	const glm::vec3* extents = ObjectStore::WorldExtents();
+	const float* radii = ObjectStore::WorldRadii();
+	m_Culler.Clear();
+	for (size_t b = 0; b < m_Batches.size(); b++) {
+		const std::vector<uint32_t>& ids = m_Batches[b].ids;
+		for (size_t i = 0; i < ids.size(); i++) {
+			uint32_t index = ObjectStore::IndexOf(ids[i]);
+			m_Culler.Add(centers[index], extents[index], radii[index]);
+		}
+	}
+	m_Culler.Cull(*projection * *view);
+
+	m_Queue.Clear();
+	size_t cullIndex = 0;
+	for (size_t b = 0; b < m_Batches.size(); b++) {
+		InstanceBatch& batch = m_Batches[b];
+
+		// Gather the model matrices and layers of the visible objects, static objects don't cost any bandwidth after the first frame
+		GLsizei count = 0;
+		bool changed = false;
+		float depth = FLT_MAX; // The distance of the nearest visible object in the batch
+		for (size_t i = 0; i < batch.ids.size(); i++) {
+			if (!m_Culler.IsVisible(cullIndex++))
+				continue;
+			uint32_t index = ObjectStore::IndexOf(batch.ids[i]);
+			InstanceData instance;
+			instance.model = models[index];
+			instance.layer = batch.objects[i]->GetTexture()->GetSampledLayer();
+			if ((size_t)count == batch.instances.size()) {
+				batch.instances.push_back(instance);
+				changed = true;
+			} else if (changed || memcmp(&batch.instances[count], &instance, sizeof(InstanceData)) != 0) {
+				batch.instances[count] = instance;
+				changed = true;
+			}
+			count++;
+			depth = std::min(depth, -modelViews[index][3].z);
+		}
+		changed = changed || (size_t)count != batch.instances.size();
+		batch.instances.resize(count);
+		batch.visible = count;
+		if (count == 0)
+			continue;
+
+		if (changed) {
+			glBindBuffer(GL_ARRAY_BUFFER, batch.instance_vbo);
+			if (count > batch.capacity) {
+				batch.capacity = count;
+				glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceData), batch.instances.data(), GL_DYNAMIC_DRAW);
+			} else {
+				glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), batch.instances.data());
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		// Every batch samples the same texture array, so the texture doesn't split the key
+		m_Queue.Push(RenderQueue::MakeKey(batch.program_rank, 0, batch.material_rank, batch.vao_rank, depth), (uint32_t)b);
+	}
+	m_Queue.Sort();
+
+	const std::vector<DrawItem>& items = m_Queue.GetItems();
+	for (size_t item = 0; item < items.size(); item++) {
+		InstanceBatch& batch = m_Batches[items[item].index];
+		batch.objects[0]->BindState();
+		const MeshBuffers* buffers = batch.objects[0]->GetBuffers();
+		StateCache::BindVertexArray(batch.vao);
+		glDrawElementsInstanced(GL_TRIANGLES, buffers->index_count, buffers->index_type, 0, batch.visible);
+		m_DrawCalls++;
+	}
+	StateCache::BindVertexArray(0);
+}
+
+/*
+@returns The amount of batches
+*/
+int InstancedRenderer::GetBatchCount() {
+	return (int)m_Batches.size();
+}
+
+/*
+@returns The amount of draw calls of the last frame
+*/
+int InstancedRenderer::GetDrawCalls() {
+	return m_DrawCalls;
+}
+
+/*
+@returns The amount of objects that were inside the view frustum in the last frame
+*/
+int InstancedRenderer::GetVisibleCount() {
+	return m_Culler.GetVisibleCount();
+}
+
+/*
+@returns The amount of objects that were culled in the last frame
+*/
+int InstancedRenderer::GetCulledCount() {
+	return (int)m_Culler.GetCount() - m_Culler.GetVisibleCount();
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "SceneObject.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+
+/*
+The per-instance attributes of one object
+*/
+struct InstanceData {
+	glm::mat4 model; // The model matrix (VertexAttribute::INSTANCE_MODEL)
+	GLuint layer; // The texture layer the object samples (VertexAttribute::INSTANCE_LAYER)
+};
+
+/*
+A group of scene objects that share a model, vertex format, program, material and light, drawn with a single instanced draw call.
+Every texture is a layer of the TextureArrays, so objects with different textures still share a batch
+*/
+struct InstanceBatch {
+	std::vector<SceneObject*> objects; // The objects in this batch, the first one provides the shared state
+	std::vector<uint32_t> ids; // The ObjectStore ids of the objects, the per-frame data is read from the store
+	std::vector<InstanceData> instances; // The attributes of the visible objects as last uploaded
+	GLuint vao = 0; // The vao with the vertex and index buffer of the model plus the instance buffer
+	GLuint instance_vbo = 0; // The per-instance attributes
+	GLsizei capacity = 0; // The amount of instances the instance buffer has room for
+	GLsizei visible = 0; // The amount of objects that passed the frustum test this frame, the first ones in the instance buffer
+	uint32_t program_rank = 0, material_rank = 0, vao_rank = 0; // Small ids of the shared state, used for the sort key
+};
+
+/*
+Draws a list of scene objects, one glDrawElementsInstanced per batch of objects that only differ in their model matrix and texture layer.
+The model matrices and layers are gathered every frame (so animated objects and textures that became resident just work) but only uploaded when they changed.
+Objects outside the view frustum are left out of the instance buffers, a batch without visible objects is not drawn.
+Batches are drawn in the order of a RenderQueue, so batches that share a program follow each other and the StateCache can skip the binds.
+The texture array is the same for every batch, it is bound once per frame
+*/
+class InstancedRenderer {
+private:
+	std::vector<InstanceBatch> m_Batches; // The batches, in order of their first object
+	RenderQueue m_Queue; // The batches in draw order
+	FrustumCuller m_Culler; // The world bounds of all objects, in batch order
+	int m_DrawCalls; // The amount of draw calls of the last frame
+
+public:
+	// Methods are documented in InstancedRenderer.cpp
+	InstancedRenderer();
+	~InstancedRenderer();
+	InstancedRenderer(const InstancedRenderer&) = delete;
+	InstancedRenderer& operator=(const InstancedRenderer&) = delete;
+	void Build(const std::vector<SceneObject*>& objects);
+	void Clear();
+	void Render(const glm::mat4* view, const glm::mat4* projection);
+	int GetBatchCount();
+	int GetDrawCalls();
+	int GetVisibleCount();
+	int GetCulledCount();
+};
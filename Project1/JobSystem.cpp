@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+
+namespace JobSystem {
+	/*
+	One chunk of a ParallelFor
+	*/
+	struct Task {
+		const std::function<void(size_t, size_t)>* func; // The body of the loop, owned by the ParallelFor that waits for it
+		size_t begin, end; // The range of the chunk
+		std::atomic<size_t>* remaining; // The amount of chunks of the ParallelFor that are not done yet
+	};
+
+	/*
+	The chunks waiting to be run by one thread
+	*/
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::thread> workers; // The worker threads
+	std::unique_ptr<Queue[]> queues; // One queue per thread, 0 belongs to the thread that called Start
+	size_t queueCount = 0; // The amount of queues, the workers plus one
+	std::atomic<size_t> pending(0); // The amount of queued chunks, the workers sleep while there are none
+	std::mutex sleepMutex; // Guards the wake-up condition of the workers
+	std::condition_variable wake; // Signalled when chunks are queued or the pool stops
+	bool stopping = false; // Tells the workers to quit, guarded by sleepMutex
+	thread_local size_t ownQueue = 0; // The queue of the current thread
+
+	/*
+	Takes a chunk for the given thread: the newest one of its own queue, or the oldest one of another queue
+	@param own - The queue of the thread
+	@param task - Set to the chunk
+	@returns If there was a chunk
+	*/
+	static bool Take(size_t own, Task& task) {
+		for (size_t i = 0; i < queueCount; i++) {
+			Queue& queue = queues[(own + i) % queueCount];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty())
+				continue;
+			if (i == 0) {
+				task = queue.tasks.back();
+				queue.tasks.pop_back();
+			} else {
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+			}
+			pending.fetch_sub(1);
+			return true;
+		}
+		return false;
+	}
+
+	/*
+	Runs a chunk and marks it as done
+	*/
+	static void Run(const Task& task) {
+		(*task.func)(task.begin, task.end);
+		task.remaining->fetch_sub(1, std::memory_order_release);
+	}
+
+	/*
+	The loop of a worker thread: runs chunks while there are any and sleeps otherwise
+	@param index - The queue of the worker
+	*/
+	static void Work(size_t index) {
+		ownQueue = index;
+		for (;;) {
+			Task task;
+			if (Take(index, task)) {
+				Run(task);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wake.wait(lock, [] { return stopping || pending.load() > 0; });
+			if (stopping)
+				return;
+		}
+	}
+
+	/*
+	Starts the worker threads, the calling thread takes part in every ParallelFor it makes so it counts as one of them
+	@param threadCount - The amount of threads including the calling thread, 0 uses one per core
+	*/
+	void Start(unsigned int threadCount) {
+		Stop();
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		queueCount = threadCount;
+		queues.reset(new Queue[queueCount]);
+		stopping = false;
+		ownQueue = 0;
+		for (size_t i = 1; i < queueCount; i++)
+			workers.push_back(std::thread(Work, i));
+	}
+
+	/*
+	Stops the worker threads, must not be called while a ParallelFor is running
+	*/
+	void Stop() {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (size_t i = 0; i < workers.size(); i++)
+			workers[i].join();
+		workers.clear();
+		queues.reset();
+		queueCount = 0;
+	}
+
+	/*
+	@returns The amount of threads that run the chunks of a ParallelFor, including the calling thread
+	*/
+	unsigned int GetThreadCount() {
+		return (unsigned int)workers.size() + 1;
+	}
+
+	/*
+	Calls func for every chunk of [0, count) and returns when all of them are done.
+	Chunk c always covers [c * grain, min((c + 1) * grain, count)) whatever the amount of threads, so results written per chunk can be merged in a fixed order.
+	Chunks run at the same time on different threads, func must only write to the range it was given (or to per-chunk results)
+	@param count - The amount of items
+	@param grain - The amount of items per chunk
+	@param func - Called with the begin and end of each chunk
+	*/
+	void ParallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& func) {
+		if (count == 0)
+			return;
+		grain = std::max(grain, (size_t)1);
+		size_t chunkCount = (count + grain - 1) / grain;
+		// Without workers the chunks still run one by one, so they are the same as with them
+		if (workers.empty() || chunkCount == 1) {
+			for (size_t c = 0; c < chunkCount; c++)
+				func(c * grain, std::min((c + 1) * grain, count));
+			return;
+		}
+
+		// Neighbouring chunks go to the same queue, the threads that run out of work steal from the front of the others
+		std::atomic<size_t> remaining(chunkCount);
+		size_t first = ownQueue;
+		for (size_t c = 0; c < chunkCount; c++) {
+			Queue& queue = queues[(first + c * queueCount / chunkCount) % queueCount];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back(Task{ &func, c * grain, std::min((c + 1) * grain, count), &remaining });
+		}
+		pending.fetch_add(chunkCount);
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wake.notify_all();
+
+		// The calling thread helps until every chunk is done, it may run chunks of other loops while it waits
+		while (remaining.load(std::memory_order_acquire) > 0) {
+			Task task;
+			if (Take(ownQueue, task))
+				Run(task);
+			else
+				std::this_thread::yield();
+		}
+	}
+}
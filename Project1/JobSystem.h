@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+/*
+A pool of worker threads that split loops over many objects between them.
+Every thread has its own queue of chunks: it takes work from the back of its own queue and steals from the front of the others when it runs out,
+so threads that finish early help the slow ones instead of waiting.
+Without Start (or with one core) everything runs on the calling thread
+*/
+namespace JobSystem {
+	// Documented in JobSystem.cpp
+	void Start(unsigned int threadCount = 0);
+	void Stop();
+	unsigned int GetThreadCount();
+	void ParallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& func);
+}
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cmath>
+
+#include "LooseOctree.h"
+
+/*
+Constructor
+@param center - The center of the root cell
+@param halfSize - Half the size of the root cell, items further away are kept in the root
+@param maxDepth - The depth at which cells are no longer split
+*/
+LooseOctree::LooseOctree(const glm::vec3& center, float halfSize, int maxDepth) {
+	m_MaxDepth = maxDepth;
+	m_Nodes.push_back(Node());
+	m_Nodes[0].center = center;
+	m_Nodes[0].half_size = halfSize;
+}
+
+/*
+Returns the deepest cell that holds the center of the box and is at least as large as the box, splitting cells on the way
+*/
+int LooseOctree::FindNode(const glm::vec3& center, const glm::vec3& extent) {
+	float size = std::max(extent.x, std::max(extent.y, extent.z));
+	const glm::vec3 offset = glm::abs(center - m_Nodes[0].center);
+	if (std::max(offset.x, std::max(offset.y, offset.z)) > m_Nodes[0].half_size)
+		return 0;
+
+	int node = 0;
+	for (int depth = 0; depth < m_MaxDepth; depth++) {
+		float childHalf = m_Nodes[node].half_size * 0.5f;
+		if (size > childHalf)
+			break;
+		if (m_Nodes[node].first_child < 0) {
+			int first = (int)m_Nodes.size();
+			glm::vec3 parentCenter = m_Nodes[node].center;
+			m_Nodes.resize(m_Nodes.size() + 8);
+			for (int c = 0; c < 8; c++) {
+				m_Nodes[first + c].center = parentCenter + glm::vec3(c & 1 ? childHalf : -childHalf, c & 2 ? childHalf : -childHalf, c & 4 ? childHalf : -childHalf);
+				m_Nodes[first + c].half_size = childHalf;
+			}
+			m_Nodes[node].first_child = first;
+		}
+		const glm::vec3& cell = m_Nodes[node].center;
+		int child = (center.x >= cell.x ? 1 : 0) | (center.y >= cell.y ? 2 : 0) | (center.z >= cell.z ? 4 : 0);
+		node = m_Nodes[node].first_child + child;
+	}
+	return node;
+}
+
+/*
+Adds an item to the items of a cell
+*/
+void LooseOctree::Attach(uint32_t id, int node) {
+	Item& item = m_Items[id];
+	item.node = node;
+	item.slot = (uint32_t)m_Nodes[node].items.size();
+	m_Nodes[node].items.push_back(id);
+}
+
+/*
+Removes an item from the items of its cell, by moving the last item of the cell in its place
+*/
+void LooseOctree::Detach(uint32_t id) {
+	Item& item = m_Items[id];
+	std::vector<uint32_t>& items = m_Nodes[item.node].items;
+	uint32_t last = items.back();
+	items[item.slot] = last;
+	m_Items[last].slot = item.slot;
+	items.pop_back();
+	item.node = -1;
+}
+
+/*
+Adds an item, or moves it when the id is already in use
+@param id - The id of the item, ids should be small as they index an array
+@param center - The center of the box
+@param extent - Half the size of the box
+*/
+void LooseOctree::Insert(uint32_t id, const glm::vec3& center, const glm::vec3& extent) {
+	if (id >= m_Items.size())
+		m_Items.resize(id + 1);
+	if (m_Items[id].node >= 0) {
+		Update(id, center, extent);
+		return;
+	}
+	m_Items[id].center = center;
+	m_Items[id].extent = extent;
+	Attach(id, FindNode(center, extent));
+}
+
+/*
+Moves an item, it only changes cell when it does not belong in its current cell anymore
+@param id - The id of the item
+@param center - The new center of the box
+@param extent - The new half size of the box
+*/
+void LooseOctree::Update(uint32_t id, const glm::vec3& center, const glm::vec3& extent) {
+	if (id >= m_Items.size() || m_Items[id].node < 0) {
+		Insert(id, center, extent);
+		return;
+	}
+	Item& item = m_Items[id];
+	item.center = center;
+	item.extent = extent;
+	int node = FindNode(center, extent);
+	if (node != item.node) {
+		Detach(id);
+		Attach(id, node);
+	}
+}
+
+/*
+Removes an item
+@param id - The id of the item
+*/
+void LooseOctree::Remove(uint32_t id) {
+	if (id < m_Items.size() && m_Items[id].node >= 0)
+		Detach(id);
+}
+
+/*
+Removes all items and cells
+*/
+void LooseOctree::Clear() {
+	m_Nodes.resize(1);
+	m_Nodes[0].first_child = -1;
+	m_Nodes[0].items.clear();
+	m_Items.clear();
+}
+
+/*
+Finds the items whose box touches a sphere
+@param center - The center of the sphere
+@param radius - The radius of the sphere
+@param result - The ids of the items are appended to this
+*/
+void LooseOctree::QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const {
+	float radius2 = radius * radius;
+	std::vector<int> stack(1, 0);
+	while (!stack.empty()) {
+		const Node& node = m_Nodes[stack.back()];
+		stack.pop_back();
+		for (size_t i = 0; i < node.items.size(); i++) {
+			const Item& item = m_Items[node.items[i]];
+			glm::vec3 d = glm::max(glm::abs(center - item.center) - item.extent, glm::vec3(0.0f));
+			if (glm::dot(d, d) <= radius2)
+				result.push_back(node.items[i]);
+		}
+		if (node.first_child < 0)
+			continue;
+		for (int c = 0; c < 8; c++) {
+			const Node& child = m_Nodes[node.first_child + c];
+			glm::vec3 d = glm::max(glm::abs(center - child.center) - glm::vec3(child.half_size * 2.0f), glm::vec3(0.0f));
+			if (glm::dot(d, d) <= radius2)
+				stack.push_back(node.first_child + c);
+		}
+	}
+}
+
+/*
+Finds the items whose box overlaps a box
+@param min - The minimum corner of the box
+@param max - The maximum corner of the box
+@param result - The ids of the items are appended to this
+*/
+void LooseOctree::QueryBox(const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& result) const {
+	glm::vec3 center = (min + max) * 0.5f;
+	glm::vec3 extent = (max - min) * 0.5f;
+	std::vector<int> stack(1, 0);
+	while (!stack.empty()) {
+		const Node& node = m_Nodes[stack.back()];
+		stack.pop_back();
+		for (size_t i = 0; i < node.items.size(); i++) {
+			const Item& item = m_Items[node.items[i]];
+			glm::vec3 gap = glm::abs(center - item.center) - item.extent - extent;
+			if (gap.x <= 0 && gap.y <= 0 && gap.z <= 0)
+				result.push_back(node.items[i]);
+		}
+		if (node.first_child < 0)
+			continue;
+		for (int c = 0; c < 8; c++) {
+			const Node& child = m_Nodes[node.first_child + c];
+			glm::vec3 gap = glm::abs(center - child.center) - glm::vec3(child.half_size * 2.0f) - extent;
+			if (gap.x <= 0 && gap.y <= 0 && gap.z <= 0)
+				stack.push_back(node.first_child + c);
+		}
+	}
+}
+
+/*
+Returns the distance along a ray to where it enters a box (slab test)
+@returns False if the ray misses the box within maxDistance
+*/
+static bool RayBox(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const glm::vec3& center, const glm::vec3& extent, float& distance) {
+	glm::vec3 t0 = (center - extent - origin) * inverseDirection;
+	glm::vec3 t1 = (center + extent - origin) * inverseDirection;
+	glm::vec3 tmin = glm::min(t0, t1), tmax = glm::max(t0, t1);
+	float enter = std::max(0.0f, std::max(tmin.x, std::max(tmin.y, tmin.z)));
+	float exit = std::min(maxDistance, std::min(tmax.x, std::min(tmax.y, tmax.z)));
+	distance = enter;
+	return enter <= exit;
+}
+
+/*
+Finds the items whose box is hit by a ray
+@param origin - The start of the ray
+@param direction - The direction of the ray, distances are in multiples of its length
+@param maxDistance - The length of the ray
+@param result - The ids of the items are appended to this
+@param distances - The distance at which the ray enters each item, appended in the same order as result
+*/
+void LooseOctree::QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<uint32_t>& result, std::vector<float>& distances) const {
+	glm::vec3 inverseDirection = 1.0f / direction;
+	std::vector<int> stack(1, 0);
+	while (!stack.empty()) {
+		const Node& node = m_Nodes[stack.back()];
+		stack.pop_back();
+		for (size_t i = 0; i < node.items.size(); i++) {
+			const Item& item = m_Items[node.items[i]];
+			float distance;
+			if (RayBox(origin, inverseDirection, maxDistance, item.center, item.extent, distance)) {
+				result.push_back(node.items[i]);
+				distances.push_back(distance);
+			}
+		}
+		if (node.first_child < 0)
+			continue;
+		for (int c = 0; c < 8; c++) {
+			const Node& child = m_Nodes[node.first_child + c];
+			float distance;
+			if (RayBox(origin, inverseDirection, maxDistance, child.center, glm::vec3(child.half_size * 2.0f), distance))
+				stack.push_back(node.first_child + c);
+		}
+	}
+}
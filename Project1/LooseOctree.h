@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/*
+A loose octree over axis aligned boxes, identified by small integer ids.
+Every node's bounds are loosened to twice its cell size, so an item is stored in the deepest cell that holds its center and whose size is at least the size of the item.
+Moving an item only touches the octree when it crosses into another cell. Items outside the root cell are kept in the root
+*/
+class LooseOctree {
+private:
+	/*
+	A cell of the octree
+	*/
+	struct Node {
+		glm::vec3 center; // The center of the cell
+		float half_size; // Half the size of the cell, the loose bounds are twice as large
+		int first_child = -1; // The index of the first of the 8 children, -1 if the cell was never split
+		std::vector<uint32_t> items; // The items stored in this cell
+	};
+
+	/*
+	An item in the octree
+	*/
+	struct Item {
+		glm::vec3 center; // The center of the box
+		glm::vec3 extent; // Half the size of the box
+		int node = -1; // The cell the item is stored in, -1 if the id is not in use
+		uint32_t slot = 0; // The position of the item in the items of its cell
+	};
+
+	std::vector<Node> m_Nodes; // The cells, the root is the first
+	std::vector<Item> m_Items; // The items, indexed by id
+	int m_MaxDepth; // The depth at which cells are no longer split
+
+public:
+	// Methods are documented in LooseOctree.cpp
+	LooseOctree(const glm::vec3& center, float halfSize, int maxDepth = 8);
+	void Insert(uint32_t id, const glm::vec3& center, const glm::vec3& extent);
+	void Update(uint32_t id, const glm::vec3& center, const glm::vec3& extent);
+	void Remove(uint32_t id);
+	void Clear();
+	void QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const;
+	void QueryBox(const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& result) const;
+	void QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<uint32_t>& result, std::vector<float>& distances) const;
+
+private:
+	int FindNode(const glm::vec3& center, const glm::vec3& extent);
+	void Attach(uint32_t id, int node);
+	void Detach(uint32_t id);
+};
@@ -0,0 +1,115 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+	m_Data = nullptr;
+	m_Size = 0;
+#ifdef _WIN32
+	m_File = INVALID_HANDLE_VALUE;
+	m_Mapping = nullptr;
+#else
+	m_File = -1;
+#endif
+}
+
+/*
+Destructor, unmaps the file if it is still mapped
+*/
+MappedFile::~MappedFile() {
+	Close();
+}
+
+/*
+Maps the whole file into memory for reading
+@param path - The path of the file to map
+@returns True if the file was mapped, false if it could not be opened or is empty
+*/
+bool MappedFile::Open(const char* path) {
+	Close();
+#ifdef _WIN32
+	m_File = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_File == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0) {
+		Close();
+		return false;
+	}
+	m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_Mapping == nullptr) {
+		Close();
+		return false;
+	}
+	m_Data = (const unsigned char*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_Data == nullptr) {
+		Close();
+		return false;
+	}
+	m_Size = (size_t)size.QuadPart;
+#else
+	m_File = open(path, O_RDONLY);
+	if (m_File < 0)
+		return false;
+	struct stat info;
+	if (fstat(m_File, &info) != 0 || info.st_size == 0) {
+		Close();
+		return false;
+	}
+	void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, m_File, 0);
+	if (view == MAP_FAILED) {
+		Close();
+		return false;
+	}
+	m_Data = (const unsigned char*)view;
+	m_Size = (size_t)info.st_size;
+#endif
+	return true;
+}
+
+/*
+Unmaps the file and closes the handles, safe to call when nothing is mapped
+*/
+void MappedFile::Close() {
+#ifdef _WIN32
+	if (m_Data != nullptr)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping != nullptr)
+		CloseHandle(m_Mapping);
+	if (m_File != INVALID_HANDLE_VALUE)
+		CloseHandle(m_File);
+	m_Mapping = nullptr;
+	m_File = INVALID_HANDLE_VALUE;
+#else
+	if (m_Data != nullptr)
+		munmap((void*)m_Data, m_Size);
+	if (m_File >= 0)
+		close(m_File);
+	m_File = -1;
+#endif
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+/*
+@returns A pointer to the first byte of the mapped file, or nullptr if nothing is mapped
+*/
+const unsigned char* MappedFile::Data() const {
+	return m_Data;
+}
+
+/*
+@returns The size of the mapped file in bytes
+*/
+size_t MappedFile::Size() const {
+	return m_Size;
+}
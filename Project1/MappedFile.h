@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+
+/*
+A read-only memory mapping of a whole file.
+The mapping is released when the object goes out of scope
+*/
+class MappedFile {
+private:
+	const unsigned char* m_Data; // The start of the mapped view, nullptr if nothing is mapped
+	size_t m_Size; // The size of the mapped view in bytes
+#ifdef _WIN32
+	void* m_File; // The Win32 file handle
+	void* m_Mapping; // The Win32 file mapping handle
+#else
+	int m_File; // The POSIX file descriptor
+#endif
+
+public:
+	// Methods are documented in MappedFile.cpp
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	bool Open(const char* path);
+	void Close();
+	const unsigned char* Data() const;
+	size_t Size() const;
+};
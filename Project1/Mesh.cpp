@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "objloader.h"
+
+/*
+Calculates the axis aligned bounding box and the bounding sphere of the vertex positions.
+The sphere is centered on the box, which is not the smallest sphere but is usually within a few percent of it
+*/
+void MeshData::CalculateBounds() {
+	if (vertices.empty()) {
+		bounds_min = bounds_max = sphere_center = glm::vec3(0.0f);
+		sphere_radius = 0.0f;
+		return;
+	}
+	bounds_min = bounds_max = vertices[0];
+	for (size_t i = 1; i < vertices.size(); i++) {
+		bounds_min = glm::min(bounds_min, vertices[i]);
+		bounds_max = glm::max(bounds_max, vertices[i]);
+	}
+	sphere_center = (bounds_min + bounds_max) * 0.5f;
+	float radius2 = 0.0f;
+	for (size_t i = 0; i < vertices.size(); i++) {
+		glm::vec3 d = vertices[i] - sphere_center;
+		radius2 = std::max(radius2, glm::dot(d, d));
+	}
+	sphere_radius = sqrtf(radius2);
+}
+
+/*
+Transforms the bounds to world space
+@param model - The model matrix
+@param center - Set to the world space center of the bounds
+@param extent - Set to the half size of the world space box that holds the transformed bounding box
+@param radius - Set to the radius of a sphere around center that holds the transformed bounding sphere
+*/
+void MeshData::TransformBounds(const glm::mat4& model, glm::vec3& center, glm::vec3& extent, float& radius) const {
+	center = glm::vec3(model * glm::vec4(sphere_center, 1.0f));
+
+	// A scaled sphere stays inside a sphere scaled by the largest axis scale
+	float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	radius = sphere_radius * scale;
+
+	// The box that holds the rotated box: every world axis gets the absolute contribution of every local axis
+	glm::vec3 local = (bounds_max - bounds_min) * 0.5f;
+	extent = glm::abs(glm::vec3(model[0])) * local.x + glm::abs(glm::vec3(model[1])) * local.y + glm::abs(glm::vec3(model[2])) * local.z;
+}
+
+Mesh::Mesh() {
+}
+
+/*
+Destructor, deletes the GPU buffers that were made for this mesh
+*/
+Mesh::~Mesh() {
+	for (int i = 0; i < 2; i++) {
+		if (!m_Uploaded[i])
+			continue;
+		glDeleteVertexArrays(1, &m_Buffers[i].vao);
+		glDeleteBuffers(1, &m_Buffers[i].vbo);
+		glDeleteBuffers(1, &m_Buffers[i].ibo);
+	}
+}
+
+/*
+Loads the object file.
+Uses the binary mesh cache next to the .obj file when it is up to date, otherwise parses the .obj file, makes the levels of detail,
+optimizes the triangle and vertex order and (re)writes the cache
+@param modelPath - The path of the .obj file
+@returns True if the model was loaded
+*/
+bool Mesh::Load(const char* modelPath) {
+	if (MeshCache::Load(modelPath, Data))
+		return true;
+
+	if (!loadOBJ(modelPath, Data.vertices, Data.uvs, Data.normals, Data.indices))
+		return false;
+	Data.CalculateBounds();
+	MeshSimplifier::BuildLods(Data);
+	// One printf for the whole line, the models are loaded on several threads
+	std::string levels;
+	for (size_t i = 0; i < Data.lods.size(); i++) {
+		char level[64];
+		snprintf(level, sizeof(level), "%s %zu triangles (error %.4f)", i == 0 ? ":" : "", Data.lods[i].indices.size() / 3, Data.lods[i].error);
+		levels += level;
+	}
+	printf("Made %zu levels of detail for %s%s\n", Data.lods.size(), modelPath, levels.c_str());
+	MeshStatistics before, after;
+	MeshOptimizer::Optimize(Data, before, after);
+	printf("Optimized %s: ACMR %.3f -> %.3f, overdraw %.3f -> %.3f\n", modelPath, before.acmr, after.acmr, before.overdraw, after.overdraw);
+	MeshCache::Write(modelPath, Data);
+	return true;
+}
+
+/*
+Returns the GPU buffers of the mesh in the given vertex format, uploading them the first time they are asked for
+@param format - The vertex format
+@returns The buffers, the vao can be drawn with any program that uses the VertexAttribute locations
+*/
+const MeshBuffers& Mesh::GetBuffers(VertexFormat format) {
+	int f = (int)format;
+	MeshBuffers& buffers = m_Buffers[f];
+	if (m_Uploaded[f])
+		return buffers;
+	m_Uploaded[f] = true;
+
+	// Position, normal and uv interleaved in one buffer
+	buffers.format = format;
+	buffers.vertex_count = (GLsizei)Data.vertices.size();
+	VertexPacking::Pack(Data, format, buffers.packed);
+	glGenBuffers(1, &buffers.vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.vbo);
+	glBufferData(GL_ARRAY_BUFFER, buffers.packed.data.size(), buffers.packed.data.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	std::vector<unsigned char>().swap(buffers.packed.data);
+
+	// The levels of detail follow the full model in the same index buffer, so they draw with the same vao
+	std::vector<GLuint> indices(Data.indices.begin(), Data.indices.end());
+	buffers.index_count = (GLsizei)Data.indices.size();
+	buffers.lods.clear();
+	buffers.lods.push_back({ 0, buffers.index_count, 0.0f });
+	for (const MeshLod& lod : Data.lods) {
+		buffers.lods.push_back({ (GLuint)indices.size(), (GLsizei)lod.indices.size(), lod.error });
+		indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+	}
+
+	// Use 16-bit indices when the mesh is small enough, halving the size of the index buffer
+	glGenBuffers(1, &buffers.ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.ibo);
+	if (Data.vertices.size() <= 65536) {
+		std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+		buffers.index_type = GL_UNSIGNED_SHORT;
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort),
+			shortIndices.data(), GL_STATIC_DRAW);
+	} else {
+		buffers.index_type = GL_UNSIGNED_INT;
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+			indices.data(), GL_STATIC_DRAW);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	// Allocate memory for vao
+	glGenVertexArrays(1, &buffers.vao);
+
+	// Bind to vao
+	glBindVertexArray(buffers.vao);
+
+	// Bind the interleaved vertices to vao
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.vbo);
+	VertexPacking::SetupAttributes(format);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Bind the index buffer to the vao, this binding is stored in the vao so it must stay bound until the vao is unbound
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.ibo);
+
+	// Stop bind to vao
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	return buffers;
+}
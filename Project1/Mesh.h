@@ -0,0 +1,77 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "VertexFormat.h"
+
+/*
+A lower level of detail of a model, made by the MeshSimplifier.
+It draws the vertices of the full model with fewer triangles
+*/
+struct MeshLod {
+	std::vector<unsigned int> indices; // The triangle list, three indices into the vertex arrays of the model per triangle
+	float error = 0.0f; // How far the surface moved from the full model, in model units
+};
+
+/*
+The CPU side geometry of a model, as produced by loadOBJ or read back from a mesh cache
+*/
+struct MeshData {
+	std::vector<glm::vec3> vertices; // The vertex positions
+	std::vector<glm::vec2> uvs; // The texture coordinates
+	std::vector<glm::vec3> normals; // The vertex normals
+	std::vector<unsigned int> indices; // The triangle list, three indices into the vertex arrays per triangle
+	std::vector<MeshLod> lods; // The lower levels of detail, coarser with every entry
+	glm::vec3 bounds_min = glm::vec3(0.0f); // The minimum corner of the axis aligned bounding box
+	glm::vec3 bounds_max = glm::vec3(0.0f); // The maximum corner of the axis aligned bounding box
+	glm::vec3 sphere_center = glm::vec3(0.0f); // The center of the bounding sphere, the center of the bounding box
+	float sphere_radius = 0.0f; // The radius of the bounding sphere, the distance to the farthest vertex
+
+	// Methods are documented in Mesh.cpp
+	void CalculateBounds();
+	void TransformBounds(const glm::mat4& model, glm::vec3& center, glm::vec3& extent, float& radius) const;
+};
+
+/*
+The indices of one level of detail inside the index buffer of a mesh
+*/
+struct MeshLodRange {
+	GLuint first_index = 0; // The first index of the level
+	GLsizei index_count = 0; // The amount of indices of the level
+	float error = 0.0f; // The error of the level in model units, 0 for the full model
+};
+
+/*
+The GPU side of a mesh in one vertex format
+*/
+struct MeshBuffers {
+	GLuint vao = 0, vbo = 0, ibo = 0; // The vertex array object, the interleaved vertex buffer and the index buffer
+	GLsizei index_count = 0; // The amount of indices of the full model, which start at the beginning of the index buffer
+	GLsizei vertex_count = 0; // The amount of vertices in the vertex buffer
+	GLenum index_type = GL_UNSIGNED_SHORT; // GL_UNSIGNED_SHORT when all indices fit in 16 bits, otherwise GL_UNSIGNED_INT
+	VertexFormat format = VertexFormat::COMPACT; // The layout of the vertex buffer
+	std::vector<MeshLodRange> lods; // Every level of detail, the full model first, stored one after the other in the index buffer
+	PackedVertices packed; // The dequantization parameters of the vertex buffer (the vertex data itself is freed after upload)
+};
+
+/*
+A model that can be shared between scene objects, see AssetCache.
+Holds the geometry on the CPU and uploads it to the GPU once per vertex format that is asked for
+*/
+class Mesh {
+public:
+	MeshData Data; // The geometry of the model, only complete once the mesh is resident
+	bool Resident = false; // Set on the GL thread by the AssetLoader when Data is loaded and uploaded
+private:
+	MeshBuffers m_Buffers[2]; // The GPU buffers, indexed by VertexFormat
+	bool m_Uploaded[2] = { false, false }; // If the buffers for a VertexFormat were made
+
+public:
+	// Methods are documented in Mesh.cpp
+	Mesh();
+	~Mesh();
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+	bool Load(const char* modelPath);
+	const MeshBuffers& GetBuffers(VertexFormat format);
+};
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <cstdint>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "MeshSimplifier.h"
+
+namespace MeshCache {
+	const char MAGIC[4] = { 'C', 'G', 'M', 'B' }; // Identifies a mesh cache file
+	const uint32_t VERSION = 7; // Bump whenever the layout below or the loader output changes
+
+	/*
+	The attribute streams stored in the file, in order
+	*/
+	enum Stream {
+		POSITIONS, UVS, NORMALS, INDICES, LOD_INDICES, STREAM_COUNT
+	};
+
+	/*
+	The location of one attribute stream inside the file
+	*/
+	struct StreamEntry {
+		uint64_t offset; // Offset from the start of the file in bytes
+		uint64_t size; // Size of the stream in bytes
+	};
+
+	/*
+	The on-disk header, everything in it is little endian and naturally aligned
+	*/
+	struct Header {
+		char magic[4]; // Always MAGIC
+		uint32_t version; // Always VERSION
+		uint64_t source_size; // The size of the .obj the cache was made from
+		int64_t source_mtime; // The modification time of the .obj the cache was made from
+		uint32_t vertex_count; // The amount of vertices in every vertex stream
+		uint32_t index_count; // The amount of indices in the index stream
+		uint32_t stream_count; // Always STREAM_COUNT
+		uint32_t reserved; // Keeps the bounds and streams at the same offsets on every compiler
+		float bounds_min[3]; // The minimum corner of the bounding box
+		float bounds_max[3]; // The maximum corner of the bounding box
+		float sphere_center[3]; // The center of the bounding sphere
+		float sphere_radius; // The radius of the bounding sphere
+		uint32_t lod_count; // The amount of levels of detail, their indices follow each other in the LOD_INDICES stream
+		uint32_t lod_index_count[MeshSimplifier::MAX_LODS]; // The amount of indices of every level
+		float lod_error[MeshSimplifier::MAX_LODS]; // The error of every level
+		uint32_t reserved2; // Keeps the streams 8 byte aligned
+		StreamEntry streams[STREAM_COUNT]; // The attribute streams
+	};
+
+	/*
+	Reads the size and modification time of the source model
+	@returns False if the source does not exist
+	*/
+	static bool GetSourceStamp(const char* modelPath, uint64_t& size, int64_t& mtime) {
+		struct stat info;
+		if (stat(modelPath, &info) != 0)
+			return false;
+		size = (uint64_t)info.st_size;
+		mtime = (int64_t)info.st_mtime;
+		return true;
+	}
+
+	/*
+	Rounds an offset up so every stream starts on a 16 byte boundary
+	*/
+	static uint64_t Align(uint64_t offset) {
+		return (offset + 15) & ~(uint64_t)15;
+	}
+
+	/*
+	Returns the path of the cache file that belongs to the model
+	@param modelPath - The path of the .obj file
+	@returns The path of the cache file
+	*/
+	std::string GetCachePath(const char* modelPath) {
+		return std::string(modelPath) + ".meshbin";
+	}
+
+	/*
+	Loads the model from its cache file if there is an up to date one
+	@param modelPath - The path of the .obj file (not the cache file)
+	@param mesh - The mesh to fill
+	@returns True if the mesh was loaded from the cache, false if the cache is missing, stale or corrupt
+	*/
+	bool Load(const char* modelPath, MeshData& mesh) {
+		uint64_t sourceSize;
+		int64_t sourceMtime;
+		if (!GetSourceStamp(modelPath, sourceSize, sourceMtime))
+			return false;
+
+		std::string cachePath = GetCachePath(modelPath);
+		MappedFile file;
+		if (!file.Open(cachePath.c_str()))
+			return false;
+
+		if (file.Size() < sizeof(Header))
+			return false;
+		Header header;
+		memcpy(&header, file.Data(), sizeof(Header));
+		if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.stream_count != STREAM_COUNT)
+			return false;
+		if (header.source_size != sourceSize || header.source_mtime != sourceMtime)
+			return false;
+		if (header.lod_count > MeshSimplifier::MAX_LODS)
+			return false;
+		uint64_t lodIndexCount = 0;
+		for (uint32_t i = 0; i < header.lod_count; i++)
+			lodIndexCount += header.lod_index_count[i];
+
+		const uint64_t expectedSizes[STREAM_COUNT] = {
+			header.vertex_count * sizeof(glm::vec3),
+			header.vertex_count * sizeof(glm::vec2),
+			header.vertex_count * sizeof(glm::vec3),
+			header.index_count * sizeof(unsigned int),
+			lodIndexCount * sizeof(unsigned int),
+		};
+		for (int i = 0; i < STREAM_COUNT; i++) {
+			const StreamEntry& stream = header.streams[i];
+			if (stream.size != expectedSizes[i] || stream.offset + stream.size > file.Size())
+				return false;
+		}
+
+		printf("Loading mesh cache %s...\n", cachePath.c_str());
+		const unsigned char* data = file.Data();
+		mesh.vertices.resize(header.vertex_count);
+		mesh.uvs.resize(header.vertex_count);
+		mesh.normals.resize(header.vertex_count);
+		mesh.indices.resize(header.index_count);
+		if (header.vertex_count > 0) {
+			memcpy(&mesh.vertices[0], data + header.streams[POSITIONS].offset, header.streams[POSITIONS].size);
+			memcpy(&mesh.uvs[0], data + header.streams[UVS].offset, header.streams[UVS].size);
+			memcpy(&mesh.normals[0], data + header.streams[NORMALS].offset, header.streams[NORMALS].size);
+		}
+		if (header.index_count > 0)
+			memcpy(&mesh.indices[0], data + header.streams[INDICES].offset, header.streams[INDICES].size);
+		mesh.lods.resize(header.lod_count);
+		const unsigned char* lodData = data + header.streams[LOD_INDICES].offset;
+		for (uint32_t i = 0; i < header.lod_count; i++) {
+			mesh.lods[i].indices.resize(header.lod_index_count[i]);
+			mesh.lods[i].error = header.lod_error[i];
+			if (header.lod_index_count[i] > 0)
+				memcpy(&mesh.lods[i].indices[0], lodData, header.lod_index_count[i] * sizeof(unsigned int));
+			lodData += header.lod_index_count[i] * sizeof(unsigned int);
+		}
+		mesh.bounds_min = glm::vec3(header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]);
+		mesh.bounds_max = glm::vec3(header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]);
+		mesh.sphere_center = glm::vec3(header.sphere_center[0], header.sphere_center[1], header.sphere_center[2]);
+		mesh.sphere_radius = header.sphere_radius;
+		return true;
+	}
+
+	/*
+	Writes the mesh to the cache file of the model.
+	The file is written to a temporary path first and then renamed, so a crash never leaves a half written cache behind
+	@param modelPath - The path of the .obj file (not the cache file)
+	@param mesh - The mesh as loaded from the .obj file, with its levels of detail
+	@returns True if the cache file was written
+	*/
+	bool Write(const char* modelPath, const MeshData& mesh) {
+		Header header;
+		memset(&header, 0, sizeof(Header));
+		if (!GetSourceStamp(modelPath, header.source_size, header.source_mtime))
+			return false;
+		if (mesh.uvs.size() != mesh.vertices.size() || mesh.normals.size() != mesh.vertices.size() || mesh.lods.size() > MeshSimplifier::MAX_LODS)
+			return false;
+
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.vertex_count = (uint32_t)mesh.vertices.size();
+		header.index_count = (uint32_t)mesh.indices.size();
+		header.stream_count = STREAM_COUNT;
+		for (int i = 0; i < 3; i++) {
+			header.bounds_min[i] = mesh.bounds_min[i];
+			header.bounds_max[i] = mesh.bounds_max[i];
+			header.sphere_center[i] = mesh.sphere_center[i];
+		}
+		header.sphere_radius = mesh.sphere_radius;
+		std::vector<unsigned int> lodIndices;
+		header.lod_count = (uint32_t)mesh.lods.size();
+		for (size_t i = 0; i < mesh.lods.size(); i++) {
+			header.lod_index_count[i] = (uint32_t)mesh.lods[i].indices.size();
+			header.lod_error[i] = mesh.lods[i].error;
+			lodIndices.insert(lodIndices.end(), mesh.lods[i].indices.begin(), mesh.lods[i].indices.end());
+		}
+
+		const void* streamData[STREAM_COUNT] = {
+			mesh.vertices.empty() ? nullptr : &mesh.vertices[0],
+			mesh.uvs.empty() ? nullptr : &mesh.uvs[0],
+			mesh.normals.empty() ? nullptr : &mesh.normals[0],
+			mesh.indices.empty() ? nullptr : &mesh.indices[0],
+			lodIndices.empty() ? nullptr : &lodIndices[0],
+		};
+		header.streams[POSITIONS].size = mesh.vertices.size() * sizeof(glm::vec3);
+		header.streams[UVS].size = mesh.uvs.size() * sizeof(glm::vec2);
+		header.streams[NORMALS].size = mesh.normals.size() * sizeof(glm::vec3);
+		header.streams[INDICES].size = mesh.indices.size() * sizeof(unsigned int);
+		header.streams[LOD_INDICES].size = lodIndices.size() * sizeof(unsigned int);
+		uint64_t offset = Align(sizeof(Header));
+		for (int i = 0; i < STREAM_COUNT; i++) {
+			header.streams[i].offset = offset;
+			offset = Align(offset + header.streams[i].size);
+		}
+
+		std::string cachePath = GetCachePath(modelPath);
+		std::string tempPath = cachePath + ".tmp";
+		FILE* file = fopen(tempPath.c_str(), "wb");
+		if (file == nullptr) {
+			printf("Could not write mesh cache %s\n", cachePath.c_str());
+			return false;
+		}
+
+		bool ok = fwrite(&header, sizeof(Header), 1, file) == 1;
+		const char padding[16] = {};
+		uint64_t written = sizeof(Header);
+		for (int i = 0; i < STREAM_COUNT && ok; i++) {
+			ok = fwrite(padding, 1, header.streams[i].offset - written, file) == header.streams[i].offset - written;
+			if (ok && header.streams[i].size > 0)
+				ok = fwrite(streamData[i], 1, header.streams[i].size, file) == header.streams[i].size;
+			written = header.streams[i].offset + header.streams[i].size;
+		}
+		ok = fclose(file) == 0 && ok;
+
+		if (ok) {
+			remove(cachePath.c_str());
+			ok = rename(tempPath.c_str(), cachePath.c_str()) == 0;
+		}
+		if (!ok) {
+			remove(tempPath.c_str());
+			printf("Could not write mesh cache %s\n", cachePath.c_str());
+		}
+		return ok;
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include "Mesh.h"
+
+/*
+A versioned binary copy of a model that sits next to the .obj it was made from (e.g. Objects/tree.obj.meshbin).
+The file is a fixed header followed by the raw attribute, index and level of detail index streams, so reading it is a memory map and a few memcpy's.
+The header records the size and modification time of the source, a changed .obj invalidates the cache.
+*/
+namespace MeshCache {
+	// Documented in MeshCache.cpp
+	std::string GetCachePath(const char* modelPath);
+	bool Load(const char* modelPath, MeshData& mesh);
+	bool Write(const char* modelPath, const MeshData& mesh);
+}
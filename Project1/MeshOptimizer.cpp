@@ -0,0 +1,466 @@
+#include <stdio.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "MeshOptimizer.h"
+#include "objloader.h"
+
+namespace MeshOptimizer {
+	const float CACHE_DECAY_POWER = 1.5f; // How fast the score drops further back in the cache
+	const float LAST_TRIANGLE_SCORE = 0.75f; // The score of the vertices of the last triangle, lower than the next ones so the strip doesn't turn back
+	const float VALENCE_BOOST_SCALE = 2.0f; // How much vertices with few triangles left are preferred, so no lonely triangles are left behind
+	const float VALENCE_BOOST_POWER = 0.5f; // How fast that preference drops with the amount of triangles left
+
+	/*
+	Forsyth's score of a vertex, higher is better to draw next
+	@param cachePosition - The position of the vertex in the cache, -1 if it is not in the cache
+	@param remaining - The amount of triangles of the vertex that were not drawn yet
+	@param cacheSize - The amount of entries of the cache
+	*/
+	static float VertexScore(int cachePosition, unsigned int remaining, unsigned int cacheSize) {
+		if (remaining == 0)
+			return -1.0f;
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			if (cachePosition < 3)
+				score = LAST_TRIANGLE_SCORE;
+			else
+				score = powf(1.0f - (float)(cachePosition - 3) / (cacheSize - 3), CACHE_DECAY_POWER);
+		}
+		return score + VALENCE_BOOST_SCALE * powf((float)remaining, -VALENCE_BOOST_POWER);
+	}
+
+	/*
+	A FIFO post-transform cache, a vertex is in the cache while fewer than size misses happened since it was added
+	*/
+	struct FifoCache {
+		std::vector<unsigned int> added; // The clock at which every vertex was last added
+		unsigned int clock; // Ticks once per miss
+		unsigned int size; // The amount of entries
+
+		FifoCache(size_t vertexCount, unsigned int cacheSize) : added(vertexCount, 0), clock(cacheSize + 1), size(cacheSize) {
+		}
+
+		/*
+		@returns 1 if the vertex had to be transformed
+		*/
+		unsigned int Use(unsigned int vertex) {
+			if (clock - added[vertex] <= size)
+				return 0;
+			added[vertex] = clock++;
+			return 1;
+		}
+
+		/*
+		Empties the cache
+		*/
+		void Flush() {
+			clock += size + 1;
+		}
+	};
+
+	/*
+	Reorders the triangles for the post-transform vertex cache with Forsyth's algorithm: every step draws the triangle
+	with the highest score among the triangles of the vertices in the cache, falling back to the first triangle not drawn yet
+	@param indices - The triangle list to reorder
+	@param vertexCount - The amount of vertices the indices point into
+	@param cacheSize - The amount of entries of the LRU cache the order is made for, more than 3
+	*/
+	void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return;
+
+		// The triangles of every vertex, the ones not drawn yet are kept at the front of the list of the vertex
+		std::vector<unsigned int> remaining(vertexCount, 0), start(vertexCount + 1, 0), triangles(indices.size());
+		for (size_t i = 0; i < indices.size(); i++)
+			remaining[indices[i]]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			start[v + 1] = start[v] + remaining[v];
+		std::vector<unsigned int> fill(start.begin(), start.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount), triangleScore(triangleCount, 0.0f);
+		std::vector<unsigned char> drawn(triangleCount, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+			vertexScore[v] = VertexScore(-1, remaining[v], cacheSize);
+		for (size_t i = 0; i < indices.size(); i++)
+			triangleScore[i / 3] += vertexScore[indices[i]];
+		int best = (int)(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+
+		std::vector<unsigned int> cache, newCache, result;
+		cache.reserve(cacheSize + 3);
+		newCache.reserve(cacheSize + 3);
+		result.reserve(indices.size());
+		size_t cursor = 0;
+		while (result.size() < indices.size()) {
+			if (best < 0) {
+				while (drawn[cursor])
+					cursor++;
+				best = (int)cursor;
+			}
+			const unsigned int* corners = &indices[best * 3];
+			drawn[best] = 1;
+			result.insert(result.end(), corners, corners + 3);
+
+			// Take the triangle out of the lists of its vertices
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = corners[k];
+				unsigned int* list = &triangles[start[v]];
+				unsigned int* last = list + remaining[v] - 1;
+				*std::find(list, last, (unsigned int)best) = *last;
+				remaining[v]--;
+			}
+
+			// The vertices of the triangle move to the front of the cache, the ones pushed out of the end lose their cache score
+			newCache.assign(corners, corners + 3);
+			for (unsigned int v : cache) {
+				if (v != corners[0] && v != corners[1] && v != corners[2])
+					newCache.push_back(v);
+			}
+			for (size_t i = cacheSize; i < newCache.size(); i++)
+				cachePosition[newCache[i]] = -1;
+			for (size_t i = 0; i < newCache.size(); i++) {
+				unsigned int v = newCache[i];
+				if (i < cacheSize)
+					cachePosition[v] = (int)i;
+				float score = VertexScore(cachePosition[v], remaining[v], cacheSize);
+				float delta = score - vertexScore[v];
+				vertexScore[v] = score;
+				for (unsigned int t = start[v]; t < start[v] + remaining[v]; t++)
+					triangleScore[triangles[t]] += delta;
+			}
+			if (newCache.size() > cacheSize)
+				newCache.resize(cacheSize);
+			cache.swap(newCache);
+
+			best = -1;
+			float bestScore = -FLT_MAX;
+			for (unsigned int v : cache) {
+				for (unsigned int t = start[v]; t < start[v] + remaining[v]; t++) {
+					if (triangleScore[triangles[t]] > bestScore) {
+						bestScore = triangleScore[triangles[t]];
+						best = (int)triangles[t];
+					}
+				}
+			}
+		}
+		indices.swap(result);
+	}
+
+	/*
+	Reorders clusters of triangles so the ones on the outside, facing away from the center, are drawn first.
+	The triangles must be in vertex cache order already, the clusters are the runs of it that start with a cold cache (hard boundaries)
+	split further wherever the cache miss ratio so far is within threshold of that of the whole run (soft boundaries),
+	so the vertex cache order is mostly kept
+	@param indices - The triangle list to reorder
+	@param vertices - The vertex positions
+	@param threshold - How much the ACMR of a cluster may be above that of its run, 1 only splits at hard boundaries
+	*/
+	void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& vertices, float threshold) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return;
+
+		std::vector<size_t> hard;
+		FifoCache cache(vertices.size(), ANALYZE_CACHE_SIZE);
+		for (size_t t = 0; t < triangleCount; t++) {
+			unsigned int misses = cache.Use(indices[t * 3]) + cache.Use(indices[t * 3 + 1]) + cache.Use(indices[t * 3 + 2]);
+			if (t == 0 || misses == 3)
+				hard.push_back(t);
+		}
+		hard.push_back(triangleCount);
+
+		std::vector<size_t> clusters;
+		for (size_t h = 0; h + 1 < hard.size(); h++) {
+			size_t begin = hard[h], end = hard[h + 1];
+			cache.Flush();
+			unsigned int runMisses = 0;
+			for (size_t t = begin; t < end; t++)
+				runMisses += cache.Use(indices[t * 3]) + cache.Use(indices[t * 3 + 1]) + cache.Use(indices[t * 3 + 2]);
+			float limit = threshold * runMisses / (end - begin);
+
+			cache.Flush();
+			clusters.push_back(begin);
+			unsigned int misses = 0;
+			size_t clusterStart = begin;
+			for (size_t t = begin; t + 1 < end; t++) {
+				misses += cache.Use(indices[t * 3]) + cache.Use(indices[t * 3 + 1]) + cache.Use(indices[t * 3 + 2]);
+				if ((float)misses / (t + 1 - clusterStart) <= limit) {
+					clusters.push_back(t + 1);
+					clusterStart = t + 1;
+					misses = 0;
+					cache.Flush();
+				}
+			}
+		}
+		clusters.push_back(triangleCount);
+
+		// The area weighted center of the model and of every cluster, and the area weighted normal of every cluster
+		size_t clusterCount = clusters.size() - 1;
+		glm::vec3 meshCenter(0.0f);
+		float meshArea = 0.0f;
+		std::vector<glm::vec3> centers(clusterCount, glm::vec3(0.0f)), normals(clusterCount, glm::vec3(0.0f));
+		for (size_t c = 0; c < clusterCount; c++) {
+			float clusterArea = 0.0f;
+			for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+				const glm::vec3& a = vertices[indices[t * 3]];
+				const glm::vec3& b = vertices[indices[t * 3 + 1]];
+				const glm::vec3& d = vertices[indices[t * 3 + 2]];
+				glm::vec3 normal = glm::cross(b - a, d - a);
+				float area = glm::length(normal);
+				centers[c] += (a + b + d) * (area / 3.0f);
+				normals[c] += normal;
+				clusterArea += area;
+			}
+			meshCenter += centers[c];
+			meshArea += clusterArea;
+			if (clusterArea > 0.0f)
+				centers[c] /= clusterArea;
+		}
+		if (meshArea > 0.0f)
+			meshCenter /= meshArea;
+
+		// Clusters further out along their normal are more likely to hide others
+		std::vector<float> keys(clusterCount);
+		std::vector<size_t> order(clusterCount);
+		for (size_t c = 0; c < clusterCount; c++) {
+			float length = glm::length(normals[c]);
+			keys[c] = length > 0.0f ? glm::dot(centers[c] - meshCenter, normals[c] / length) : 0.0f;
+			order[c] = c;
+		}
+		std::stable_sort(order.begin(), order.end(), [&keys](size_t x, size_t y) { return keys[x] > keys[y]; });
+
+		std::vector<unsigned int> result;
+		result.reserve(indices.size());
+		for (size_t c : order)
+			result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+		indices.swap(result);
+	}
+
+	/*
+	Reorders the vertices in the order the triangles of the full model first use them, and renumbers the indices of the model
+	and its levels of detail. Vertices that no triangle uses are kept at the end
+	@param mesh - The model
+	*/
+	void OptimizeVertexFetch(MeshData& mesh) {
+		const unsigned int UNUSED = ~0u;
+		size_t vertexCount = mesh.vertices.size();
+		std::vector<unsigned int> remap(vertexCount, UNUSED);
+		unsigned int next = 0;
+		for (unsigned int index : mesh.indices) {
+			if (remap[index] == UNUSED)
+				remap[index] = next++;
+		}
+		for (const MeshLod& lod : mesh.lods) {
+			for (unsigned int index : lod.indices) {
+				if (remap[index] == UNUSED)
+					remap[index] = next++;
+			}
+		}
+		for (size_t v = 0; v < vertexCount; v++) {
+			if (remap[v] == UNUSED)
+				remap[v] = next++;
+		}
+
+		std::vector<glm::vec3> vertices(vertexCount), normals(mesh.normals.size());
+		std::vector<glm::vec2> uvs(mesh.uvs.size());
+		for (size_t v = 0; v < vertexCount; v++) {
+			vertices[remap[v]] = mesh.vertices[v];
+			if (v < uvs.size())
+				uvs[remap[v]] = mesh.uvs[v];
+			if (v < normals.size())
+				normals[remap[v]] = mesh.normals[v];
+		}
+		mesh.vertices.swap(vertices);
+		mesh.uvs.swap(uvs);
+		mesh.normals.swap(normals);
+		for (unsigned int& index : mesh.indices)
+			index = remap[index];
+		for (MeshLod& lod : mesh.lods) {
+			for (unsigned int& index : lod.indices)
+				index = remap[index];
+		}
+	}
+
+	/*
+	Rasterizes the triangles in order into a depth buffer, looking along an axis
+	@param axis - The axis the view looks along
+	@param direction - 1 to look along the axis, -1 to look against it
+	@param shaded - Increased by the fragments that passed the depth test
+	@param covered - Increased by the pixels that were drawn at all
+	*/
+	static void RasterizeView(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& vertices, const glm::vec3& boundsMin, float scale,
+		int axis, float direction, size_t& shaded, size_t& covered) {
+		int u = (axis + 1) % 3, v = (axis + 2) % 3;
+		std::vector<float> depth((size_t)OVERDRAW_GRID * OVERDRAW_GRID, FLT_MAX);
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			float x[3], y[3], z[3];
+			for (int k = 0; k < 3; k++) {
+				const glm::vec3& p = vertices[indices[i + k]];
+				x[k] = (p[u] - boundsMin[u]) * scale;
+				y[k] = (p[v] - boundsMin[v]) * scale;
+				z[k] = p[axis] * direction;
+			}
+			float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+			if (area == 0.0f)
+				continue;
+			int minX = std::max(0, (int)floorf(std::min(x[0], std::min(x[1], x[2]))));
+			int maxX = std::min((int)OVERDRAW_GRID - 1, (int)ceilf(std::max(x[0], std::max(x[1], x[2]))));
+			int minY = std::max(0, (int)floorf(std::min(y[0], std::min(y[1], y[2]))));
+			int maxY = std::min((int)OVERDRAW_GRID - 1, (int)ceilf(std::max(y[0], std::max(y[1], y[2]))));
+			for (int py = minY; py <= maxY; py++) {
+				for (int px = minX; px <= maxX; px++) {
+					// The edge functions of the pixel center, divided by the area so they are barycentric whatever the winding
+					float cx = px + 0.5f, cy = py + 0.5f;
+					float w0 = ((x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1])) / area;
+					float w1 = ((x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2])) / area;
+					float w2 = 1.0f - w0 - w1;
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+						continue;
+					float d = w0 * z[0] + w1 * z[1] + w2 * z[2];
+					float& stored = depth[(size_t)py * OVERDRAW_GRID + px];
+					if (d >= stored)
+						continue;
+					if (stored == FLT_MAX)
+						covered++;
+					stored = d;
+					shaded++;
+				}
+			}
+		}
+	}
+
+	/*
+	@param indices - The triangle list
+	@param vertexCount - The amount of vertices the indices point into
+	@returns The vertex shader runs per triangle with a FIFO cache of ANALYZE_CACHE_SIZE entries, 0 without triangles
+	*/
+	float CacheMissRatio(const std::vector<unsigned int>& indices, size_t vertexCount) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return 0.0f;
+		FifoCache cache(vertexCount, ANALYZE_CACHE_SIZE);
+		unsigned int misses = 0;
+		for (unsigned int index : indices)
+			misses += cache.Use(index);
+		return (float)misses / triangleCount;
+	}
+
+	/*
+	Measures the cache miss ratio and the overdraw of a triangle list.
+	The overdraw is measured like the scene draws, with the depth test and without face culling
+	@param indices - The triangle list
+	@param vertices - The vertex positions
+	@returns The statistics
+	*/
+	MeshStatistics Analyze(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& vertices) {
+		MeshStatistics statistics;
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return statistics;
+
+		statistics.acmr = CacheMissRatio(indices, vertices.size());
+
+		glm::vec3 boundsMin = vertices[indices[0]], boundsMax = boundsMin;
+		for (unsigned int index : indices) {
+			boundsMin = glm::min(boundsMin, vertices[index]);
+			boundsMax = glm::max(boundsMax, vertices[index]);
+		}
+		glm::vec3 size = boundsMax - boundsMin;
+		float extent = std::max(size.x, std::max(size.y, size.z));
+		float scale = extent > 0.0f ? (OVERDRAW_GRID - 1) / extent : 0.0f;
+		size_t shaded = 0, covered = 0;
+		for (int axis = 0; axis < 3; axis++) {
+			RasterizeView(indices, vertices, boundsMin, scale, axis, 1.0f, shaded, covered);
+			RasterizeView(indices, vertices, boundsMin, scale, axis, -1.0f, shaded, covered);
+		}
+		statistics.overdraw = covered > 0 ? (float)shaded / covered : 1.0f;
+		return statistics;
+	}
+
+	/*
+	Reorders a triangle list for the vertex cache, made for every LRU cache size up to MAX_CACHE_SCALE times ANALYZE_CACHE_SIZE
+	because Forsyth's scores assume an LRU cache and the ACMR is measured with a FIFO one. The order with the lowest ACMR is kept,
+	the input order if none is better
+	@param indices - The triangle list to reorder
+	@param vertexCount - The amount of vertices the indices point into
+	*/
+	static void OptimizeVertexCacheMeasured(std::vector<unsigned int>& indices, size_t vertexCount) {
+		float bestAcmr = CacheMissRatio(indices, vertexCount);
+		std::vector<unsigned int> best = indices, candidate;
+		for (unsigned int scale = 1; scale <= MAX_CACHE_SCALE; scale++) {
+			candidate = indices;
+			OptimizeVertexCache(candidate, vertexCount, ANALYZE_CACHE_SIZE * scale);
+			float acmr = CacheMissRatio(candidate, vertexCount);
+			if (acmr < bestAcmr) {
+				bestAcmr = acmr;
+				best.swap(candidate);
+			}
+		}
+		indices.swap(best);
+	}
+
+	/*
+	Reorders a triangle list for the vertex cache and then for overdraw. The overdraw order is dropped if it has a higher ACMR
+	than the input, the vertex cache order is kept then
+	@param indices - The triangle list to reorder
+	@param vertices - The vertex positions
+	*/
+	static void OptimizeTriangles(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& vertices) {
+		float acmr = CacheMissRatio(indices, vertices.size());
+		OptimizeVertexCacheMeasured(indices, vertices.size());
+		std::vector<unsigned int> cached = indices;
+		OptimizeOverdraw(indices, vertices, OVERDRAW_THRESHOLD);
+		if (CacheMissRatio(indices, vertices.size()) > acmr)
+			indices.swap(cached);
+	}
+
+	/*
+	Optimizes the model and its levels of detail for the vertex cache and overdraw, then the vertices for fetch.
+	The ACMR of every triangle list is never worse than before
+	@param mesh - The model
+	@param before - Set to the statistics of the full model before
+	@param after - Set to the statistics of the full model after
+	*/
+	void Optimize(MeshData& mesh, MeshStatistics& before, MeshStatistics& after) {
+		before = Analyze(mesh.indices, mesh.vertices);
+		OptimizeTriangles(mesh.indices, mesh.vertices);
+		for (MeshLod& lod : mesh.lods)
+			OptimizeTriangles(lod.indices, mesh.vertices);
+		OptimizeVertexFetch(mesh);
+		after = Analyze(mesh.indices, mesh.vertices);
+	}
+
+	/*
+	Parses an .obj file and prints the statistics of every step of Optimize, without touching its mesh cache
+	@param modelPath - The path of the .obj file
+	@returns False if the file could not be read
+	*/
+	bool PrintReport(const char* modelPath) {
+		MeshData mesh;
+		if (!loadOBJ(modelPath, mesh.vertices, mesh.uvs, mesh.normals, mesh.indices))
+			return false;
+		MeshStatistics loaded = Analyze(mesh.indices, mesh.vertices);
+		OptimizeVertexCacheMeasured(mesh.indices, mesh.vertices.size());
+		MeshStatistics cached = Analyze(mesh.indices, mesh.vertices);
+		std::vector<unsigned int> cachedIndices = mesh.indices;
+		OptimizeOverdraw(mesh.indices, mesh.vertices, OVERDRAW_THRESHOLD);
+		MeshStatistics overdraw = Analyze(mesh.indices, mesh.vertices);
+		// The same choice as OptimizeTriangles, so the last line is what Optimize writes to the mesh cache
+		bool dropped = overdraw.acmr > loaded.acmr;
+		if (dropped)
+			mesh.indices.swap(cachedIndices);
+		OptimizeVertexFetch(mesh);
+		MeshStatistics optimized = Analyze(mesh.indices, mesh.vertices);
+		printf("%s: %zu triangles, %zu vertices\n", modelPath, mesh.indices.size() / 3, mesh.vertices.size());
+		printf("  as loaded:    ACMR %.3f, overdraw %.3f\n", loaded.acmr, loaded.overdraw);
+		printf("  vertex cache: ACMR %.3f, overdraw %.3f\n", cached.acmr, cached.overdraw);
+		printf("  overdraw:     ACMR %.3f, overdraw %.3f%s\n", overdraw.acmr, overdraw.overdraw, dropped ? " (dropped, worse ACMR than loaded)" : "");
+		printf("  optimized:    ACMR %.3f, overdraw %.3f (after vertex fetch)\n", optimized.acmr, optimized.overdraw);
+		return true;
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+
+/*
+How well an index buffer uses the post-transform cache and the depth test, as measured by MeshOptimizer::Analyze
+*/
+struct MeshStatistics {
+	float acmr = 0.0f; // The average cache miss ratio, vertex shader runs per triangle with a FIFO cache of ANALYZE_CACHE_SIZE entries (3 is the worst)
+	float overdraw = 0.0f; // The fragments that pass the depth test per covered pixel, averaged over six axis aligned views (1 is no overdraw)
+};
+
+/*
+Reorders the triangles and vertices of a model so the GPU does less work drawing the same thing:
+the triangles for the post-transform vertex cache (Forsyth's linear speed algorithm), then clusters of them
+so the ones facing outward are drawn first and hide the rest (Sander, Nehab and Barczak), and the vertices in the order
+the triangles first use them so vertex fetch reads memory front to back.
+The new triangle order is never one with a higher ACMR than the loaded order
+*/
+namespace MeshOptimizer {
+	const unsigned int ANALYZE_CACHE_SIZE = 16; // The size of the FIFO cache that ACMR is measured with and the clusters are found with
+	const unsigned int MAX_CACHE_SCALE = 3; // The vertex cache order is made for LRU caches of 1 to this many times ANALYZE_CACHE_SIZE, the one with the lowest ACMR is kept
+	const float OVERDRAW_THRESHOLD = 1.05f; // How much the overdraw pass may raise the ACMR of a cluster to get more, smaller clusters
+	const unsigned int OVERDRAW_GRID = 256; // The resolution of the views the overdraw is measured in
+
+	// Documented in MeshOptimizer.cpp
+	void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize);
+	void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& vertices, float threshold);
+	void OptimizeVertexFetch(MeshData& mesh);
+	float CacheMissRatio(const std::vector<unsigned int>& indices, size_t vertexCount);
+	MeshStatistics Analyze(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& vertices);
+	void Optimize(MeshData& mesh, MeshStatistics& before, MeshStatistics& after);
+	bool PrintReport(const char* modelPath);
+}
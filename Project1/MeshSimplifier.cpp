@@ -0,0 +1,453 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshSimplifier.h"
+
+namespace MeshSimplifier {
+	const double BORDER_WEIGHT = 10.0; // How much more the planes through open borders count than the triangles, keeps holes from growing
+	const float COLLAPSE_FRACTION = 1.0f / 3.0f; // Every pass only tries the cheapest part of the candidates, so cheap collapses that were locked get another chance first
+	const int MAX_PASSES = 100; // Stops a model that can't reach its targets
+
+	/*
+	The summed squared distance to a set of planes, the symmetric 4x4 matrix of Garland and Heckbert
+	*/
+	struct Quadric {
+		double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0; // The upper 3x3 of the matrix, n n^T of every plane
+		double b0 = 0, b1 = 0, b2 = 0; // n d of every plane
+		double c = 0; // d d of every plane
+		double weight = 0; // The summed area of the triangles, the error is divided by it so it stays a squared distance
+
+		/*
+		Adds the plane through a point with a normal
+		@param normal - The unit normal of the plane
+		@param point - A point on the plane
+		@param w - How much the plane counts
+		*/
+		void AddPlane(const glm::vec3& normal, const glm::vec3& point, double w) {
+			double x = normal.x, y = normal.y, z = normal.z;
+			double d = -(x * point.x + y * point.y + z * point.z);
+			a00 += w * x * x; a11 += w * y * y; a22 += w * z * z;
+			a01 += w * x * y; a02 += w * x * z; a12 += w * y * z;
+			b0 += w * x * d; b1 += w * y * d; b2 += w * z * d;
+			c += w * d * d;
+		}
+
+		void Add(const Quadric& q) {
+			a00 += q.a00; a11 += q.a11; a22 += q.a22;
+			a01 += q.a01; a02 += q.a02; a12 += q.a12;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			weight += q.weight;
+		}
+
+		/*
+		@returns The weighted mean squared distance of the point to the planes
+		*/
+		double Evaluate(const glm::vec3& p) const {
+			double x = p.x, y = p.y, z = p.z;
+			double error = a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z) + 2 * (b0 * x + b1 * y + b2 * z) + c;
+			error = std::max(error, 0.0);
+			return weight > 0 ? error / weight : error;
+		}
+	};
+
+	/*
+	What a position may collapse onto
+	*/
+	enum class VertexKind : unsigned char {
+		MANIFOLD, // Anywhere
+		BORDER, // Only along an open border
+		LOCKED, // Nowhere, the position has an edge shared by more than two triangles
+	};
+
+	/*
+	Moving one position onto a neighbour
+	*/
+	struct Collapse {
+		unsigned int from, to; // The positions
+		double cost; // The error at the position of to
+	};
+
+	/*
+	The bits of a position, used to find the vertices that share it
+	*/
+	struct PositionKey {
+		uint32_t bits[3];
+		bool operator==(const PositionKey& other) const {
+			return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+		}
+	};
+
+	struct PositionKeyHash {
+		size_t operator()(const PositionKey& key) const {
+			return (size_t)(key.bits[0] * 73856093u ^ key.bits[1] * 19349663u ^ key.bits[2] * 83492791u);
+		}
+	};
+
+	/*
+	The simplification of one model, positions are named by the first vertex that has them
+	*/
+	struct State {
+		const MeshData& mesh;
+		std::vector<unsigned int> indices; // The current triangle list
+		std::vector<unsigned int> position; // The position of every vertex
+		std::vector<Quadric> quadrics; // The quadric of every position
+		std::vector<VertexKind> kinds; // The kind of every position, for the current pass
+		std::vector<unsigned int> triangleStart; // Where the triangles of every position start in triangleList
+		std::vector<unsigned int> triangleList; // The triangles around every position
+		std::unordered_map<uint64_t, unsigned int> edges; // How often every directed edge between positions appears
+		std::vector<unsigned int> remap; // The vertex every vertex is replaced with at the end of the pass
+		std::vector<unsigned char> touched; // The positions that can't collapse any more in this pass
+
+		explicit State(const MeshData& data) : mesh(data) {
+		}
+
+		static uint64_t EdgeKey(unsigned int a, unsigned int b) {
+			return ((uint64_t)a << 32) | b;
+		}
+
+		bool IsBorderEdge(unsigned int a, unsigned int b) const {
+			return (edges.count(EdgeKey(a, b)) != 0) != (edges.count(EdgeKey(b, a)) != 0);
+		}
+	};
+
+	/*
+	Names every vertex by the first vertex with the same position
+	*/
+	static void WeldPositions(State& state) {
+		const std::vector<glm::vec3>& vertices = state.mesh.vertices;
+		std::unordered_map<PositionKey, unsigned int, PositionKeyHash> first;
+		first.reserve(vertices.size());
+		state.position.resize(vertices.size());
+		for (unsigned int i = 0; i < (unsigned int)vertices.size(); i++) {
+			PositionKey key;
+			memcpy(key.bits, &vertices[i].x, sizeof(key.bits));
+			state.position[i] = first.emplace(key, i).first->second;
+		}
+	}
+
+	/*
+	Counts the directed edges between positions and finds the kind of every position
+	*/
+	static void ClassifyPositions(State& state) {
+		state.edges.clear();
+		for (size_t i = 0; i < state.indices.size(); i += 3) {
+			for (int k = 0; k < 3; k++) {
+				unsigned int a = state.position[state.indices[i + k]], b = state.position[state.indices[i + (k + 1) % 3]];
+				state.edges[State::EdgeKey(a, b)]++;
+			}
+		}
+		std::fill(state.kinds.begin(), state.kinds.end(), VertexKind::MANIFOLD);
+		for (const auto& edge : state.edges) {
+			unsigned int a = (unsigned int)(edge.first >> 32), b = (unsigned int)edge.first;
+			if (edge.second > 1) {
+				state.kinds[a] = state.kinds[b] = VertexKind::LOCKED;
+			} else if (state.edges.count(State::EdgeKey(b, a)) == 0) {
+				if (state.kinds[a] != VertexKind::LOCKED)
+					state.kinds[a] = VertexKind::BORDER;
+				if (state.kinds[b] != VertexKind::LOCKED)
+					state.kinds[b] = VertexKind::BORDER;
+			}
+		}
+	}
+
+	/*
+	Lists the triangles around every position
+	*/
+	static void BuildAdjacency(State& state) {
+		std::fill(state.triangleStart.begin(), state.triangleStart.end(), 0);
+		for (size_t i = 0; i < state.indices.size(); i++)
+			state.triangleStart[state.position[state.indices[i]] + 1]++;
+		for (size_t i = 1; i < state.triangleStart.size(); i++)
+			state.triangleStart[i] += state.triangleStart[i - 1];
+		state.triangleList.resize(state.indices.size());
+		std::vector<unsigned int> fill(state.triangleStart.begin(), state.triangleStart.end() - 1);
+		for (size_t i = 0; i < state.indices.size(); i++)
+			state.triangleList[fill[state.position[state.indices[i]]]++] = (unsigned int)(i / 3);
+	}
+
+	/*
+	Sums the planes of the triangles into the quadrics of their positions, and adds a plane through every open border edge
+	that stands perpendicular on its triangle so the border keeps its shape
+	*/
+	static void BuildQuadrics(State& state) {
+		const std::vector<glm::vec3>& vertices = state.mesh.vertices;
+		state.quadrics.assign(vertices.size(), Quadric());
+		for (size_t i = 0; i < state.indices.size(); i += 3) {
+			unsigned int p[3] = { state.position[state.indices[i]], state.position[state.indices[i + 1]], state.position[state.indices[i + 2]] };
+			glm::vec3 normal = glm::cross(vertices[p[1]] - vertices[p[0]], vertices[p[2]] - vertices[p[0]]);
+			float length = glm::length(normal);
+			if (length == 0.0f)
+				continue;
+			normal /= length;
+			double area = length * 0.5;
+			for (int k = 0; k < 3; k++) {
+				Quadric& q = state.quadrics[p[k]];
+				q.AddPlane(normal, vertices[p[0]], area);
+				q.weight += area;
+			}
+			for (int k = 0; k < 3; k++) {
+				unsigned int a = p[k], b = p[(k + 1) % 3];
+				if (!state.IsBorderEdge(a, b))
+					continue;
+				glm::vec3 edge = vertices[b] - vertices[a];
+				glm::vec3 borderNormal = glm::cross(edge, normal);
+				float borderLength = glm::length(borderNormal);
+				if (borderLength == 0.0f)
+					continue;
+				double w = glm::dot(edge, edge) * BORDER_WEIGHT;
+				state.quadrics[a].AddPlane(borderNormal / borderLength, vertices[a], w);
+				state.quadrics[b].AddPlane(borderNormal / borderLength, vertices[a], w);
+			}
+		}
+	}
+
+	/*
+	Finds the collapses the kinds allow, with their cost, cheapest first
+	*/
+	static std::vector<Collapse> FindCollapses(const State& state) {
+		std::vector<Collapse> collapses;
+		collapses.reserve(state.indices.size());
+		for (size_t i = 0; i < state.indices.size(); i += 3) {
+			for (int k = 0; k < 3; k++) {
+				unsigned int a = state.position[state.indices[i + k]], b = state.position[state.indices[i + (k + 1) % 3]];
+				// Inner edges are in two triangles, only take them once
+				bool border = state.IsBorderEdge(a, b);
+				if (!border && a > b)
+					continue;
+				for (int direction = 0; direction < 2; direction++) {
+					unsigned int from = direction == 0 ? a : b, to = direction == 0 ? b : a;
+					VertexKind kind = state.kinds[from];
+					if (kind == VertexKind::LOCKED || (kind == VertexKind::BORDER && !border))
+						continue;
+					Quadric q = state.quadrics[from];
+					q.Add(state.quadrics[to]);
+					collapses.push_back({ from, to, q.Evaluate(state.mesh.vertices[to]) });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+		return collapses;
+	}
+
+	/*
+	Collapses a position onto another if no triangle around it flips and every uv of it continues across the edge.
+	The vertices of from are mapped to the vertex of to with the uv on the other side of the edge and the closest normal
+	@returns True if the collapse was made
+	*/
+	static bool TryCollapse(State& state, unsigned int from, unsigned int to) {
+		const MeshData& mesh = state.mesh;
+		const unsigned int* triangles = &state.triangleList[state.triangleStart[from]];
+		unsigned int triangleCount = state.triangleStart[from + 1] - state.triangleStart[from];
+
+		// The triangles that stay must not turn over
+		for (unsigned int t = 0; t < triangleCount; t++) {
+			const unsigned int* corners = &state.indices[triangles[t] * 3];
+			unsigned int p[3] = { state.position[corners[0]], state.position[corners[1]], state.position[corners[2]] };
+			if (p[0] == to || p[1] == to || p[2] == to)
+				continue;
+			glm::vec3 before[3], after[3];
+			for (int k = 0; k < 3; k++) {
+				before[k] = mesh.vertices[p[k]];
+				after[k] = p[k] == from ? mesh.vertices[to] : before[k];
+			}
+			glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			if (glm::dot(normalBefore, normalBefore) > 0.0f && glm::dot(normalBefore, normalAfter) <= 0.0f)
+				return false;
+		}
+
+		// The vertices on both ends, and which vertex of from meets which vertex of to in the triangles on the edge
+		std::vector<unsigned int> fromVertices, toVertices;
+		std::vector<std::pair<unsigned int, unsigned int>> across;
+		for (unsigned int t = 0; t < triangleCount; t++) {
+			const unsigned int* corners = &state.indices[triangles[t] * 3];
+			unsigned int fromVertex = 0, toVertex = 0;
+			bool onEdge = false;
+			for (int k = 0; k < 3; k++) {
+				unsigned int p = state.position[corners[k]];
+				if (p == from)
+					fromVertex = corners[k];
+				if (p == to) {
+					toVertex = corners[k];
+					onEdge = true;
+				}
+			}
+			if (std::find(fromVertices.begin(), fromVertices.end(), fromVertex) == fromVertices.end())
+				fromVertices.push_back(fromVertex);
+			if (onEdge)
+				across.push_back(std::make_pair(fromVertex, toVertex));
+		}
+		for (unsigned int i = state.triangleStart[to]; i < state.triangleStart[to + 1]; i++) {
+			const unsigned int* corners = &state.indices[state.triangleList[i] * 3];
+			for (int k = 0; k < 3; k++) {
+				if (state.position[corners[k]] == to && std::find(toVertices.begin(), toVertices.end(), corners[k]) == toVertices.end())
+					toVertices.push_back(corners[k]);
+			}
+		}
+
+		std::vector<std::pair<unsigned int, unsigned int>> mapping;
+		for (unsigned int vertex : fromVertices) {
+			// A uv that doesn't reach the edge lies on the other side of a seam, collapsing it would stretch the texture
+			const glm::vec2* uv = nullptr;
+			for (const auto& pair : across) {
+				if (pair.first == vertex || mesh.uvs[pair.first] == mesh.uvs[vertex]) {
+					uv = &mesh.uvs[pair.second];
+					break;
+				}
+			}
+			if (uv == nullptr)
+				return false;
+			unsigned int best = 0;
+			float bestDot = -2.0f;
+			for (unsigned int candidate : toVertices) {
+				float d = glm::dot(mesh.normals[vertex], mesh.normals[candidate]);
+				if (mesh.uvs[candidate] == *uv && d > bestDot) {
+					best = candidate;
+					bestDot = d;
+				}
+			}
+			mapping.push_back(std::make_pair(vertex, best));
+		}
+
+		for (const auto& pair : mapping)
+			state.remap[pair.first] = pair.second;
+		state.quadrics[to].Add(state.quadrics[from]);
+		state.touched[to] = 1;
+		for (unsigned int t = 0; t < triangleCount; t++) {
+			const unsigned int* corners = &state.indices[triangles[t] * 3];
+			for (int k = 0; k < 3; k++)
+				state.touched[state.position[corners[k]]] = 1;
+		}
+		return true;
+	}
+
+	/*
+	Applies the collapses of a pass, dropping the triangles that lost an edge
+	*/
+	static void ApplyCollapses(State& state) {
+		size_t write = 0;
+		for (size_t i = 0; i < state.indices.size(); i += 3) {
+			unsigned int v[3] = { state.remap[state.indices[i]], state.remap[state.indices[i + 1]], state.remap[state.indices[i + 2]] };
+			unsigned int p[3] = { state.position[v[0]], state.position[v[1]], state.position[v[2]] };
+			if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2])
+				continue;
+			for (int k = 0; k < 3; k++)
+				state.indices[write++] = v[k];
+		}
+		state.indices.resize(write);
+		for (unsigned int i = 0; i < (unsigned int)state.remap.size(); i++)
+			state.remap[i] = i;
+		std::fill(state.touched.begin(), state.touched.end(), 0);
+	}
+
+	/*
+	Simplifies a model in passes of independent edge collapses, cheapest first, and keeps a copy of the triangles
+	every time a target is reached. The quadrics keep adding up, so the error of every copy is measured against the full model.
+	Collapses that would move the surface more than MAX_RELATIVE_ERROR of the bounding sphere radius are never made
+	@param mesh - The model with its bounds calculated, uvs and normals must have an entry per vertex
+	@param targetTriangles - The triangle counts to stop at, largest first
+	@returns A level per target that was reached, and one more with as few triangles as the simplifier could manage if it got stuck before the next target
+	*/
+	std::vector<MeshLod> Simplify(const MeshData& mesh, const std::vector<size_t>& targetTriangles) {
+		State state(mesh);
+		size_t vertexCount = mesh.vertices.size();
+		state.indices = mesh.indices;
+		state.kinds.resize(vertexCount);
+		state.triangleStart.resize(vertexCount + 1);
+		state.remap.resize(vertexCount);
+		state.touched.assign(vertexCount, 0);
+		for (unsigned int i = 0; i < (unsigned int)vertexCount; i++)
+			state.remap[i] = i;
+		WeldPositions(state);
+		ClassifyPositions(state);
+		BuildQuadrics(state);
+
+		std::vector<MeshLod> lods;
+		double maxCost = 0.0;
+		double costLimit = (double)mesh.sphere_radius * MAX_RELATIVE_ERROR * mesh.sphere_radius * MAX_RELATIVE_ERROR;
+		size_t target = 0;
+		for (int pass = 0; pass < MAX_PASSES && target < targetTriangles.size(); pass++) {
+			size_t triangles = state.indices.size() / 3;
+			if (pass > 0)
+				ClassifyPositions(state);
+			BuildAdjacency(state);
+			std::vector<Collapse> collapses = FindCollapses(state);
+
+			// An inner collapse removes two triangles
+			size_t goal = std::max<size_t>(1, (triangles - std::min(triangles, targetTriangles[target]) + 1) / 2);
+			size_t tries = std::max<size_t>(1, (size_t)(collapses.size() * COLLAPSE_FRACTION));
+			size_t made = 0;
+			for (size_t i = 0; i < collapses.size() && made < goal; i++) {
+				// Past the cheap part of the list a pass only makes the first collapse it can, so the next pass starts from the cheap ones again
+				if (i >= tries && made > 0)
+					break;
+				const Collapse& collapse = collapses[i];
+				if (collapse.cost > costLimit)
+					break;
+				if (state.touched[collapse.from] || state.touched[collapse.to])
+					continue;
+				if (!TryCollapse(state, collapse.from, collapse.to))
+					continue;
+				maxCost = std::max(maxCost, collapse.cost);
+				made++;
+			}
+			ApplyCollapses(state);
+			// The positions were classified again at the start of the pass, so a pass without collapses would be repeated exactly
+			if (made == 0)
+				break;
+
+			while (target < targetTriangles.size() && state.indices.size() / 3 <= targetTriangles[target]) {
+				MeshLod lod;
+				lod.indices = state.indices;
+				lod.error = (float)sqrt(maxCost);
+				lods.push_back(std::move(lod));
+				target++;
+			}
+		}
+		// The next target was not reached, what was simplified towards it may still be worth a level
+		size_t last = lods.empty() ? mesh.indices.size() : lods.back().indices.size();
+		if (target < targetTriangles.size() && state.indices.size() < last) {
+			MeshLod lod;
+			lod.indices = state.indices;
+			lod.error = (float)sqrt(maxCost);
+			lods.push_back(std::move(lod));
+		}
+		return lods;
+	}
+
+	/*
+	Makes up to MAX_LODS levels of detail for a model, every one with about LOD_RATIO of the triangles of the one above.
+	Stops early when a level would barely be smaller (e.g. a box or a model that is all seams) or would be too far off to ever be seen
+	@param mesh - The model with its bounds calculated, its lods are replaced
+	*/
+	void BuildLods(MeshData& mesh) {
+		mesh.lods.clear();
+		size_t triangles = mesh.indices.size() / 3;
+		if (triangles < MIN_TRIANGLES || mesh.uvs.size() != mesh.vertices.size() || mesh.normals.size() != mesh.vertices.size())
+			return;
+
+		std::vector<size_t> targets;
+		float target = (float)triangles;
+		for (unsigned int i = 0; i < MAX_LODS; i++) {
+			target *= LOD_RATIO;
+			targets.push_back((size_t)target);
+		}
+
+		std::vector<MeshLod> lods = Simplify(mesh, targets);
+		size_t previous = triangles;
+		float error = 0.0f;
+		for (MeshLod& lod : lods) {
+			size_t count = lod.indices.size() / 3;
+			if (count == 0 || count > previous * MIN_REDUCTION || lod.error > mesh.sphere_radius * MAX_RELATIVE_ERROR)
+				break;
+			error = std::max(error, lod.error);
+			lod.error = error;
+			previous = count;
+			mesh.lods.push_back(std::move(lod));
+		}
+	}
+}
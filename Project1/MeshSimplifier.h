@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+#include "Mesh.h"
+
+/*
+Makes the lower levels of detail of a model with quadric error metric edge collapses (Garland and Heckbert).
+The levels only have their own index list, they draw the vertices of the full model.
+Vertices with the same position are simplified as one, a collapse picks for every corner the vertex of the other end
+whose uv matches across the collapsed edge and whose normal is closest, so flat shaded models keep their facets
+and uv seams are only collapsed along the seam. Open borders only collapse along the border.
+Every level records its error, the distance (in model units) the surface moved from the full model as measured by the quadrics
+*/
+namespace MeshSimplifier {
+	const unsigned int MAX_LODS = 3; // The amount of levels made below the full model
+	const float LOD_RATIO = 0.35f; // Every level aims for this fraction of the triangles of the level above
+	const float MIN_REDUCTION = 0.8f; // A level is dropped (and the chain ends) if it keeps more than this fraction of the triangles above
+	const float MAX_RELATIVE_ERROR = 0.25f; // A level is dropped (and the chain ends) if its error is more than this fraction of the bounding sphere radius
+	const size_t MIN_TRIANGLES = 32; // Models with fewer triangles get no levels
+
+	// Documented in MeshSimplifier.cpp
+	std::vector<MeshLod> Simplify(const MeshData& mesh, const std::vector<size_t>& targetTriangles);
+	void BuildLods(MeshData& mesh);
+}
@@ -0,0 +1,248 @@
+#include "MicroBenchmark.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define close _close
+#define fileno _fileno
+const char* NULL_DEVICE = "NUL";
+#else
+#include <unistd.h>
+const char* NULL_DEVICE = "/dev/null";
+#endif
+
+namespace MicroBenchmark {
+	/*
+	A function to measure
+	*/
+	struct Entry {
+		std::string name; // The name it was added with
+		std::function<void()> func; // The function, called once per iteration
+		std::function<bool()> setup; // Called before the benchmark is measured, it is skipped if this returns false. Empty if there is nothing to set up
+	};
+
+	std::vector<Entry> entries; // Every benchmark in the order they were added
+
+	/*
+	Sends stdout to the null device while it exists, the loaders print a line for every file they read
+	*/
+	class Silence {
+	private:
+		int m_Saved = -1; // The original stdout, -1 if it was not redirected
+	public:
+		Silence(bool enabled) {
+			if (!enabled)
+				return;
+			fflush(stdout);
+			m_Saved = dup(fileno(stdout));
+			if (m_Saved >= 0 && freopen(NULL_DEVICE, "w", stdout) == nullptr) {
+				dup2(m_Saved, fileno(stdout));
+				close(m_Saved);
+				m_Saved = -1;
+			}
+		}
+		~Silence() {
+			if (m_Saved < 0)
+				return;
+			fflush(stdout);
+			dup2(m_Saved, fileno(stdout));
+			close(m_Saved);
+		}
+	};
+
+	/*
+	Adds a function to measure, it is called many times in a row so it should do the same work every call
+	@param name - The name in the results, e.g. "loadOBJ/cybertruck.obj"
+	@param func - The function
+	@param setup - What func needs (files, objects, a context), only called if the benchmark is run. Returns false if it failed
+	*/
+	void Add(const std::string& name, const std::function<void()>& func, const std::function<bool()>& setup) {
+		entries.push_back(Entry{ name, func, setup });
+	}
+
+	/*
+	@returns The names of every added benchmark
+	*/
+	std::vector<std::string> GetNames() {
+		std::vector<std::string> names;
+		for (const Entry& entry : entries)
+			names.push_back(entry.name);
+		return names;
+	}
+
+	/*
+	@returns The time in nanoseconds it takes to call the function a number of times
+	*/
+	static double TimeCalls(const std::function<void()>& func, size_t iterations) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < iterations; i++)
+			func();
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/*
+	Runs every benchmark whose name matches the filter and prints a line per benchmark
+	@param options - How long and how often to measure
+	@returns The results in the order the benchmarks were added
+	*/
+	std::vector<MicroResult> Run(const MicroOptions& options) {
+		std::vector<MicroResult> results;
+		printf("%-40s %12s %12s %12s %8s %10s\n", "benchmark", "min", "median", "mean", "stddev", "calls");
+		for (const Entry& entry : entries) {
+			if (!options.filter.empty() && entry.name.find(options.filter) == std::string::npos)
+				continue;
+
+			bool ready = true;
+			if (entry.setup) {
+				Silence silence(!options.verbose);
+				ready = entry.setup();
+			}
+			if (!ready) {
+				printf("%-40s could not be set up, skipped\n", entry.name.c_str());
+				continue;
+			}
+
+			MicroResult result;
+			result.name = entry.name;
+			std::vector<double> samples;
+			{
+				Silence silence(!options.verbose);
+				// The first call also warms the file cache, then the calls per sample double until a sample is long enough
+				size_t iterations = 1;
+				double minSampleNs = options.min_sample_ms * 1e6;
+				while (TimeCalls(entry.func, iterations) < minSampleNs && iterations < ((size_t)1 << 30))
+					iterations *= 2;
+				for (int i = 0; i < options.warmup; i++)
+					TimeCalls(entry.func, iterations);
+				for (int i = 0; i < std::max(options.samples, 1); i++)
+					samples.push_back(TimeCalls(entry.func, iterations) / iterations);
+				result.iterations = iterations;
+			}
+
+			std::sort(samples.begin(), samples.end());
+			result.samples = (int)samples.size();
+			result.min_ns = samples.front();
+			result.max_ns = samples.back();
+			size_t middle = samples.size() / 2;
+			result.median_ns = samples.size() % 2 == 1 ? samples[middle] : (samples[middle - 1] + samples[middle]) * 0.5;
+			for (double sample : samples)
+				result.mean_ns += sample;
+			result.mean_ns /= samples.size();
+			for (double sample : samples)
+				result.stddev_ns += (sample - result.mean_ns) * (sample - result.mean_ns);
+			result.stddev_ns = sqrt(result.stddev_ns / samples.size());
+
+			printf("%-40s %10.0f ns %10.0f ns %10.0f ns %7.1f%% %10zu\n", result.name.c_str(), result.min_ns, result.median_ns, result.mean_ns,
+				result.mean_ns > 0.0 ? 100.0 * result.stddev_ns / result.mean_ns : 0.0, result.iterations);
+			results.push_back(result);
+		}
+		return results;
+	}
+
+	/*
+	Writes the results, one benchmark per line so ReadJson doesn't need a full JSON parser
+	@param path - The path of the .json file
+	@param results - The results of Run
+	@returns True if the file was written
+	*/
+	bool WriteJson(const std::string& path, const std::vector<MicroResult>& results) {
+		FILE* file = fopen(path.c_str(), "w");
+		if (file == nullptr) {
+			printf("Could not write %s\n", path.c_str());
+			return false;
+		}
+		fprintf(file, "{\n  \"benchmarks\": [\n");
+		for (size_t i = 0; i < results.size(); i++) {
+			const MicroResult& r = results[i];
+			fprintf(file, "    { \"name\": \"%s\", \"iterations\": %zu, \"samples\": %d, \"min_ns\": %.2f, \"median_ns\": %.2f, \"mean_ns\": %.2f, \"stddev_ns\": %.2f, \"max_ns\": %.2f }%s\n",
+				r.name.c_str(), r.iterations, r.samples, r.min_ns, r.median_ns, r.mean_ns, r.stddev_ns, r.max_ns, i + 1 < results.size() ? "," : "");
+		}
+		fprintf(file, "  ]\n}\n");
+		return fclose(file) == 0;
+	}
+
+	/*
+	@returns The number after "key": on the line, 0 if the key is not on it
+	*/
+	static double ReadNumber(const char* line, const char* key) {
+		const char* found = strstr(line, key);
+		return found != nullptr ? atof(found + strlen(key)) : 0.0;
+	}
+
+	/*
+	Reads a file written by WriteJson
+	@param path - The path of the .json file
+	@param results - Filled with the results in the file
+	@returns False if the file could not be opened or has no benchmarks
+	*/
+	bool ReadJson(const std::string& path, std::vector<MicroResult>& results) {
+		FILE* file = fopen(path.c_str(), "r");
+		if (file == nullptr) {
+			printf("Could not read %s\n", path.c_str());
+			return false;
+		}
+		results.clear();
+		char line[1024];
+		while (fgets(line, sizeof(line), file) != nullptr) {
+			const char* name = strstr(line, "\"name\": \"");
+			if (name == nullptr)
+				continue;
+			name += strlen("\"name\": \"");
+			const char* end = strchr(name, '"');
+			if (end == nullptr)
+				continue;
+			MicroResult result;
+			result.name.assign(name, end);
+			result.iterations = (size_t)ReadNumber(line, "\"iterations\":");
+			result.samples = (int)ReadNumber(line, "\"samples\":");
+			result.min_ns = ReadNumber(line, "\"min_ns\":");
+			result.median_ns = ReadNumber(line, "\"median_ns\":");
+			result.mean_ns = ReadNumber(line, "\"mean_ns\":");
+			result.stddev_ns = ReadNumber(line, "\"stddev_ns\":");
+			result.max_ns = ReadNumber(line, "\"max_ns\":");
+			results.push_back(result);
+		}
+		fclose(file);
+		if (results.empty())
+			printf("%s has no benchmarks\n", path.c_str());
+		return !results.empty();
+	}
+
+	/*
+	Prints the change of the median of every benchmark that is in both runs
+	@param baseline - The results to compare against
+	@param results - The results of this run
+	@param thresholdPercent - How much slower than the baseline a benchmark may be before it is a regression
+	@returns The amount of regressions
+	*/
+	int Compare(const std::vector<MicroResult>& baseline, const std::vector<MicroResult>& results, double thresholdPercent) {
+		int regressions = 0;
+		printf("%-40s %12s %12s %9s\n", "benchmark", "baseline", "now", "change");
+		for (const MicroResult& result : results) {
+			std::vector<MicroResult>::const_iterator before = std::find_if(baseline.begin(), baseline.end(),
+				[&result](const MicroResult& other) { return other.name == result.name; });
+			if (before == baseline.end() || before->median_ns <= 0.0) {
+				printf("%-40s %12s %10.0f ns %9s\n", result.name.c_str(), "-", result.median_ns, "new");
+				continue;
+			}
+			double change = 100.0 * (result.median_ns - before->median_ns) / before->median_ns;
+			bool regressed = change > thresholdPercent;
+			if (regressed)
+				regressions++;
+			printf("%-40s %10.0f ns %10.0f ns %+8.1f%%%s\n", result.name.c_str(), before->median_ns, result.median_ns, change, regressed ? "  REGRESSION" : "");
+		}
+		if (regressions > 0)
+			printf("%d of %zu benchmarks are more than %.1f%% slower than the baseline\n", regressions, results.size(), thresholdPercent);
+		else
+			printf("No benchmark is more than %.1f%% slower than the baseline\n", thresholdPercent);
+		return regressions;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+The timings of one microbenchmark, in nanoseconds per call of its function
+*/
+struct MicroResult {
+	std::string name; // The name the benchmark was added with, e.g. "loadOBJ/cybertruck.obj"
+	size_t iterations = 0; // The amount of calls per sample
+	int samples = 0; // The amount of samples
+	double min_ns = 0.0; // The fastest sample
+	double median_ns = 0.0; // The median sample, what the comparison with a baseline uses
+	double mean_ns = 0.0; // The average sample
+	double stddev_ns = 0.0; // The standard deviation of the samples
+	double max_ns = 0.0; // The slowest sample
+};
+
+/*
+How the microbenchmarks are run and which ones
+*/
+struct MicroOptions {
+	int warmup = 2; // The amount of samples run and thrown away before measuring, after the amount of calls per sample is picked
+	int samples = 15; // The amount of samples measured
+	double min_sample_ms = 20.0; // A sample calls the function this long at least, the amount of calls is doubled until it does
+	std::string filter; // Only the benchmarks whose name contains this are run, all when empty
+	bool verbose = false; // If the output of the functions is shown, it is thrown away by default so the table stays readable
+};
+
+/*
+A small microbenchmark harness: functions are added with a name and an optional setup that only runs when the benchmark does, every function is called in samples of a fixed
+amount of calls (picked so a sample takes MicroOptions::min_sample_ms), and the spread of the samples is reported.
+The results can be written to a JSON file and later runs compared against it, a benchmark whose median is slower than the
+baseline by more than the threshold is a regression
+*/
+namespace MicroBenchmark {
+	// Documented in MicroBenchmark.cpp
+	void Add(const std::string& name, const std::function<void()>& func, const std::function<bool()>& setup = std::function<bool()>());
+	std::vector<std::string> GetNames();
+	std::vector<MicroResult> Run(const MicroOptions& options);
+	bool WriteJson(const std::string& path, const std::vector<MicroResult>& results);
+	bool ReadJson(const std::string& path, std::vector<MicroResult>& results);
+	int Compare(const std::vector<MicroResult>& baseline, const std::vector<MicroResult>& results, double thresholdPercent);
+}
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "MicroBenchmark.h"
+#include "objloader.h"
+#include "texture.h"
+#include "glsl.h"
+#include "Animation.h"
+#include "ObjectFactory.h"
+#include "ObjectStore.h"
+#include "JobSystem.h"
+#include "TextureCache.h"
+#include "TextureArrays.h"
+#ifdef CG_BENCH
+#include "Benchmark.h"
+#endif
+
+//--------------------------------------------------------------------------------
+// Consts
+//--------------------------------------------------------------------------------
+
+const char* MODELS[] = { "Objects/box.obj", "Objects/streetlantern.obj", "Objects/cybertruck.obj" }; // A tiny, a typical and the largest model of the scene
+const char* TEXTURE = "Textures/wood.bmp"; // A 512x512 texture like most of the scene
+const char* DDS_TEXTURE = "Textures/uvmap.DDS"; // The one DDS file that is not a texture cache
+const char* SHADER = "vertexshader.vert";
+const int TRANSFORM_OBJECTS = 4096; // The amount of objects the view * model benchmarks transform, enough for ObjectStore to split them over the JobSystem
+
+//--------------------------------------------------------------------------------
+// Variables
+//--------------------------------------------------------------------------------
+
+volatile size_t sink = 0; // Everything a benchmark makes is added to this, so the compiler can't leave the work out
+std::vector<SceneObject*> objects; // The objects of the transform benchmarks
+std::vector<Animation*> animations; // The animations of the Animation::Evaluate benchmarks, made when they first run
+#ifdef CG_BENCH
+int context = -1; // If the offscreen context was made, -1 until a benchmark that needs it runs
+#endif
+
+/*
+@returns The file name of a path, the name the benchmark of that file gets
+*/
+std::string FileName(const char* path) {
+	const char* slash = strrchr(path, '/');
+	return slash != nullptr ? slash + 1 : path;
+}
+
+/*
+Adds the benchmarks of the loaders that don't need OpenGL: the .obj parser, the .bmp reader (what loadBMP does before it uploads),
+the DDS texture cache reader and the shader source reader
+*/
+void AddLoaderBenchmarks() {
+	for (const char* model : MODELS) {
+		MicroBenchmark::Add("loadOBJ/" + FileName(model), [model]() {
+			std::vector<glm::vec3> vertices, normals;
+			std::vector<glm::vec2> uvs;
+			std::vector<unsigned int> indices;
+			loadOBJ(model, vertices, uvs, normals, indices);
+			sink = sink + indices.size();
+		});
+	}
+	MicroBenchmark::Add("readBMP/" + FileName(TEXTURE), []() {
+		unsigned int width, height;
+		std::vector<unsigned char> data;
+		readBMP(TEXTURE, width, height, data);
+		sink = sink + data.size();
+	});
+
+	MicroBenchmark::Add("TextureCache::Load/" + FileName(TEXTURE), []() {
+		CompressedTexture texture;
+		TextureCache::Load(TEXTURE, TextureArrays::LAYER_SIZE, texture);
+		sink = sink + texture.data.size();
+	}, []() {
+		// The cache is made the way the AssetLoader makes it, so it is only written if the program didn't do that yet
+		CompressedTexture compressed;
+		return TextureCache::Load(TEXTURE, TextureArrays::LAYER_SIZE, compressed) || TextureCache::Compress(TEXTURE, TextureArrays::LAYER_SIZE, compressed);
+	});
+
+	MicroBenchmark::Add("glsl::readFile/" + FileName(SHADER), []() {
+		char* source = glsl::readFile(SHADER);
+		sink = sink + (source != nullptr ? strlen(source) : 0);
+		delete[] source;
+	});
+}
+
+#ifdef CG_BENCH
+/*
+Makes the offscreen context the first time a benchmark needs it
+@returns True if there is a context
+*/
+bool MakeContext() {
+	if (context < 0)
+		context = Benchmark::CreateContext(1, 1) ? 1 : 0;
+	return context == 1;
+}
+
+/*
+Adds the benchmarks of the loaders that upload to OpenGL, loadBMP also builds the mip chain on the CPU
+*/
+void AddTextureUploadBenchmarks() {
+	MicroBenchmark::Add("loadBMP/" + FileName(TEXTURE), []() {
+		GLuint texture = loadBMP(TEXTURE);
+		glDeleteTextures(1, &texture);
+		sink = sink + texture;
+	}, MakeContext);
+	MicroBenchmark::Add("loadDDS/" + FileName(DDS_TEXTURE), []() {
+		GLuint texture = loadDDS(DDS_TEXTURE);
+		glDeleteTextures(1, &texture);
+		sink = sink + texture;
+	}, MakeContext);
+}
+#endif
+
+/*
+Makes the objects of the transform benchmarks the first time one of them runs
+@returns True
+*/
+bool MakeObjects() {
+	for (int i = (int)objects.size(); i < TRANSFORM_OBJECTS; i++) {
+		ObjectFactory factory;
+		objects.push_back(factory.New()
+			->WithName("Benchmark")
+			->WithPosition(glm::vec3(i % 40, 0, i / 40))
+			->WithRotation(glm::radians((float)(i * 7 % 360)), glm::vec3(0, 1, 0))
+			->Build());
+	}
+	return true;
+}
+
+/*
+@returns The animation of the car in main.cpp, a loop of moves and turns
+*/
+Animation* MakeCarAnimation(AnimationInterpolation interpolation) {
+	Animation* animation = new Animation(AnimationRepeat::REPEAT);
+	animation->AddStage(AnimationStage(AnimationType::MOVETO, glm::vec3(0, 0.5f, 17), 150));
+	animation->AddStage(AnimationStage(AnimationType::ROTATE, glm::vec3(0, 1, 0), 90, glm::radians(-1.0f)));
+	animation->AddStage(AnimationStage(AnimationType::MOVETO, glm::vec3(-30, 0.5f, 17), 100));
+	animation->AddStage(AnimationStage(AnimationType::ROTATE, glm::vec3(0, 1, 0), 90, glm::radians(-1.0f)));
+	animation->AddStage(AnimationStage(AnimationType::MOVETO, glm::vec3(-30, 0.5f, -27), 150));
+	animation->AddStage(AnimationStage(AnimationType::ROTATE, glm::vec3(0, 1, 0), 90, glm::radians(-1.0f)));
+	animation->AddStage(AnimationStage(AnimationType::MOVETO, glm::vec3(0, 0.5f, -27), 150));
+	animation->AddStage(AnimationStage(AnimationType::ROTATE, glm::vec3(0, 1, 0), 90, glm::radians(-1.0f)));
+	animation->SetInterpolation(interpolation);
+	animation->Compile(glm::mat4(1.0f), glm::vec3(0, 0.5f, 10), glm::vec3(0.0f), 0.0);
+	return animation;
+}
+
+/*
+Adds the benchmarks of the animations and the transforms: Animation::Evaluate (what the objects are animated with every frame),
+the SceneObject transform methods and the view * model multiply of every object
+*/
+void AddTransformBenchmarks() {
+	const char* interpolations[] = { "linear", "catmull-rom" };
+	animations.assign(2, nullptr);
+	for (int i = 0; i < 2; i++) {
+		// Every benchmark has its own time, so it doesn't matter which one runs first
+		double time = 0;
+		MicroBenchmark::Add(std::string("Animation::Evaluate/") + interpolations[i], [i, time]() mutable {
+			// Every call is a later time, so every stage and the wrap around of the loop are in the measurement
+			time += 0.0167;
+			glm::mat4 model(1.0f);
+			glm::vec3 position, rotation;
+			animations[i]->Evaluate(time, model, position, rotation);
+			sink = sink + (size_t)position.x;
+		}, [i]() {
+			if (animations[i] == nullptr)
+				animations[i] = MakeCarAnimation((AnimationInterpolation)i);
+			return true;
+		});
+	}
+
+	MicroBenchmark::Add("SceneObject::Translate", []() {
+		objects[0]->Translate(glm::vec3(0.01f, 0.0f, -0.01f));
+	}, MakeObjects);
+	MicroBenchmark::Add("SceneObject::Rotate", []() {
+		objects[0]->Rotate(glm::radians(1.0f), glm::vec3(0, 1, 0));
+	}, MakeObjects);
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.75f, 3.0f), glm::vec3(0.0f, 1.75f, 2.0f), glm::vec3(0, 1, 0));
+	MicroBenchmark::Add("view*model/" + std::to_string(TRANSFORM_OBJECTS), [view]() {
+		// Every product is written out like UpdateTransforms does, so no multiply can be left out
+		static std::vector<glm::mat4> modelViews;
+		const glm::mat4* models = ObjectStore::Models();
+		modelViews.resize(ObjectStore::Count());
+		for (uint32_t i = 0; i < ObjectStore::Count(); i++)
+			modelViews[i] = view * models[i];
+		sink = sink + (size_t)modelViews[0][3][2] + (size_t)modelViews.back()[3][2];
+	}, MakeObjects);
+	MicroBenchmark::Add("ObjectStore::UpdateTransforms/" + std::to_string(TRANSFORM_OBJECTS), [view]() {
+		ObjectStore::UpdateTransforms(view);
+		sink = sink + (size_t)ObjectStore::ModelViews()[0][3][2];
+	}, MakeObjects);
+}
+
+/*
+Runs the microbenchmarks from the folder of the assets (like the program) and compares them with a baseline.
+Options: --filter text, --samples N, --warmup N, --min-time ms, --out file.json (writes the results),
+--baseline file.json (compares with an earlier --out), --threshold percent (10 by default), --list and --verbose
+@returns 1 if a benchmark regressed or a file could not be read or written, 0 otherwise
+*/
+int main(int argc, char** argv) {
+	MicroOptions options;
+	std::string out, baseline;
+	double threshold = 10.0;
+	bool list = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+			options.filter = argv[++i];
+		else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+			options.samples = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+			options.warmup = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+			options.min_sample_ms = atof(argv[++i]);
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			out = argv[++i];
+		else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+			baseline = argv[++i];
+		else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+			threshold = atof(argv[++i]);
+		else if (strcmp(argv[i], "--list") == 0)
+			list = true;
+		else if (strcmp(argv[i], "--verbose") == 0)
+			options.verbose = true;
+		else {
+			printf("Unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	// Read the baseline first, so a wrong path doesn't waste a whole run
+	std::vector<MicroResult> before;
+	if (!baseline.empty() && !MicroBenchmark::ReadJson(baseline, before))
+		return 1;
+
+	JobSystem::Start();
+	AddLoaderBenchmarks();
+#ifdef CG_BENCH
+	AddTextureUploadBenchmarks();
+#else
+	printf("Built without an offscreen context, loadBMP and loadDDS are not measured\n");
+#endif
+	AddTransformBenchmarks();
+
+	int exitCode = 0;
+	if (list) {
+		for (const std::string& name : MicroBenchmark::GetNames())
+			printf("%s\n", name.c_str());
+	}
+	else {
+		std::vector<MicroResult> results = MicroBenchmark::Run(options);
+		if (!out.empty() && !MicroBenchmark::WriteJson(out, results))
+			exitCode = 1;
+		if (!before.empty() && MicroBenchmark::Compare(before, results, threshold) > 0)
+			exitCode = 1;
+	}
+
+	for (SceneObject* object : objects)
+		delete object;
+	objects.clear();
+	for (Animation* animation : animations)
+		delete animation;
+	animations.clear();
+#ifdef CG_BENCH
+	if (context == 1)
+		Benchmark::DestroyContext();
+#endif
+	JobSystem::Stop();
+	return exitCode;
+}
@@ -49,6 +49,15 @@ ObjectFactory* ObjectFactory::WithShader(Shader shader) {
 	return this;
 }
 
+/*
+Sets the vertex buffer layout of the scene object
+@param format - VertexFormat::COMPACT (default) for the smallest vertices, VertexFormat::FLOAT for exact positions, normals and uvs
+*/
+ObjectFactory* ObjectFactory::WithVertexFormat(VertexFormat format) {
+	object->SetVertexFormat(format);
+	return this;
+}
+
 /*
 Sets the position of the scene object
 @param position - The position where to place the object
@@ -13,6 +13,7 @@ public:
 	ObjectFactory* FromObjectModel(const char* objFilePath);
 	ObjectFactory* WithTexture(const char* bmpFilePath);
 	ObjectFactory* WithShader(Shader shader);
+	ObjectFactory* WithVertexFormat(VertexFormat format);
 	ObjectFactory* WithPosition(const glm::vec3& position);
 	ObjectFactory* WithRotation(const float angle, const glm::vec3& axis);
 	ObjectFactory* WithScale(const glm::vec3& scale);
@@ -0,0 +1,281 @@
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OBJECT_STORE_SSE
+#endif
+
+#include "ObjectStore.h"
+#include "Animation.h"
+#include "SceneObject.h"
+#include "Mesh.h"
+#include "JobSystem.h"
+
+namespace ObjectStore {
+	std::vector<uint32_t> indices; // The index of every id, INVALID for ids that are free
+	std::vector<uint32_t> ids; // The id of every index
+	std::vector<uint32_t> freeIds; // Ids that can be handed out again
+
+	// The components, all indexed the same way
+	std::vector<glm::mat4> models; // The model matrices
+	std::vector<glm::mat4> modelViews; // The view * model matrices as of the last UpdateTransforms
+	std::vector<glm::vec3> positions; // The absolute positions
+	std::vector<glm::vec3> rotations; // The absolute rotations in degrees
+	std::vector<Animation*> animations; // The animations, nullptr when the object is not animated
+	std::vector<const MeshData*> bounds; // The meshes, for their bounds; nullptr until the model is loaded
+	std::vector<glm::vec3> worldCenters; // The world space centers of the bounds as of the last UpdateTransforms
+	std::vector<glm::vec3> worldExtents; // The world space half sizes of the bounding boxes as of the last UpdateTransforms
+	std::vector<float> worldRadii; // The world space radii of the bounding spheres as of the last UpdateTransforms
+	std::vector<SceneObject*> owners; // The façades, told when their animation moved them
+	double lastAnimateTime = 0; // The time of the last Animate, newly set animations start there
+	std::vector<std::vector<uint32_t>> movedChunks; // The indices Animate moved, per chunk
+	std::vector<std::vector<uint32_t>> finishedChunks; // The indices whose animation Animate found finished, per chunk
+
+	/*
+	Makes an entry with an identity transform
+	@param owner - The scene object the entry belongs to
+	@returns The id of the entry
+	*/
+	uint32_t Create(SceneObject* owner) {
+		uint32_t id;
+		if (!freeIds.empty()) {
+			id = freeIds.back();
+			freeIds.pop_back();
+		} else {
+			id = (uint32_t)indices.size();
+			indices.push_back(INVALID);
+		}
+		indices[id] = (uint32_t)ids.size();
+		ids.push_back(id);
+		models.push_back(glm::mat4(1.0f));
+		modelViews.push_back(glm::mat4(1.0f));
+		positions.push_back(glm::vec3(0.0f));
+		rotations.push_back(glm::vec3(0.0f));
+		animations.push_back(nullptr);
+		bounds.push_back(nullptr);
+		worldCenters.push_back(glm::vec3(0.0f));
+		worldExtents.push_back(glm::vec3(0.0f));
+		worldRadii.push_back(0.0f);
+		owners.push_back(owner);
+		return id;
+	}
+
+	/*
+	Moves the entry at the back of a component array into the hole left by a removed entry
+	*/
+	template <typename T>
+	static void RemoveAt(std::vector<T>& component, uint32_t index) {
+		component[index] = component.back();
+		component.pop_back();
+	}
+
+	/*
+	Removes an entry, the animation is not deleted (the owner does that)
+	@param id - The id of the entry
+	*/
+	void Destroy(uint32_t id) {
+		uint32_t index = IndexOf(id);
+		if (index == INVALID)
+			return;
+		indices[ids.back()] = index;
+		RemoveAt(ids, index);
+		RemoveAt(models, index);
+		RemoveAt(modelViews, index);
+		RemoveAt(positions, index);
+		RemoveAt(rotations, index);
+		RemoveAt(animations, index);
+		RemoveAt(bounds, index);
+		RemoveAt(worldCenters, index);
+		RemoveAt(worldExtents, index);
+		RemoveAt(worldRadii, index);
+		RemoveAt(owners, index);
+		indices[id] = INVALID;
+		freeIds.push_back(id);
+	}
+
+	/*
+	@returns The amount of entries, the length of every component array
+	*/
+	uint32_t Count() {
+		return (uint32_t)ids.size();
+	}
+
+	/*
+	@param id - The id of an entry
+	@returns The index of the entry in the component arrays, INVALID if the id is not in use
+	*/
+	uint32_t IndexOf(uint32_t id) {
+		return id < indices.size() ? indices[id] : INVALID;
+	}
+
+	/*
+	@returns The model matrices
+	*/
+	glm::mat4* Models() {
+		return models.data();
+	}
+
+	/*
+	@returns The view * model matrices as of the last UpdateTransforms
+	*/
+	const glm::mat4* ModelViews() {
+		return modelViews.data();
+	}
+
+	/*
+	@returns The absolute positions
+	*/
+	glm::vec3* Positions() {
+		return positions.data();
+	}
+
+	/*
+	@returns The absolute rotations in degrees
+	*/
+	glm::vec3* Rotations() {
+		return rotations.data();
+	}
+
+	/*
+	@returns The animations, nullptr for objects without one
+	*/
+	Animation** Animations() {
+		return animations.data();
+	}
+
+	/*
+	@returns The meshes of the objects, for their bounds
+	*/
+	const MeshData** Bounds() {
+		return bounds.data();
+	}
+
+	/*
+	@returns The scene objects the entries belong to
+	*/
+	SceneObject** Owners() {
+		return owners.data();
+	}
+
+	/*
+	@returns The world space centers of the bounds as of the last UpdateTransforms
+	*/
+	const glm::vec3* WorldCenters() {
+		return worldCenters.data();
+	}
+
+	/*
+	@returns The world space half sizes of the bounding boxes as of the last UpdateTransforms
+	*/
+	const glm::vec3* WorldExtents() {
+		return worldExtents.data();
+	}
+
+	/*
+	@returns The world space radii of the bounding spheres as of the last UpdateTransforms
+	*/
+	const float* WorldRadii() {
+		return worldRadii.data();
+	}
+
+	/*
+	Calculates view * model for a range of entries
+	*/
+	static void UpdateModelViews(const glm::mat4& view, size_t begin, size_t end) {
+#ifdef OBJECT_STORE_SSE
+		// Column j of view * model is the view columns weighted by the elements of model column j
+		const float* v = &view[0][0];
+		__m128 v0 = _mm_loadu_ps(v), v1 = _mm_loadu_ps(v + 4), v2 = _mm_loadu_ps(v + 8), v3 = _mm_loadu_ps(v + 12);
+		for (size_t i = begin; i < end; i++) {
+			const float* m = &models[i][0][0];
+			float* out = &modelViews[i][0][0];
+			for (int column = 0; column < 16; column += 4) {
+				__m128 result = _mm_mul_ps(v0, _mm_set1_ps(m[column]));
+				result = _mm_add_ps(result, _mm_mul_ps(v1, _mm_set1_ps(m[column + 1])));
+				result = _mm_add_ps(result, _mm_mul_ps(v2, _mm_set1_ps(m[column + 2])));
+				result = _mm_add_ps(result, _mm_mul_ps(v3, _mm_set1_ps(m[column + 3])));
+				_mm_storeu_ps(out + column, result);
+			}
+		}
+#else
+		for (size_t i = begin; i < end; i++)
+			modelViews[i] = view * models[i];
+#endif
+	}
+
+	/*
+	Transforms the bounds of a range of entries to world space, entries without a model get a point at their origin
+	*/
+	static void UpdateWorldBounds(size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			if (bounds[i] != nullptr) {
+				bounds[i]->TransformBounds(models[i], worldCenters[i], worldExtents[i], worldRadii[i]);
+			} else {
+				worldCenters[i] = glm::vec3(models[i][3]);
+				worldExtents[i] = glm::vec3(0.0f);
+				worldRadii[i] = 0.0f;
+			}
+		}
+	}
+
+	/*
+	Calculates view * model and the world space bounds of every entry, in chunks across the JobSystem threads.
+	Must be called after the models changed and before anything reads the model views or world bounds
+	@param view - The view matrix
+	*/
+	void UpdateTransforms(const glm::mat4& view) {
+		JobSystem::ParallelFor(models.size(), GRAIN, [&view](size_t begin, size_t end) {
+			UpdateModelViews(view, begin, end);
+			UpdateWorldBounds(begin, end);
+		});
+	}
+
+	/*
+	Evaluates every animation at the given time and writes the results into the transforms, in chunks across the JobSystem threads.
+	Animations that were set since the last call start from the current transform of their object at the time of the last call, so their first step shows up right away
+	@param time - The animation time in seconds, never goes back
+	*/
+	void Animate(double time) {
+		size_t count = animations.size();
+		size_t chunkCount = (count + GRAIN - 1) / GRAIN;
+		if (movedChunks.size() < chunkCount) {
+			movedChunks.resize(chunkCount);
+			finishedChunks.resize(chunkCount);
+		}
+
+		// The animations only write their own entries, everything shared is collected per chunk
+		double startTime = lastAnimateTime;
+		JobSystem::ParallelFor(count, GRAIN, [time, startTime](size_t begin, size_t end) {
+			std::vector<uint32_t>& moved = movedChunks[begin / GRAIN];
+			std::vector<uint32_t>& finished = finishedChunks[begin / GRAIN];
+			moved.clear();
+			finished.clear();
+			for (size_t i = begin; i < end; i++) {
+				Animation* animation = animations[i];
+				if (animation == nullptr)
+					continue;
+				if (!animation->IsCompiled())
+					animation->Compile(models[i], positions[i], rotations[i], startTime);
+				animation->Evaluate(time, models[i], positions[i], rotations[i]);
+				moved.push_back((uint32_t)i);
+				if (animation->IsFinished(time))
+					finished.push_back((uint32_t)i);
+			}
+		});
+
+		// Merged in chunk order on the calling thread, so the registry sees the same order whatever thread ran what
+		for (size_t c = 0; c < chunkCount; c++) {
+			const std::vector<uint32_t>& moved = movedChunks[c];
+			for (size_t m = 0; m < moved.size(); m++) {
+				if (owners[moved[m]] != nullptr)
+					owners[moved[m]]->OnMoved();
+			}
+			const std::vector<uint32_t>& finished = finishedChunks[c];
+			for (size_t f = 0; f < finished.size(); f++) {
+				delete animations[finished[f]];
+				animations[finished[f]] = nullptr;
+			}
+		}
+		lastAnimateTime = time;
+	}
+}
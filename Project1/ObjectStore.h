@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+/*
+Forward declarations to counter-act circular dependency
+*/
+class SceneObject;
+class Animation;
+struct MeshData;
+
+/*
+Structure of arrays with the per-object data that is touched every frame: transforms, animation state and the bounds used for culling.
+SceneObject is a façade over one entry; per-frame loops walk these arrays directly instead of going through every object.
+Entries are packed: removing one moves the last entry in its place, so objects are addressed by a stable id that IndexOf turns into the current index.
+Pointers returned by the array getters are invalidated by Create.
+The per-frame passes are split into chunks of GRAIN entries that run on the JobSystem
+*/
+namespace ObjectStore {
+	const uint32_t INVALID = UINT32_MAX; // The index of an id that is not in use
+	const size_t GRAIN = 1024; // The amount of entries per chunk of a per-frame pass
+
+	// Documented in ObjectStore.cpp
+	uint32_t Create(SceneObject* owner);
+	void Destroy(uint32_t id);
+	uint32_t Count();
+	uint32_t IndexOf(uint32_t id);
+	glm::mat4* Models();
+	const glm::mat4* ModelViews();
+	glm::vec3* Positions();
+	glm::vec3* Rotations();
+	Animation** Animations();
+	const MeshData** Bounds();
+	SceneObject** Owners();
+	const glm::vec3* WorldCenters();
+	const glm::vec3* WorldExtents();
+	const float* WorldRadii();
+	void UpdateTransforms(const glm::mat4& view);
+	void Animate(double time);
+}
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "Profiler.h"
+
+namespace Profiler {
+	/*
+	The two timestamp queries of one run of a scope
+	*/
+	struct Timestamps {
+		int scope; // The index of the scope
+		GLuint begin, end; // The queries at the start and the end of the scope
+	};
+
+	/*
+	The GPU queries of one frame, reused FRAME_LAG frames later
+	*/
+	struct QueryFrame {
+		size_t frame = 0; // The frame the queries were made in
+		bool used = false; // If the queries belong to a frame whose results were not read yet
+		std::vector<GLuint> pool; // The query names, only grows
+		size_t next = 0; // The first query of the pool that is not used in this frame
+		std::vector<Timestamps> runs; // The scopes that ran in this frame
+		GLuint last = 0; // The query that was written last, when it is done all of them are
+	};
+
+	/*
+	A scope that was started but not ended yet
+	*/
+	struct OpenScope {
+		int scope; // The index of the scope
+		std::chrono::steady_clock::time_point start; // When it started on the CPU
+		GLuint end; // The query for its end, 0 without timer queries
+	};
+
+	std::vector<ProfilerScope> scopes; // Every scope seen so far, in the order they first ran
+	std::vector<float> frameTimes(HISTORY, 0.0f); // The CPU time of every frame, from BeginFrame to EndFrame
+	std::vector<float> gpuFrameTimes(HISTORY, -1.0f); // The GPU time of every frame, the sum of its top level scopes
+	QueryFrame queryFrames[FRAME_LAG]; // The queries of the last FRAME_LAG frames
+	std::vector<OpenScope> open; // The scopes that are running, innermost last
+	size_t frameCount = 0; // The amount of frames that ended, also the number of the frame being recorded
+	bool inFrame = false; // If BeginFrame was called and EndFrame not yet
+	int timerQueries = -1; // If GL_ARB_timer_query is supported, -1 until the first frame because it needs a context
+	std::chrono::steady_clock::time_point frameStart; // When the frame being recorded started
+	size_t dropped = 0; // The amount of frames whose GPU times were not done FRAME_LAG frames later
+
+	/*
+	Reads the GPU times of an earlier frame into the histories, drops them if the GPU is still not done
+	@param queries - The queries of the frame
+	*/
+	static void Resolve(QueryFrame& queries) {
+		if (!queries.used || queries.last == 0)
+			return;
+		queries.used = false;
+		GLint available = 0;
+		glGetQueryObjectiv(queries.last, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			if (dropped++ == 0)
+				printf("The GPU is more than %zu frames behind, the profiler drops GPU times\n", FRAME_LAG);
+			return;
+		}
+
+		size_t slot = queries.frame % HISTORY;
+		for (const Timestamps& run : queries.runs) {
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(run.begin, GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(run.end, GL_QUERY_RESULT, &end);
+			float ms = (float)((end - begin) / 1e6);
+			ProfilerScope& scope = scopes[run.scope];
+			scope.gpu_ms[slot] = std::max(scope.gpu_ms[slot], 0.0f) + ms;
+			if (scope.parent < 0)
+				gpuFrameTimes[slot] = std::max(gpuFrameTimes[slot], 0.0f) + ms;
+		}
+	}
+
+	/*
+	@returns An unused query of the frame being recorded, more are made when the pool runs out
+	*/
+	static GLuint TakeQuery() {
+		QueryFrame& queries = queryFrames[frameCount % FRAME_LAG];
+		if (queries.next == queries.pool.size()) {
+			size_t grow = std::max(queries.pool.size(), (size_t)16);
+			queries.pool.resize(queries.pool.size() + grow);
+			glGenQueries((GLsizei)grow, &queries.pool[queries.next]);
+		}
+		return queries.pool[queries.next++];
+	}
+
+	/*
+	Starts recording a frame, reads the GPU times of the frame FRAME_LAG frames ago
+	*/
+	void BeginFrame() {
+		if (timerQueries < 0)
+			timerQueries = glewIsSupported("GL_ARB_timer_query") ? 1 : 0;
+		if (inFrame)
+			EndFrame();
+
+		size_t slot = frameCount % HISTORY;
+		for (ProfilerScope& scope : scopes) {
+			scope.cpu_ms[slot] = 0.0f;
+			scope.gpu_ms[slot] = -1.0f;
+		}
+		frameTimes[slot] = 0.0f;
+		gpuFrameTimes[slot] = -1.0f;
+
+		QueryFrame& queries = queryFrames[frameCount % FRAME_LAG];
+		Resolve(queries);
+		queries.frame = frameCount;
+		queries.used = timerQueries == 1;
+		queries.next = 0;
+		queries.runs.clear();
+		queries.last = 0;
+
+		open.clear();
+		inFrame = true;
+		frameStart = std::chrono::steady_clock::now();
+	}
+
+	/*
+	Ends the frame, scopes that are still open are ended first
+	*/
+	void EndFrame() {
+		if (!inFrame)
+			return;
+		while (!open.empty())
+			End();
+		frameTimes[frameCount % HISTORY] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+		inFrame = false;
+		frameCount++;
+	}
+
+	/*
+	Starts a scope inside the innermost open scope, must be followed by End. Does nothing outside a frame
+	@param name - The name of the scope, a string that lives as long as the profiler (a literal)
+	*/
+	void Begin(const char* name) {
+		if (!inFrame)
+			return;
+		int parent = open.empty() ? -1 : open.back().scope;
+		int index = -1;
+		for (size_t i = 0; i < scopes.size() && index < 0; i++) {
+			if (scopes[i].parent == parent && strcmp(scopes[i].name, name) == 0)
+				index = (int)i;
+		}
+		if (index < 0) {
+			ProfilerScope scope;
+			scope.name = name;
+			scope.parent = parent;
+			scope.depth = (int)open.size();
+			scope.cpu_ms.assign(HISTORY, 0.0f);
+			scope.gpu_ms.assign(HISTORY, -1.0f);
+			scopes.push_back(scope);
+			index = (int)scopes.size() - 1;
+		}
+
+		OpenScope scope = { index, std::chrono::steady_clock::now(), 0 };
+		if (timerQueries == 1) {
+			GLuint begin = TakeQuery();
+			scope.end = TakeQuery();
+			glQueryCounter(begin, GL_TIMESTAMP);
+			QueryFrame& queries = queryFrames[frameCount % FRAME_LAG];
+			queries.runs.push_back(Timestamps{ index, begin, scope.end });
+			queries.last = begin;
+		}
+		open.push_back(scope);
+	}
+
+	/*
+	Ends the innermost open scope, its time is added to the times of the scope in this frame so a scope can run more than once
+	*/
+	void End() {
+		if (!inFrame || open.empty())
+			return;
+		OpenScope scope = open.back();
+		open.pop_back();
+		if (scope.end != 0) {
+			glQueryCounter(scope.end, GL_TIMESTAMP);
+			queryFrames[frameCount % FRAME_LAG].last = scope.end;
+		}
+		scopes[scope.scope].cpu_ms[frameCount % HISTORY] += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - scope.start).count();
+	}
+
+	/*
+	Deletes the queries and forgets every scope, must be called while the context still exists
+	*/
+	void Clear() {
+		for (QueryFrame& queries : queryFrames) {
+			if (!queries.pool.empty())
+				glDeleteQueries((GLsizei)queries.pool.size(), queries.pool.data());
+			queries = QueryFrame();
+		}
+		scopes.clear();
+		open.clear();
+		std::fill(frameTimes.begin(), frameTimes.end(), 0.0f);
+		std::fill(gpuFrameTimes.begin(), gpuFrameTimes.end(), -1.0f);
+		frameCount = 0;
+		inFrame = false;
+		timerQueries = -1;
+	}
+
+	/*
+	@returns The amount of frames that ended, the last one is in the histories at (GetFrameCount() - 1) % HISTORY
+	*/
+	size_t GetFrameCount() {
+		return frameCount;
+	}
+
+	/*
+	@returns Every scope seen so far, a parent always comes before its children
+	*/
+	const std::vector<ProfilerScope>& GetScopes() {
+		return scopes;
+	}
+
+	/*
+	@returns The CPU time of the last HISTORY frames
+	*/
+	const std::vector<float>& GetFrameTimes() {
+		return frameTimes;
+	}
+
+	/*
+	@returns The GPU time of the last HISTORY frames, -1 for the frames that were not read yet or were dropped
+	*/
+	const std::vector<float>& GetGpuFrameTimes() {
+		return gpuFrameTimes;
+	}
+
+	/*
+	Calls a function with every value of a history that belongs to a frame that ended and was measured (not negative)
+	*/
+	template <typename F>
+	static void ForEachMeasured(const std::vector<float>& history, F func) {
+		size_t count = std::min(frameCount, HISTORY);
+		for (size_t i = 1; i <= count; i++) {
+			float value = history[(frameCount - i) % HISTORY];
+			if (value >= 0.0f)
+				func(value);
+		}
+	}
+
+	/*
+	@param history - A history of a scope or of the frames
+	@returns The average of the ended frames, 0 if there are none
+	*/
+	float GetAverage(const std::vector<float>& history) {
+		float total = 0.0f;
+		int count = 0;
+		ForEachMeasured(history, [&total, &count](float value) {
+			total += value;
+			count++;
+		});
+		return count > 0 ? total / count : 0.0f;
+	}
+
+	/*
+	@param history - A history of a scope or of the frames
+	@returns The largest value of the ended frames, 0 if there are none
+	*/
+	float GetMaximum(const std::vector<float>& history) {
+		float maximum = 0.0f;
+		ForEachMeasured(history, [&maximum](float value) {
+			maximum = std::max(maximum, value);
+		});
+		return maximum;
+	}
+
+	/*
+	Counts how many of the ended frames fall into each of HISTOGRAM_BUCKETS equal ranges from 0 to a maximum
+	@param history - A history of a scope or of the frames
+	@param maxMs - The end of the last range, larger values are counted in the last range
+	@returns The count of every range
+	*/
+	std::vector<int> GetHistogram(const std::vector<float>& history, float maxMs) {
+		std::vector<int> counts(HISTOGRAM_BUCKETS, 0);
+		ForEachMeasured(history, [&counts, maxMs](float value) {
+			int bucket = maxMs > 0.0f ? (int)(value / maxMs * HISTOGRAM_BUCKETS) : 0;
+			counts[std::min(std::max(bucket, 0), HISTOGRAM_BUCKETS - 1)]++;
+		});
+		return counts;
+	}
+}
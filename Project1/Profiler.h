@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+
+/*
+The times of one profiler scope over the last Profiler::HISTORY frames.
+The histories are rings indexed by frame % Profiler::HISTORY
+*/
+struct ProfilerScope {
+	const char* name = nullptr; // The name it was started with, scopes with the same name in different parents are different scopes
+	int parent = -1; // The index of the scope it runs in, -1 at the top level
+	int depth = 0; // The amount of scopes it runs in
+	std::vector<float> cpu_ms; // The CPU time of every frame, 0 in frames the scope didn't run in
+	std::vector<float> gpu_ms; // The GPU time of every frame, -1 until the queries of the frame are read or if they were dropped
+};
+
+/*
+A frame profiler with nestable scopes, every scope is timed on the CPU and with a pair of GL_TIMESTAMP queries on the GPU.
+Timestamps instead of GL_TIME_ELAPSED queries because elapsed queries can't be nested.
+The queries of a frame are read FRAME_LAG frames later so profiling never waits for the GPU, if they are still not done by then they are dropped.
+Scopes are only recorded in between BeginFrame and EndFrame, so code that is also run outside the main loop can keep its scopes
+*/
+namespace Profiler {
+	const size_t HISTORY = 120; // The amount of frames the scopes and the frame times are kept for
+	const size_t FRAME_LAG = 4; // The amount of frames whose GPU queries are in flight
+	const int HISTOGRAM_BUCKETS = 16; // The amount of bars in the histogram of a scope
+
+	// Documented in Profiler.cpp
+	void BeginFrame();
+	void EndFrame();
+	void Begin(const char* name);
+	void End();
+	void Clear();
+	size_t GetFrameCount();
+	const std::vector<ProfilerScope>& GetScopes();
+	const std::vector<float>& GetFrameTimes();
+	const std::vector<float>& GetGpuFrameTimes();
+	float GetAverage(const std::vector<float>& history);
+	float GetMaximum(const std::vector<float>& history);
+	std::vector<int> GetHistogram(const std::vector<float>& history, float maxMs);
+}
@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <cstring>
+
+#include "RenderQueue.h"
+
+const int PROGRAM_BITS = 8, TEXTURE_BITS = 12, MATERIAL_BITS = 8, VAO_BITS = 12, DEPTH_BITS = 24; // The widths of the fields of a key, 64 bits in total
+
+/*
+Clamps an id to the amount of bits of its field. Ids that don't fit share the last value, which only costs sorting quality
+*/
+static uint64_t Field(uint32_t id, int bits) {
+	uint32_t max = (1u << bits) - 1;
+	return id < max ? id : max;
+}
+
+/*
+Packs the state of a draw into a sort key
+@param program - The rank of the program
+@param texture - The rank of the texture
+@param material - The rank of the material
+@param vao - The rank of the vao
+@param depth - The view space distance of the draw, draws with the same state are sorted front to back
+@returns The key
+*/
+uint64_t RenderQueue::MakeKey(uint32_t program, uint32_t texture, uint32_t material, uint32_t vao, float depth) {
+	// The bits of a positive float sort the same as the float itself, the top 24 are enough to order draws
+	uint32_t depthBits = 0;
+	if (depth > 0)
+		memcpy(&depthBits, &depth, sizeof(depthBits));
+	uint64_t key = Field(program, PROGRAM_BITS);
+	key = (key << TEXTURE_BITS) | Field(texture, TEXTURE_BITS);
+	key = (key << MATERIAL_BITS) | Field(material, MATERIAL_BITS);
+	key = (key << VAO_BITS) | Field(vao, VAO_BITS);
+	key = (key << DEPTH_BITS) | (depthBits >> (32 - DEPTH_BITS));
+	return key;
+}
+
+/*
+Empties the queue, keeping its memory for the next frame
+*/
+void RenderQueue::Clear() {
+	m_Items.clear();
+}
+
+/*
+Adds a draw to the queue
+@param key - The sort key made with MakeKey
+@param index - The index of the draw in the list of the caller
+*/
+void RenderQueue::Push(uint64_t key, uint32_t index) {
+	m_Items.push_back(DrawItem{ key, index });
+}
+
+/*
+Sorts the queue by key, draws with equal keys keep the order they were pushed in
+*/
+void RenderQueue::Sort() {
+	std::sort(m_Items.begin(), m_Items.end(), [](const DrawItem& a, const DrawItem& b) {
+		return a.key < b.key || (a.key == b.key && a.index < b.index);
+	});
+}
+
+/*
+@returns The queued draws, in order after Sort
+*/
+const std::vector<DrawItem>& RenderQueue::GetItems() {
+	return m_Items;
+}
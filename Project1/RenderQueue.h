@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/*
+A single entry of the render queue: the sort key and the index of whatever is drawn
+*/
+struct DrawItem {
+	uint64_t key; // The sort key, see RenderQueue::MakeKey
+	uint32_t index; // The index of the draw in the list of the caller
+};
+
+/*
+Orders draws so that the most expensive state changes happen the least.
+The key packs, from most to least significant: program (8 bits), texture (12 bits), material (8 bits), vao (12 bits) and depth (24 bits).
+Programs, textures, materials and vaos are passed as small ids (their rank), not as GL names
+*/
+class RenderQueue {
+private:
+	std::vector<DrawItem> m_Items; // The queued draws
+
+public:
+	// Methods are documented in RenderQueue.cpp
+	static uint64_t MakeKey(uint32_t program, uint32_t texture, uint32_t material, uint32_t vao, float depth);
+	void Clear();
+	void Push(uint64_t key, uint32_t index);
+	void Sort();
+	const std::vector<DrawItem>& GetItems();
+};
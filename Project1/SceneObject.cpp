@@ -3,9 +3,12 @@
 #include <GL/freeglut.h>
 
 #include "SceneObject.h"
-#include "objloader.h"
-#include "texture.h"
-#include "glsl.h"
+#include "ShaderCache.h"
+#include "StateCache.h"
+#include "UniformBuffers.h"
+#include "ObjectStore.h"
+#include "AssetLoader.h"
+#include "TextureArrays.h"
 #include "MathsHelper.h"
 
 /*
@@ -13,8 +16,8 @@ Constructor used for the factory.
 !!!DO NOT CALL THIS MANUALLY!!!
 */
 SceneObject::SceneObject() {
-	m_Model = glm::mat4(1.0f);
-	m_Animation = nullptr;
+	m_Id = ObjectStore::Create(this);
+	m_Buffers = nullptr;
 }
 
 /*
@@ -22,36 +25,50 @@ Constructor used for manual creation.
 Loads the object and texture.
 */
 SceneObject::SceneObject(const char* name, const char* modelPath, const char* texturePath, Shader shader) {
-	bool res = loadOBJ(modelPath, m_Vertices[0], m_UVs[0], m_Normals[0]);
-	m_Texture_ID = loadBMP(texturePath);
-	m_Model = glm::mat4(1.0f);
+	m_Id = ObjectStore::Create(this);
+	LoadModel(modelPath);
+	LoadTexture(texturePath);
 	Name = name;
 	m_Shader = shader;
-	m_Animation = nullptr;
+	m_Buffers = nullptr;
 }
 
 /*
-Destructor, handles cleanup of the animation if there is any
+Destructor, handles cleanup of the animation if there is any, removes the object from its registry and frees its entry in the ObjectStore.
+The model and texture are freed by the AssetCache when no other object uses them anymore
 */
 SceneObject::~SceneObject() {
-	if (m_Animation != nullptr)
-		delete m_Animation;
+	ClearAnimation();
+	if (m_Registry != nullptr)
+		m_Registry->Remove(m_Handle);
+	ObjectStore::Destroy(m_Id);
 }
 
 /*
-Loads the object file
+Loads the object file, or shares it with the objects that already loaded the same file.
+The object uses the placeholder until the AssetLoader made the model resident, see RefreshAssets
 @param modelPath - The path of the .obj file
 */
 void SceneObject::LoadModel(const char* modelPath) {
-	bool res = loadOBJ(modelPath, m_Vertices[0], m_UVs[0], m_Normals[0]);
+	m_Mesh = AssetCache::GetMesh(modelPath);
+	ObjectStore::Bounds()[ObjectStore::IndexOf(m_Id)] = GetBounds();
 }
 
 /*
-Loads the texture file
+Loads the texture file, or shares it with the objects that already loaded the same file
 @param texturePath - The path of the .bmp file
 */
 void SceneObject::LoadTexture(const char* texturePath) {
-	m_Texture_ID = loadBMP(texturePath);
+	m_Texture = AssetCache::GetTexture(texturePath);
+}
+
+/*
+Sets the layout of the vertex buffer, must be called before InitBuffers
+VertexFormat::COMPACT (the default) halves the size of a vertex, VertexFormat::FLOAT keeps the exact values of the model
+@param format - The vertex format
+*/
+void SceneObject::SetVertexFormat(VertexFormat format) {
+	m_VertexFormat = format;
 }
 
 /*
@@ -63,18 +80,13 @@ void SceneObject::SetShader(Shader shader) {
 }
 
 /*
-Sets the vertex shader and fragment shader for this object
+Sets the vertex shader and fragment shader for this object.
+The program is shared with every object that uses the same shaders, it is only compiled for the first one (see ShaderCache)
 @param fragmentShaderPath - The path of the fragment shader
 @param vertexShaderPath - The path of the vertex shader
 */
 void SceneObject::SetShader(const char* fragmentShaderPath, const char* vertexShaderPath) {
-	m_VertexShader = glsl::readFile(vertexShaderPath);
-	GLuint vsh_id = glsl::makeVertexShader(m_VertexShader);
-
-	m_FragmentShader = glsl::readFile(fragmentShaderPath);
-	GLuint fsh_id = glsl::makeFragmentShader(m_FragmentShader);
-
-	m_Programme_ID = glsl::makeShaderProgram(vsh_id, fsh_id);
+	m_Programme_ID = ShaderCache::GetProgram(vertexShaderPath, fragmentShaderPath);
 }
 
 /*
@@ -102,124 +114,200 @@ void SceneObject::SetLight(const LightSource* lightsource) {
 }
 
 /*
-Renders the object to the screen
-@param view - The view matrix
+@returns The model of this object
+*/
+Mesh* SceneObject::GetMesh() {
+	return m_Mesh.get();
+}
+
+/*
+@returns The geometry used for the bounds of this object, the placeholder while the model is not resident
+*/
+const MeshData* SceneObject::GetBounds() {
+	if (!m_Mesh)
+		return nullptr;
+	return m_Mesh->Resident ? &m_Mesh->Data : &AssetLoader::GetPlaceholderMesh()->Data;
+}
+
+/*
+@returns The texture of this object
+*/
+Texture* SceneObject::GetTexture() {
+	return m_Texture.get();
+}
+
+/*
+@returns The program ID of this object
+*/
+GLuint SceneObject::GetProgram() {
+	return m_Programme_ID;
+}
+
+/*
+@returns The material of this object
 */
-void SceneObject::Render(const glm::mat4* view) {
-	glUseProgram(m_Programme_ID);
+const Material* SceneObject::GetMaterial() {
+	return m_Material;
+}
 
-	m_MV = *view * m_Model;
+/*
+@returns The light source of this object
+*/
+const LightSource* SceneObject::GetLight() {
+	return m_Light;
+}
 
-	// Send mv
-	glUniformMatrix4fv(uniform_mv, 1, GL_FALSE, glm::value_ptr(m_MV));
+/*
+@returns The index of the material of this object in the MaterialData block, set by InitBuffers
+*/
+int SceneObject::GetMaterialIndex() {
+	return m_MaterialIndex;
+}
 
-	glBindTexture(GL_TEXTURE_2D, m_Texture_ID);
+/*
+@returns The index of the light of this object in the FrameData block, set by InitBuffers
+*/
+int SceneObject::GetLightIndex() {
+	return m_LightIndex;
+}
 
-	glUniform3fv(uniform_light_pos, 1, glm::value_ptr((*m_Light).position));
-	glUniform3fv(uniform_material_ambient, 1, glm::value_ptr((*m_Material).ambient_colour));
-	glUniform3fv(uniform_material_diffuse, 1, glm::value_ptr((*m_Material).diffuse_colour));
-	glUniform3fv(uniform_material_specular, 1, glm::value_ptr((*m_Material).specular));
-	glUniform1f(uniform_material_power, (*m_Material).power);
+/*
+@returns The GPU buffers of the model of this object, nullptr before InitBuffers
+*/
+const MeshBuffers* SceneObject::GetBuffers() {
+	return m_Buffers;
+}
 
-	// Send vao
-	glBindVertexArray(m_Vao);
-	glDrawArrays(GL_TRIANGLES, 0, m_Vertices[0].size());
-	glBindVertexArray(0);
+/*
+@returns The model matrix of this object
+*/
+const glm::mat4& SceneObject::GetModel() {
+	return ObjectStore::Models()[ObjectStore::IndexOf(m_Id)];
 }
 
 /*
-Initialises the buffers of the object
-@param view - The view matrix
-@param projection - The projection matrix
+@returns The absolute position of this object
 */
-void SceneObject::InitBuffers(const glm::mat4* view, const glm::mat4* projection) {
-	GLuint position_id, color_id;
-	GLuint vbo_vertices, vbo_normals, vbo_uvs;
+const glm::vec3& SceneObject::GetPosition() {
+	return ObjectStore::Positions()[ObjectStore::IndexOf(m_Id)];
+}
 
-	GLuint uv_id = glGetAttribLocation(m_Programme_ID, "uv");
+/*
+@returns The absolute rotation of this object in degrees
+*/
+const glm::vec3& SceneObject::GetRotation() {
+	return ObjectStore::Rotations()[ObjectStore::IndexOf(m_Id)];
+}
 
-	// Get vertex attributes
-	position_id = glGetAttribLocation(m_Programme_ID, "position");
-	color_id = glGetAttribLocation(m_Programme_ID, "colour");
-	GLuint normal_id = glGetAttribLocation(m_Programme_ID, "normal");
+/*
+@returns The id of this object in the ObjectStore
+*/
+uint32_t SceneObject::GetStoreId() {
+	return m_Id;
+}
 
+/*
+Binds the program and the texture array and sends every uniform, the model matrix and texture layer are per-instance attributes.
+Objects that share a model, program, material and light leave the exact same state behind, which is what the instanced renderer relies on
+*/
+void SceneObject::BindState() {
+	StateCache::UseProgram(m_Programme_ID);
+	StateCache::BindTexture(TextureArrays::GetName());
+
+	// The view, projection, light and material values live in the uniform blocks, the object only selects its entries
+	StateCache::Uniform1i(uniform_light_index, m_LightIndex);
+	StateCache::Uniform1i(uniform_material_index, m_MaterialIndex);
+
+	const PackedVertices& packed = m_Buffers->packed;
+	StateCache::Uniform3fv(uniform_position_offset, glm::value_ptr(packed.position_offset));
+	StateCache::Uniform3fv(uniform_position_scale, glm::value_ptr(packed.position_scale));
+	StateCache::Uniform2fv(uniform_uv_offset, glm::value_ptr(packed.uv_offset));
+	StateCache::Uniform2fv(uniform_uv_scale, glm::value_ptr(packed.uv_scale));
+	StateCache::Uniform1i(uniform_oct_normals, packed.oct_normals);
+	StateCache::Uniform1i(uniform_indirect_draw, 0);
+}
+
+/*
+Renders the object to the screen on its own.
+The model matrix and texture layer are sent as the constant values of the per-instance attributes, so the same shader serves single and instanced draws
+*/
+void SceneObject::Render() {
+	BindState();
+
+	// Send model and layer
+	const glm::mat4& model = GetModel();
+	for (GLuint column = 0; column < 4; column++)
+		glVertexAttrib4fv(VertexAttribute::INSTANCE_MODEL + column, glm::value_ptr(model[column]));
+	glVertexAttribI1ui(VertexAttribute::INSTANCE_LAYER, m_Texture->GetSampledLayer());
+
+	// Send vao
+	StateCache::BindVertexArray(m_Buffers->vao);
+	glDrawElements(GL_TRIANGLES, m_Buffers->index_count, m_Buffers->index_type, 0);
+	StateCache::BindVertexArray(0);
+}
+
+/*
+Initialises the buffers of the object and adds its material and light to the uniform blocks
+*/
+void SceneObject::InitBuffers() {
 	// Make uniform vars
-	uniform_mv = glGetUniformLocation(m_Programme_ID, "mv");
-	GLuint uniform_proj = glGetUniformLocation(m_Programme_ID, "projection");
-	uniform_light_pos = glGetUniformLocation(m_Programme_ID, "light_pos");
-	uniform_material_ambient = glGetUniformLocation(m_Programme_ID, "mat_ambient");
-	uniform_material_diffuse = glGetUniformLocation(m_Programme_ID, "mat_diffuse");
-	uniform_material_specular = glGetUniformLocation(m_Programme_ID, "mat_specular");
-	uniform_material_power = glGetUniformLocation(m_Programme_ID, "mat_power");
-
-	glGenBuffers(1, &vbo_normals);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_normals);
-	glBufferData(GL_ARRAY_BUFFER,
-		m_Normals[0].size() * sizeof(glm::vec3),
-		&m_Normals[0][0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	glGenBuffers(1, &vbo_vertices);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices);
-	glBufferData(GL_ARRAY_BUFFER,
-		m_Vertices[0].size() * sizeof(glm::vec3), &m_Vertices[0][0],
-		GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	glGenBuffers(1, &vbo_uvs);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_uvs);
-	glBufferData(GL_ARRAY_BUFFER, m_UVs[0].size() * sizeof(glm::vec2),
-		&m_UVs[0][0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	// Allocate memory for vao
-	glGenVertexArrays(1, &m_Vao);
-
-	// Bind to vao
-	glBindVertexArray(m_Vao);
-
-	// Bind vertices to vao
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices);
-	glVertexAttribPointer(position_id, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(position_id);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_normals);
-	glVertexAttribPointer(normal_id, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(normal_id);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_uvs);
-	glVertexAttribPointer(uv_id, 2, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(uv_id);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	// Stop bind to vao
-	glBindVertexArray(0);
-	// Define model
-	m_MV = *view * m_Model;
-
-	// Send mvp
-	glUseProgram(m_Programme_ID);
-	glUniformMatrix4fv(uniform_mv, 1, GL_FALSE, glm::value_ptr(m_MV));
-	glUniformMatrix4fv(uniform_proj, 1, GL_FALSE, glm::value_ptr(*projection));
+	uniform_material_index = glGetUniformLocation(m_Programme_ID, "material_index");
+	uniform_light_index = glGetUniformLocation(m_Programme_ID, "light_index");
+	uniform_position_offset = glGetUniformLocation(m_Programme_ID, "position_offset");
+	uniform_position_scale = glGetUniformLocation(m_Programme_ID, "position_scale");
+	uniform_uv_offset = glGetUniformLocation(m_Programme_ID, "uv_offset");
+	uniform_uv_scale = glGetUniformLocation(m_Programme_ID, "uv_scale");
+	uniform_oct_normals = glGetUniformLocation(m_Programme_ID, "oct_normals");
+	uniform_indirect_draw = glGetUniformLocation(m_Programme_ID, "indirect_draw");
+
+	m_MaterialIndex = UniformBuffers::RegisterMaterial(m_Material);
+	m_LightIndex = UniformBuffers::RegisterLight(m_Light);
+
+	SelectMesh();
+}
+
+/*
+Points the buffers and bounds to the model, or to the placeholder while the model is not resident
+*/
+void SceneObject::SelectMesh() {
+	m_UsesPlaceholder = !m_Mesh->Resident;
+	Mesh* mesh = m_UsesPlaceholder ? AssetLoader::GetPlaceholderMesh() : m_Mesh.get();
+
+	// Upload the model, this only happens for the first object that uses the model in this vertex format
+	m_Buffers = &mesh->GetBuffers(m_VertexFormat);
+	ObjectStore::Bounds()[ObjectStore::IndexOf(m_Id)] = GetBounds();
+}
+
+/*
+Swaps the placeholder for the model once the AssetLoader made it resident, should be called after every AssetLoader::Update.
+Textures swap by themselves, but the model changes the buffers and bounds of the object
+@returns If the object changed, the instanced renderer needs to be rebuilt then
+*/
+bool SceneObject::RefreshAssets() {
+	if (!m_UsesPlaceholder || !m_Mesh->Resident)
+		return false;
+	SelectMesh();
+	OnMoved();
+	return true;
 }
 
 /*
 Translate (or move) the object with the specified translation
 There is a check on the rotation of the object because it would not translate in the way you would expect
-Also updates the m_Position variable to keep track of the absolute position of the object
+Also updates the absolute position to keep track of the position of the object
 @param translation - The translation to apply to this object
 */
 void SceneObject::Translate(const glm::vec3& translation) {
+	uint32_t index = ObjectStore::IndexOf(m_Id);
+	const glm::vec3& rotation = ObjectStore::Rotations()[index];
 	glm::vec3 trans = translation;
-	if (m_Rotation != glm::vec3(0.0f)) {
-		if (m_Rotation.y <= 90) {
+	if (rotation != glm::vec3(0.0f)) {
+		if (rotation.y <= 90) {
 			trans.z = translation.x;
 			trans.x = translation.z;
-		} else if (m_Rotation.y <= 180) {
+		} else if (rotation.y <= 180) {
 			trans = -translation;
-		} else if (m_Rotation.y <= 270) {
+		} else if (rotation.y <= 270) {
 			trans.z = -translation.x;
 			trans.x = -translation.z;
 		} else {
@@ -227,28 +315,34 @@ void SceneObject::Translate(const glm::vec3& translation) {
 		}
 	}
 
-	m_Model = glm::translate(m_Model, trans);
-	m_Position += translation;
+	glm::mat4& model = ObjectStore::Models()[index];
+	model = glm::translate(model, trans);
+	ObjectStore::Positions()[index] += translation;
+	OnMoved();
 }
 
 /*
 Rotate the object with given angle on the given axis
-Also updates the m_Rotation variable to keep track of the absolute rotation of the object (in degrees)
+Also updates the absolute rotation to keep track of the rotation of the object (in degrees)
 @param angleRad - The angle to rotate with (in radians)
 @param axis - The axis to rotate on. (0, 1, 0) would rotate on the y-axis and stay horizontal
 */
 void SceneObject::Rotate(const float angleRad, const glm::vec3& axis) {
-	m_Model = glm::rotate(m_Model, angleRad, axis);
-	m_Rotation += glm::degrees(angleRad) * axis;
-	if (m_Rotation.x < 0)
-		m_Rotation.x += 360;
-	if (m_Rotation.y < 0)
-		m_Rotation.y += 360;
-	if (m_Rotation.z < 0)
-		m_Rotation.z += 360;
-	m_Rotation.x = (int)m_Rotation.x % 360;
-	m_Rotation.y = (int)m_Rotation.y % 360;
-	m_Rotation.z = (int)m_Rotation.z % 360;
+	uint32_t index = ObjectStore::IndexOf(m_Id);
+	glm::mat4& model = ObjectStore::Models()[index];
+	glm::vec3& rotation = ObjectStore::Rotations()[index];
+	model = glm::rotate(model, angleRad, axis);
+	rotation += glm::degrees(angleRad) * axis;
+	if (rotation.x < 0)
+		rotation.x += 360;
+	if (rotation.y < 0)
+		rotation.y += 360;
+	if (rotation.z < 0)
+		rotation.z += 360;
+	rotation.x = (int)rotation.x % 360;
+	rotation.y = (int)rotation.y % 360;
+	rotation.z = (int)rotation.z % 360;
+	OnMoved();
 }
 
 /*
@@ -256,32 +350,52 @@ Scales the object with a given scalar
 @param scalar - The scalar to apply. (1, 1, 1) would be unchanged
 */
 void SceneObject::Scale(const glm::vec3& scalar) {
-	m_Model = glm::scale(m_Model, scalar);
+	glm::mat4& model = ObjectStore::Models()[ObjectStore::IndexOf(m_Id)];
+	model = glm::scale(model, scalar);
+	OnMoved();
 }
 
 /*
-Sets the animation to play from the heap-allocated animation variable
+Sets the animation to play from the heap-allocated animation variable, it starts from the transform the object has at the next ObjectStore::Animate
 @param animation - The animation to play
 */
 void SceneObject::SetAnimation(Animation* animation) {
-	m_Animation = animation;
+	ObjectStore::Animations()[ObjectStore::IndexOf(m_Id)] = animation;
 }
 
 /*
 Clears the animation if one was set
 */
 void SceneObject::ClearAnimation() {
-	if (m_Animation != nullptr) {
-		delete m_Animation;
-		m_Animation = nullptr;
+	Animation*& animation = ObjectStore::Animations()[ObjectStore::IndexOf(m_Id)];
+	if (animation != nullptr) {
+		delete animation;
+		animation = nullptr;
 	}
 }
 
 /*
-Animates the object if one was set
+Called by SceneRegistry when the object is (un)registered
+@param registry - The registry, nullptr when the object is removed from it
+@param handle - The handle of the object in the registry
 */
-void SceneObject::Animate() {
-	if (m_Animation != nullptr) {
-		m_Animation->Animate(this);
-	}
+void SceneObject::SetRegistration(SceneRegistry* registry, ObjectHandle handle) {
+	m_Registry = registry;
+	m_Handle = handle;
+}
+
+/*
+@returns The handle of this object in its registry, an invalid handle if it is not registered
+*/
+ObjectHandle SceneObject::GetHandle() {
+	return m_Handle;
+}
+
+/*
+Tells the registry that the model matrix changed, so it can move the object in its octree.
+Called by the transform methods, and by ObjectStore::Animate for animated objects
+*/
+void SceneObject::OnMoved() {
+	if (m_Registry != nullptr)
+		m_Registry->Update(m_Handle);
 }
\ No newline at end of file
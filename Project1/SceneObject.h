@@ -2,33 +2,40 @@
 #include <GL/freeglut.h>
 #include <glm/glm.hpp>
 #include <vector>
+#include <memory>
 #include "Material.h"
 #include "LightSource.h"
 #include "Shader.h"
 #include "Animation.h"
+#include "AssetCache.h"
+#include "SceneRegistry.h"
+#include "ObjectStore.h"
 
 class SceneObject {
 public:
 	const char* Name; // The name of the scene object
-	glm::vec3 m_Position = glm::vec3(), m_Rotation = glm::vec3(); // The absolute position and rotation of the scene object
 private:
-	GLuint m_Texture_ID, m_Vao; // The texture ID and Vertex Array Object
+	uint32_t m_Id; // The id of the transform, animation and bounds of this object in the ObjectStore
+	std::shared_ptr<Mesh> m_Mesh; // The model, shared with every object that uses the same .obj file
+	std::shared_ptr<Texture> m_Texture; // The texture, shared with every object that uses the same .bmp file
+	const MeshBuffers* m_Buffers; // The GPU buffers of the model in m_VertexFormat, set by InitBuffers
+	bool m_UsesPlaceholder = false; // If m_Buffers and the bounds are those of the placeholder because the model is still loading
 	GLuint m_Programme_ID; // The program ID made with the vertex and fragment shader
-	GLuint uniform_mv; // The uniform model-view variable
-	GLuint uniform_material_ambient; // The uniform material ambient_colour variable
-	GLuint uniform_material_diffuse; // The uniform material diffuse_colour variable
-	GLuint uniform_material_specular; // The uniform material specular variable
-	GLuint uniform_material_power; // The uniform material specular power variable
-	GLuint uniform_light_pos; // The uniform light position variable
+	GLuint uniform_material_index; // The uniform variable selecting the material in the MaterialData block
+	GLuint uniform_light_index; // The uniform variable selecting the light in the FrameData block
+	GLuint uniform_position_offset, uniform_position_scale; // The uniform position dequantization variables
+	GLuint uniform_uv_offset, uniform_uv_scale; // The uniform uv dequantization variables
+	GLuint uniform_oct_normals; // The uniform variable telling if the normals are octahedral encoded
+	GLuint uniform_indirect_draw; // The uniform variable telling if the per-draw data comes from the DrawData buffer of the IndirectRenderer
 	const Material* m_Material; // A pointer to the given material
 	const LightSource* m_Light; // A pointer to the given light
-	Animation* m_Animation; // A pointer to the given animation
-	const char* m_FragmentShader; // The compiled fragment shader
-	const char* m_VertexShader; // The compiled vertex shader
-	glm::mat4 m_Model, m_MV; // The model matrix and model-view matrix
-	std::vector<glm::vec3> m_Normals[1], m_Vertices[1]; // The vector array of normals and vertices
-	std::vector<glm::vec2> m_UVs[1]; // The vector array of UVs
+	int m_MaterialIndex = 0, m_LightIndex = 0; // The indices of the material and light in the uniform blocks, set by InitBuffers
+	VertexFormat m_VertexFormat = VertexFormat::COMPACT; // The layout of the vertex buffer
 	Shader m_Shader; // The shader type of this object
+	SceneRegistry* m_Registry = nullptr; // The registry this object is registered in, told about every move
+	ObjectHandle m_Handle; // The handle of this object in m_Registry
+
+	void SelectMesh();
 
 public:
 	// Methods are documented in SceneObject.cpp
@@ -37,17 +44,35 @@ public:
 	~SceneObject();
 	void LoadModel(const char* modelPath);
 	void LoadTexture(const char* texturePath);
+	void SetVertexFormat(VertexFormat format);
 	void SetShader(Shader shader);
 	void SetShader(const char* fragmentShaderPath, const char* vertexShaderPath);
 	Shader GetShader();
 	void SetMaterial(const Material* material);
 	void SetLight(const LightSource* lightsource);
-	void Render(const glm::mat4* view);
-	void InitBuffers(const glm::mat4* view, const glm::mat4* projection);
+	Mesh* GetMesh();
+	const MeshData* GetBounds();
+	Texture* GetTexture();
+	GLuint GetProgram();
+	const Material* GetMaterial();
+	const LightSource* GetLight();
+	int GetMaterialIndex();
+	int GetLightIndex();
+	const MeshBuffers* GetBuffers();
+	const glm::mat4& GetModel();
+	const glm::vec3& GetPosition();
+	const glm::vec3& GetRotation();
+	uint32_t GetStoreId();
+	void BindState();
+	void Render();
+	void InitBuffers();
+	bool RefreshAssets();
 	void Translate(const glm::vec3& translation);
 	void Rotate(const float angleRad, const glm::vec3& axis);
 	void Scale(const glm::vec3& scalar);
 	void SetAnimation(Animation* animation);
 	void ClearAnimation();
-	void Animate();
+	void SetRegistration(SceneRegistry* registry, ObjectHandle handle);
+	ObjectHandle GetHandle();
+	void OnMoved();
 };
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <numeric>
+
+#include "SceneRegistry.h"
+#include "SceneObject.h"
+
+/*
+Constructor
+@param center - The center of the region the octree is made for
+@param halfSize - Half the size of that region, objects outside it still work but are not sorted spatially
+*/
+SceneRegistry::SceneRegistry(const glm::vec3& center, float halfSize) : m_Octree(center, halfSize) {
+	m_Count = 0;
+}
+
+/*
+Destructor, unregisters the objects that are still registered (the objects themselves are owned by the caller)
+*/
+SceneRegistry::~SceneRegistry() {
+	Clear();
+}
+
+/*
+Returns the world space bounds of an object
+*/
+void SceneRegistry::GetWorldBounds(SceneObject* object, glm::vec3& center, glm::vec3& extent) const {
+	float radius;
+	object->GetBounds()->TransformBounds(object->GetModel(), center, extent, radius);
+}
+
+/*
+Registers an object, after which it keeps its entry in the octree up to date by itself
+@param object - The object, its model must be loaded
+@returns The handle of the object
+*/
+ObjectHandle SceneRegistry::Add(SceneObject* object) {
+	ObjectHandle handle;
+	if (!m_FreeSlots.empty()) {
+		handle.index = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+	} else {
+		handle.index = (uint32_t)m_Slots.size();
+		m_Slots.push_back(Slot());
+	}
+	Slot& slot = m_Slots[handle.index];
+	slot.object = object;
+	handle.generation = slot.generation;
+	m_Count++;
+
+	if (object->Name != nullptr)
+		m_Names.emplace(object->Name, handle);
+
+	glm::vec3 center, extent;
+	GetWorldBounds(object, center, extent);
+	m_Octree.Insert(handle.index, center, extent);
+	object->SetRegistration(this, handle);
+	return handle;
+}
+
+/*
+Unregisters an object, handles to it become invalid
+@param handle - The handle of the object
+*/
+void SceneRegistry::Remove(ObjectHandle handle) {
+	SceneObject* object = Get(handle);
+	if (object == nullptr)
+		return;
+
+	if (object->Name != nullptr) {
+		auto it = m_Names.find(object->Name);
+		if (it != m_Names.end() && it->second == handle)
+			m_Names.erase(it);
+	}
+	m_Octree.Remove(handle.index);
+	object->SetRegistration(nullptr, ObjectHandle());
+
+	Slot& slot = m_Slots[handle.index];
+	slot.object = nullptr;
+	slot.generation++;
+	m_FreeSlots.push_back(handle.index);
+	m_Count--;
+}
+
+/*
+Updates the world bounds of an object after it moved, called by the object itself
+@param handle - The handle of the object
+*/
+void SceneRegistry::Update(ObjectHandle handle) {
+	SceneObject* object = Get(handle);
+	if (object == nullptr)
+		return;
+	glm::vec3 center, extent;
+	GetWorldBounds(object, center, extent);
+	m_Octree.Update(handle.index, center, extent);
+}
+
+/*
+Unregisters all objects
+*/
+void SceneRegistry::Clear() {
+	for (size_t i = 0; i < m_Slots.size(); i++) {
+		if (m_Slots[i].object != nullptr)
+			m_Slots[i].object->SetRegistration(nullptr, ObjectHandle());
+	}
+	m_Slots.clear();
+	m_FreeSlots.clear();
+	m_Names.clear();
+	m_Octree.Clear();
+	m_Count = 0;
+}
+
+/*
+@param handle - The handle of the object
+@returns The object, or nullptr if the handle is invalid or the object was removed
+*/
+SceneObject* SceneRegistry::Get(ObjectHandle handle) const {
+	if (handle.index >= m_Slots.size() || m_Slots[handle.index].generation != handle.generation)
+		return nullptr;
+	return m_Slots[handle.index].object;
+}
+
+/*
+Finds an object by name
+@param name - The name to search for
+@returns The handle of the object, an invalid handle if there is no object with that name
+*/
+ObjectHandle SceneRegistry::Find(const char* name) const {
+	auto it = m_Names.find(name);
+	if (it == m_Names.end())
+		return ObjectHandle();
+	return it->second;
+}
+
+/*
+@returns The amount of registered objects
+*/
+size_t SceneRegistry::GetCount() const {
+	return m_Count;
+}
+
+/*
+Turns octree ids into handles
+*/
+void SceneRegistry::ToHandles(const std::vector<uint32_t>& ids, std::vector<ObjectHandle>& result) const {
+	for (size_t i = 0; i < ids.size(); i++) {
+		ObjectHandle handle;
+		handle.index = ids[i];
+		handle.generation = m_Slots[ids[i]].generation;
+		result.push_back(handle);
+	}
+}
+
+/*
+Finds the objects whose world bounding box is within a distance of a point
+@param center - The point
+@param radius - The distance
+@param result - The handles of the objects are appended to this, in no particular order
+*/
+void SceneRegistry::QueryRadius(const glm::vec3& center, float radius, std::vector<ObjectHandle>& result) const {
+	std::vector<uint32_t> ids;
+	m_Octree.QuerySphere(center, radius, ids);
+	ToHandles(ids, result);
+}
+
+/*
+Finds the objects whose world bounding box overlaps a box
+@param min - The minimum corner of the box
+@param max - The maximum corner of the box
+@param result - The handles of the objects are appended to this, in no particular order
+*/
+void SceneRegistry::QueryBox(const glm::vec3& min, const glm::vec3& max, std::vector<ObjectHandle>& result) const {
+	std::vector<uint32_t> ids;
+	m_Octree.QueryBox(min, max, ids);
+	ToHandles(ids, result);
+}
+
+/*
+Finds the objects whose world bounding box is hit by a ray, e.g. for picking
+@param origin - The start of the ray
+@param direction - The direction of the ray, normalised to get maxDistance in world units
+@param maxDistance - The length of the ray
+@param result - The handles of the objects are appended to this, nearest first
+*/
+void SceneRegistry::QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<ObjectHandle>& result) const {
+	std::vector<uint32_t> ids;
+	std::vector<float> distances;
+	m_Octree.QueryRay(origin, direction, maxDistance, ids, distances);
+
+	std::vector<size_t> order(ids.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&distances](size_t a, size_t b) { return distances[a] < distances[b]; });
+	std::vector<uint32_t> sorted(ids.size());
+	for (size_t i = 0; i < order.size(); i++)
+		sorted[i] = ids[order[i]];
+	ToHandles(sorted, result);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "LooseOctree.h"
+
+/*
+Forward declaration of SceneObject to counter-act circular dependency
+*/
+class SceneObject;
+
+/*
+A stable reference to an object in a SceneRegistry.
+The generation makes a handle to a removed object invalid, even when its slot is reused by a new object
+*/
+struct ObjectHandle {
+	uint32_t index = UINT32_MAX; // The slot of the object in the registry
+	uint32_t generation = 0; // The generation of the slot when the handle was made
+
+	bool IsValid() const { return index != UINT32_MAX; }
+	bool operator==(const ObjectHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const ObjectHandle& other) const { return !(*this == other); }
+};
+
+/*
+Keeps track of the objects in the scene: hands out handles, finds objects by name with a hash map
+and keeps their world bounds in a loose octree so radius, box and ray queries don't have to look at every object.
+Registered objects report their own moves (SceneObject::Translate/Rotate/Scale), the octree is updated incrementally
+*/
+class SceneRegistry {
+private:
+	/*
+	A place for an object, reused after the object is removed
+	*/
+	struct Slot {
+		SceneObject* object = nullptr; // The object, nullptr if the slot is free
+		uint32_t generation = 0; // Incremented every time the slot is freed
+	};
+
+	std::vector<Slot> m_Slots; // The objects, indexed by ObjectHandle::index
+	std::vector<uint32_t> m_FreeSlots; // The slots that can be reused
+	std::unordered_map<std::string, ObjectHandle> m_Names; // The objects by name, the first object registered with a name wins
+	LooseOctree m_Octree; // The world bounds of the objects, the octree ids are the slot indices
+	size_t m_Count; // The amount of registered objects
+
+public:
+	// Methods are documented in SceneRegistry.cpp
+	SceneRegistry(const glm::vec3& center = glm::vec3(0.0f), float halfSize = 256.0f);
+	~SceneRegistry();
+	SceneRegistry(const SceneRegistry&) = delete;
+	SceneRegistry& operator=(const SceneRegistry&) = delete;
+	ObjectHandle Add(SceneObject* object);
+	void Remove(ObjectHandle handle);
+	void Update(ObjectHandle handle);
+	void Clear();
+	SceneObject* Get(ObjectHandle handle) const;
+	ObjectHandle Find(const char* name) const;
+	size_t GetCount() const;
+	void QueryRadius(const glm::vec3& center, float radius, std::vector<ObjectHandle>& result) const;
+	void QueryBox(const glm::vec3& min, const glm::vec3& max, std::vector<ObjectHandle>& result) const;
+	void QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<ObjectHandle>& result) const;
+
+private:
+	void GetWorldBounds(SceneObject* object, glm::vec3& center, glm::vec3& extent) const;
+	void ToHandles(const std::vector<uint32_t>& ids, std::vector<ObjectHandle>& result) const;
+};
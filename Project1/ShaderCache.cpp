@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "ShaderCache.h"
+#include "glsl.h"
+
+namespace ShaderCache {
+	const char* CACHE_DIRECTORY = "shadercache"; // Where the program binaries are stored, relative to the working directory
+	const char MAGIC[4] = { 'C', 'G', 'P', 'B' }; // Identifies a program binary file
+	const uint32_t VERSION = 1; // Bump whenever the file layout changes
+
+	/*
+	The header of a program binary file, followed by the binary itself
+	*/
+	struct BinaryHeader {
+		char magic[4]; // Always MAGIC
+		uint32_t version; // Always VERSION
+		uint64_t source_hash; // The hash of the vertex and fragment source the binary was linked from
+		uint64_t driver_hash; // The hash of the vendor, renderer and version strings of the driver that made the binary
+		uint32_t format; // The binary format reported by glGetProgramBinary
+		uint32_t length; // The length of the binary in bytes
+	};
+
+	std::unordered_map<std::string, std::string> sources; // The shader sources by path, every file is read once
+	std::unordered_map<uint64_t, GLuint> programs; // The linked programs by source hash
+	int compileCount = 0; // The amount of programs that were compiled from GLSL
+	int binaryLoadCount = 0; // The amount of programs that were loaded from a binary
+
+	/*
+	64-bit FNV-1a hash
+	*/
+	static uint64_t Hash(const void* data, size_t length, uint64_t hash = 14695981039346656037ull) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < length; i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	/*
+	Returns the source of a shader file, reading it the first time it is asked for
+	*/
+	static const std::string& GetSource(const char* path) {
+		auto it = sources.find(path);
+		if (it != sources.end())
+			return it->second;
+		char* contents = glsl::readFile(path);
+		std::string& source = sources[path];
+		if (contents != nullptr) {
+			source = contents;
+			delete[] contents;
+		}
+		return source;
+	}
+
+	/*
+	Returns a hash that identifies the driver, binaries from another driver (version) are never handed to glProgramBinary
+	*/
+	static uint64_t GetDriverHash() {
+		uint64_t hash = 14695981039346656037ull;
+		const GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+		for (int i = 0; i < 3; i++) {
+			const char* value = (const char*)glGetString(names[i]);
+			if (value != nullptr)
+				hash = Hash(value, strlen(value) + 1, hash);
+		}
+		return hash;
+	}
+
+	/*
+	Returns the path of the binary file of a program
+	*/
+	static std::string GetBinaryPath(uint64_t sourceHash) {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.glbin", (unsigned long long)sourceHash);
+		return std::string(CACHE_DIRECTORY) + "/" + name;
+	}
+
+	/*
+	Returns if the driver can save and load program binaries at all
+	*/
+	static bool BinariesSupported() {
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return formats > 0;
+	}
+
+	/*
+	Returns if the program linked, prints the log if it did not
+	*/
+	static bool LinkedStatus(GLuint program) {
+		GLint linked = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (linked)
+			return true;
+		GLint logLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+		if (logLength > 0) {
+			std::vector<char> log(logLength);
+			glGetProgramInfoLog(program, logLength, NULL, log.data());
+			printf("%s\n", log.data());
+		}
+		return false;
+	}
+
+	/*
+	Tries to make a program from its binary file
+	@returns The program, or 0 if there is no usable binary
+	*/
+	static GLuint LoadBinary(uint64_t sourceHash, uint64_t driverHash) {
+		std::string path = GetBinaryPath(sourceHash);
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == nullptr)
+			return 0;
+		BinaryHeader header;
+		std::vector<char> binary;
+		bool ok = fread(&header, sizeof(header), 1, file) == 1
+			&& memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+			&& header.version == VERSION
+			&& header.source_hash == sourceHash
+			&& header.driver_hash == driverHash
+			&& header.length > 0;
+		if (ok) {
+			binary.resize(header.length);
+			ok = fread(binary.data(), 1, header.length, file) == header.length;
+		}
+		fclose(file);
+		if (!ok)
+			return 0;
+
+		GLuint program = glCreateProgram();
+		glProgramBinary(program, header.format, binary.data(), header.length);
+		GLint linked = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked) {
+			printf("Driver rejected program binary %s, compiling from source\n", path.c_str());
+			glDeleteProgram(program);
+			return 0;
+		}
+		return program;
+	}
+
+	/*
+	Writes the binary of a linked program to its binary file
+	*/
+	static void SaveBinary(GLuint program, uint64_t sourceHash, uint64_t driverHash) {
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		glGetProgramBinary(program, length, &length, &format, binary.data());
+
+		BinaryHeader header;
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.source_hash = sourceHash;
+		header.driver_hash = driverHash;
+		header.format = format;
+		header.length = (uint32_t)length;
+
+#ifdef _WIN32
+		_mkdir(CACHE_DIRECTORY);
+#else
+		mkdir(CACHE_DIRECTORY, 0755);
+#endif
+		std::string path = GetBinaryPath(sourceHash);
+		FILE* file = fopen(path.c_str(), "wb");
+		if (file == nullptr)
+			return;
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, length, file) == (size_t)length;
+		ok = fclose(file) == 0 && ok;
+		if (!ok)
+			remove(path.c_str());
+	}
+
+	/*
+	Compiles and links a program from GLSL source
+	@returns The program, or 0 if compiling or linking failed
+	*/
+	static GLuint Compile(const std::string& vertexSource, const std::string& fragmentSource, bool retrievable) {
+		GLuint vsh_id = glsl::makeVertexShader(vertexSource.c_str());
+		GLuint fsh_id = glsl::makeFragmentShader(fragmentSource.c_str());
+		if (vsh_id == (GLuint)-1 || fsh_id == (GLuint)-1) {
+			if (vsh_id != (GLuint)-1)
+				glDeleteShader(vsh_id);
+			if (fsh_id != (GLuint)-1)
+				glDeleteShader(fsh_id);
+			return 0;
+		}
+
+		GLuint program = glCreateProgram();
+		if (retrievable)
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glAttachShader(program, vsh_id);
+		glAttachShader(program, fsh_id);
+		glLinkProgram(program);
+
+		// The program keeps what it needs, the shader objects are not used again
+		glDetachShader(program, vsh_id);
+		glDetachShader(program, fsh_id);
+		glDeleteShader(vsh_id);
+		glDeleteShader(fsh_id);
+
+		compileCount++;
+		if (!LinkedStatus(program)) {
+			glDeleteProgram(program);
+			return 0;
+		}
+		return program;
+	}
+
+	/*
+	Returns the program made of the vertex and fragment shader, compiling it only if no one asked for the same sources before
+	@param vertexShaderPath - The path of the vertex shader
+	@param fragmentShaderPath - The path of the fragment shader
+	@returns The shared program, or 0 if it does not compile or link
+	*/
+	GLuint GetProgram(const char* vertexShaderPath, const char* fragmentShaderPath) {
+		const std::string& vertexSource = GetSource(vertexShaderPath);
+		const std::string& fragmentSource = GetSource(fragmentShaderPath);
+		// Hash the terminating 0 as well so the boundary between the two sources is part of the key
+		uint64_t sourceHash = Hash(vertexSource.c_str(), vertexSource.size() + 1);
+		sourceHash = Hash(fragmentSource.c_str(), fragmentSource.size() + 1, sourceHash);
+
+		auto it = programs.find(sourceHash);
+		if (it != programs.end())
+			return it->second;
+
+		bool binaries = BinariesSupported();
+		uint64_t driverHash = GetDriverHash();
+		GLuint program = 0;
+		if (binaries) {
+			program = LoadBinary(sourceHash, driverHash);
+			if (program != 0)
+				binaryLoadCount++;
+		}
+		if (program == 0) {
+			program = Compile(vertexSource, fragmentSource, binaries);
+			if (program != 0 && binaries)
+				SaveBinary(program, sourceHash, driverHash);
+		}
+		programs[sourceHash] = program;
+		return program;
+	}
+
+	/*
+	Deletes all programs, the on-disk binaries are kept
+	*/
+	void Clear() {
+		for (auto it = programs.begin(); it != programs.end(); ++it) {
+			if (it->second != 0)
+				glDeleteProgram(it->second);
+		}
+		programs.clear();
+		sources.clear();
+	}
+
+	/*
+	@returns The amount of programs that were compiled from GLSL source
+	*/
+	int GetCompileCount() {
+		return compileCount;
+	}
+
+	/*
+	@returns The amount of programs that were loaded from an on-disk binary
+	*/
+	int GetBinaryLoadCount() {
+		return binaryLoadCount;
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <GL/glew.h>
+
+/*
+Compiles every (vertex shader, fragment shader) pair once and hands out the same program to everyone who asks for it.
+Programs are keyed by a hash of their sources. Linked programs are also stored as driver binaries in the shadercache directory,
+so a warm start loads them with glProgramBinary instead of compiling GLSL. A binary the driver rejects (e.g. after a driver update) is rebuilt from source
+*/
+namespace ShaderCache {
+	// Documented in ShaderCache.cpp
+	GLuint GetProgram(const char* vertexShaderPath, const char* fragmentShaderPath);
+	void Clear();
+	int GetCompileCount();
+	int GetBinaryLoadCount();
+}
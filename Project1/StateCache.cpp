@@ -0,0 +1,162 @@
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "StateCache.h"
+
+namespace StateCache {
+	const GLuint UNKNOWN = (GLuint)-1; // Marks a binding that must be sent to GL because someone else may have changed it
+
+	/*
+	The last value uploaded to a uniform, big enough for a mat4
+	*/
+	struct UniformValue {
+		GLfloat data[16];
+	};
+
+	GLuint program = UNKNOWN; // The bound program
+	GLuint texture = UNKNOWN; // The texture array bound to GL_TEXTURE_2D_ARRAY of texture unit 0
+	GLuint vao = UNKNOWN; // The bound vertex array object
+	std::unordered_map<uint64_t, UniformValue> uniforms; // The uniform values, keyed by program and location
+	Counters counters; // The counters of the current frame
+
+	/*
+	Starts a new frame: zeroes the counters and forgets the bindings, as code outside the renderer may have changed them.
+	Uniform values are kept, they belong to the programs and only change through this cache
+	*/
+	void BeginFrame() {
+		counters = Counters();
+		program = UNKNOWN;
+		texture = UNKNOWN;
+		vao = UNKNOWN;
+	}
+
+	/*
+	Forgets everything, must be called when programs are deleted since GL may hand out their names again
+	*/
+	void Reset() {
+		BeginFrame();
+		uniforms.clear();
+	}
+
+	/*
+	@returns The counters of the current frame
+	*/
+	const Counters& GetCounters() {
+		return counters;
+	}
+
+	/*
+	Binds a program unless it is already bound
+	@param newProgram - The program
+	*/
+	void UseProgram(GLuint newProgram) {
+		if (program == newProgram) {
+			counters.binds_skipped++;
+			return;
+		}
+		glUseProgram(newProgram);
+		program = newProgram;
+		counters.binds++;
+	}
+
+	/*
+	Binds a texture array to texture unit 0 unless it is already bound
+	@param newTexture - The texture array
+	*/
+	void BindTexture(GLuint newTexture) {
+		if (texture == newTexture) {
+			counters.binds_skipped++;
+			return;
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, newTexture);
+		texture = newTexture;
+		counters.binds++;
+	}
+
+	/*
+	Binds a vertex array object unless it is already bound
+	@param newVao - The vertex array object
+	*/
+	void BindVertexArray(GLuint newVao) {
+		if (vao == newVao) {
+			counters.binds_skipped++;
+			return;
+		}
+		glBindVertexArray(newVao);
+		vao = newVao;
+		counters.binds++;
+	}
+
+	/*
+	Remembers a uniform value of the bound program
+	@param location - The uniform location
+	@param value - The new value
+	@param size - The size of the value in bytes
+	@returns If the value differs from the last upload and must be sent to GL
+	*/
+	static bool Changed(GLint location, const void* value, size_t size) {
+		if (location < 0 || program == UNKNOWN)
+			return location >= 0;
+		uint64_t key = ((uint64_t)program << 32) | (uint32_t)location;
+		auto inserted = uniforms.emplace(key, UniformValue());
+		UniformValue& last = inserted.first->second;
+		if (!inserted.second && memcmp(last.data, value, size) == 0) {
+			counters.uniforms_skipped++;
+			return false;
+		}
+		memcpy(last.data, value, size);
+		counters.uniforms++;
+		return true;
+	}
+
+	/*
+	Sets an int (or bool) uniform of the bound program unless it already has the value
+	@param location - The uniform location
+	@param value - The value
+	*/
+	void Uniform1i(GLint location, GLint value) {
+		if (Changed(location, &value, sizeof(value)))
+			glUniform1i(location, value);
+	}
+
+	/*
+	Sets a float uniform of the bound program unless it already has the value
+	@param location - The uniform location
+	@param value - The value
+	*/
+	void Uniform1f(GLint location, GLfloat value) {
+		if (Changed(location, &value, sizeof(value)))
+			glUniform1f(location, value);
+	}
+
+	/*
+	Sets a vec2 uniform of the bound program unless it already has the value
+	@param location - The uniform location
+	@param value - The 2 floats
+	*/
+	void Uniform2fv(GLint location, const GLfloat* value) {
+		if (Changed(location, value, 2 * sizeof(GLfloat)))
+			glUniform2fv(location, 1, value);
+	}
+
+	/*
+	Sets a vec3 uniform of the bound program unless it already has the value
+	@param location - The uniform location
+	@param value - The 3 floats
+	*/
+	void Uniform3fv(GLint location, const GLfloat* value) {
+		if (Changed(location, value, 3 * sizeof(GLfloat)))
+			glUniform3fv(location, 1, value);
+	}
+
+	/*
+	Sets a mat4 uniform of the bound program unless it already has the value
+	@param location - The uniform location
+	@param value - The 16 floats, column major
+	*/
+	void UniformMatrix4fv(GLint location, const GLfloat* value) {
+		if (Changed(location, value, 16 * sizeof(GLfloat)))
+			glUniformMatrix4fv(location, 1, GL_FALSE, value);
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <GL/glew.h>
+
+/*
+Thin shadow of the GL state the renderer touches: the bound program, texture and vao, and the uniform values of every program.
+A bind or uniform upload that would not change anything is skipped and counted, so the debug overlay can show what was saved
+*/
+namespace StateCache {
+	/*
+	The amount of state changes of the current frame
+	*/
+	struct Counters {
+		int binds = 0; // Program, texture and vao binds that were sent to GL
+		int binds_skipped = 0; // Binds that were skipped because the object was already bound
+		int uniforms = 0; // Uniform uploads that were sent to GL
+		int uniforms_skipped = 0; // Uniform uploads that were skipped because the value did not change
+	};
+
+	// Documented in StateCache.cpp
+	void BeginFrame();
+	void Reset();
+	const Counters& GetCounters();
+	void UseProgram(GLuint program);
+	void BindTexture(GLuint texture);
+	void BindVertexArray(GLuint vao);
+	void Uniform1i(GLint location, GLint value);
+	void Uniform1f(GLint location, GLfloat value);
+	void Uniform2fv(GLint location, const GLfloat* value);
+	void Uniform3fv(GLint location, const GLfloat* value);
+	void UniformMatrix4fv(GLint location, const GLfloat* value);
+}
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include "TextureArrays.h"
+#include "BlockCompression.h"
+
+namespace TextureArrays {
+	GLuint name = 0; // The GL texture array, 0 before Init
+	GLenum format = GL_RGBA8; // The internal format of the layers
+	GLuint capacity = 0; // The amount of layers the array has room for
+	GLuint nextLayer = 0; // The first layer that was never handed out
+	std::vector<GLuint> freeLayers; // Layers that were freed, handed out again before new ones
+
+	/*
+	@returns The width and height of a mip level of a layer
+	*/
+	static unsigned int GetLevelWidth(unsigned int level) {
+		return std::max(1u, LAYER_SIZE >> level);
+	}
+
+	/*
+	@returns The size of a mip level of one layer in bytes
+	*/
+	static size_t GetLevelSize(unsigned int level) {
+		unsigned int size = GetLevelWidth(level);
+		if (format == GL_RGBA8)
+			return (size_t)size * size * 4;
+		return BlockCompression::GetCompressedSize(size, size, BlockFormat::BC1);
+	}
+
+	/*
+	Makes an empty array with immutable storage for every mip level of the layers.
+	The filters are those of loadBMP, the TextureSampler overrides them when sampler objects are supported
+	@param layers - The amount of layers
+	@returns The GL name of the array
+	*/
+	static GLuint MakeArray(GLuint layers) {
+		GLuint id;
+		glGenTextures(1, &id);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, GetLevelCount(), format, LAYER_SIZE, LAYER_SIZE, layers);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		return id;
+	}
+
+	/*
+	Fills the placeholder layer with a grey 2x2 checker, every level shows the same checker so it looks the same from any distance
+	*/
+	static void FillPlaceholder() {
+		glBindTexture(GL_TEXTURE_2D_ARRAY, name);
+		for (unsigned int level = 0; level < GetLevelCount(); level++) {
+			unsigned int size = GetLevelWidth(level);
+			unsigned int cell = std::max(1u, size / 2);
+			std::vector<unsigned char> rgba((size_t)size * size * 4);
+			for (unsigned int y = 0; y < size; y++) {
+				for (unsigned int x = 0; x < size; x++) {
+					unsigned char grey = ((x / cell + y / cell) % 2) == 0 ? 96 : 160;
+					unsigned char* pixel = &rgba[((size_t)y * size + x) * 4];
+					pixel[0] = pixel[1] = pixel[2] = grey;
+					pixel[3] = 255;
+				}
+			}
+			if (format == GL_RGBA8) {
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, PLACEHOLDER_LAYER, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+			} else {
+				std::vector<unsigned char> blocks = BlockCompression::Compress(rgba.data(), size, size, BlockFormat::BC1, CompressionQuality::FAST);
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, PLACEHOLDER_LAYER, size, size, 1, format, (GLsizei)blocks.size(), blocks.data());
+			}
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+
+	/*
+	Doubles the capacity of the array, the layers that were handed out are copied on the GPU
+	@returns False if the driver doesn't allow that many layers
+	*/
+	static bool Grow() {
+		GLint maxLayers = 0;
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+		GLuint newCapacity = std::min(capacity * 2, (GLuint)maxLayers);
+		if (newCapacity <= capacity)
+			return false;
+
+		GLuint newName = MakeArray(newCapacity);
+		for (unsigned int level = 0; level < GetLevelCount(); level++) {
+			unsigned int size = GetLevelWidth(level);
+			glCopyImageSubData(name, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, newName, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, size, size, nextLayer);
+		}
+		glDeleteTextures(1, &name);
+		name = newName;
+		capacity = newCapacity;
+		return true;
+	}
+
+	/*
+	Makes the array and its placeholder layer, must be called on the GL thread before any texture is allocated
+	@param compressed - If the layers are BC1 blocks (the driver supports S3TC), otherwise RGBA8
+	*/
+	void Init(bool compressed) {
+		Clear();
+		format = compressed ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_RGBA8;
+		capacity = INITIAL_LAYERS;
+		name = MakeArray(capacity);
+		nextLayer = PLACEHOLDER_LAYER + 1;
+		FillPlaceholder();
+	}
+
+	/*
+	Deletes the array, textures that still exist show nothing until Init is called again
+	*/
+	void Clear() {
+		if (name != 0)
+			glDeleteTextures(1, &name);
+		name = 0;
+		capacity = 0;
+		nextLayer = 0;
+		freeLayers.clear();
+	}
+
+	/*
+	Hands out a layer for a texture, growing the array when it is full.
+	Must be called on the GL thread, growing changes the GL name of the array
+	@returns The layer, or PLACEHOLDER_LAYER if there is no room left
+	*/
+	GLuint Allocate() {
+		if (name == 0)
+			return PLACEHOLDER_LAYER;
+		if (!freeLayers.empty()) {
+			GLuint layer = freeLayers.back();
+			freeLayers.pop_back();
+			return layer;
+		}
+		if (nextLayer == capacity && !Grow()) {
+			printf("The texture array is full at %u layers, the texture keeps the placeholder\n", capacity);
+			return PLACEHOLDER_LAYER;
+		}
+		return nextLayer++;
+	}
+
+	/*
+	Gives a layer back so the next texture can use it
+	@param layer - The layer, PLACEHOLDER_LAYER is ignored
+	*/
+	void Free(GLuint layer) {
+		if (name != 0 && layer != PLACEHOLDER_LAYER && layer < nextLayer)
+			freeLayers.push_back(layer);
+	}
+
+	/*
+	@returns The GL name of the array, bound to GL_TEXTURE_2D_ARRAY by every object
+	*/
+	GLuint GetName() {
+		return name;
+	}
+
+	/*
+	@returns The internal format of the layers, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT or GL_RGBA8
+	*/
+	GLenum GetFormat() {
+		return format;
+	}
+
+	/*
+	@returns The amount of mip levels of a layer, down to 1x1
+	*/
+	unsigned int GetLevelCount() {
+		unsigned int levels = 1;
+		for (unsigned int size = LAYER_SIZE; size > 1; size /= 2)
+			levels++;
+		return levels;
+	}
+
+	/*
+	@returns The amount of layers in use, including the placeholder
+	*/
+	GLuint GetLayerCount() {
+		return nextLayer - (GLuint)freeLayers.size();
+	}
+
+	/*
+	@returns The amount of layers the array has room for
+	*/
+	GLuint GetCapacity() {
+		return capacity;
+	}
+
+	/*
+	@returns The size of the array in video memory in bytes
+	*/
+	size_t GetMemorySize() {
+		size_t size = 0;
+		for (unsigned int level = 0; level < GetLevelCount(); level++)
+			size += GetLevelSize(level);
+		return size * capacity;
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <GL/glew.h>
+
+/*
+Every texture of the scene as a layer of one GL_TEXTURE_2D_ARRAY, so all objects are drawn with a single texture binding.
+The objects pick their layer with a per-instance vertex attribute (VertexAttribute::INSTANCE_LAYER).
+A layer is LAYER_SIZE x LAYER_SIZE with a full mip chain, images of other sizes are resized to it when they are loaded.
+The layers are BC1 blocks when the driver supports S3TC and RGBA8 otherwise.
+Layer 0 holds the grey checker that textures show until their image is resident.
+The array starts with room for INITIAL_LAYERS and doubles when it is full, the names of the layers stay the same but the GL name changes
+*/
+namespace TextureArrays {
+	const unsigned int LAYER_SIZE = 512; // The width and height of a layer, the size of most of the textures in Textures/
+	const GLuint INITIAL_LAYERS = 16; // The amount of layers the array has room for at first
+	const GLuint PLACEHOLDER_LAYER = 0; // The layer with the placeholder checker, also returned by Allocate when the array can't grow
+
+	// Documented in TextureArrays.cpp
+	void Init(bool compressed);
+	void Clear();
+	GLuint Allocate();
+	void Free(GLuint layer);
+	GLuint GetName();
+	GLenum GetFormat();
+	unsigned int GetLevelCount();
+	GLuint GetLayerCount();
+	GLuint GetCapacity();
+	size_t GetMemorySize();
+}
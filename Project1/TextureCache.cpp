@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <GL/glew.h>
+
+#include "TextureCache.h"
+#include "MappedFile.h"
+#include "TextureProcessing.h"
+
+namespace TextureCache {
+	const char MAGIC[4] = { 'C', 'G', 'T', 'C' }; // Identifies a texture cache file among other DDS files
+	const uint32_t VERSION = 2; // Bump whenever the encoder or the mip filter changes its output
+
+	const uint32_t FOURCC_DXT1 = 0x31545844; // "DXT1"
+	const uint32_t FOURCC_DXT5 = 0x35545844; // "DXT5"
+	const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000, DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+
+	/*
+	The stamp stored in the reserved fields of the DDS header, which are only 4 byte aligned so 64 bit values are split in two words
+	*/
+	struct Stamp {
+		char magic[4]; // Always MAGIC
+		uint32_t version; // Always VERSION
+		uint32_t source_size[2]; // The size of the .bmp the cache was made from, low word first
+		uint32_t source_mtime[2]; // The modification time of the .bmp the cache was made from, low word first
+		uint32_t quality; // The CompressionQuality the blocks were encoded with
+		uint32_t reserved[4]; // Fills the rest of the reserved fields
+	};
+
+	/*
+	The DDS header that follows the "DDS " magic, all fields are little endian
+	*/
+	struct Header {
+		uint32_t size; // Always 124
+		uint32_t flags; // Which of the fields below are set
+		uint32_t height, width; // The size of the first level
+		uint32_t linear_size; // The size of the first level in bytes
+		uint32_t depth; // Unused for 2D textures
+		uint32_t mip_map_count; // The amount of levels
+		Stamp stamp; // Stored in the 11 reserved fields
+		uint32_t pixel_format_size; // Always 32
+		uint32_t pixel_format_flags; // Always DDPF_FOURCC
+		uint32_t four_cc; // FOURCC_DXT1 or FOURCC_DXT5
+		uint32_t pixel_format_unused[5]; // The bit masks of uncompressed formats
+		uint32_t caps, caps2, caps3, caps4; // What kind of surface this is
+		uint32_t reserved2;
+	};
+	static_assert(sizeof(Header) == 124, "The DDS header must match the file layout");
+
+	CompressionQuality quality = CompressionQuality::HIGH; // The quality new cache files are made with
+
+	/*
+	Reads the size and modification time of the source image into a stamp
+	@returns False if the source does not exist
+	*/
+	static bool GetSourceStamp(const char* texturePath, Stamp& stamp) {
+		struct stat info;
+		if (stat(texturePath, &info) != 0)
+			return false;
+		uint64_t size = (uint64_t)info.st_size;
+		uint64_t mtime = (uint64_t)info.st_mtime;
+		stamp.source_size[0] = (uint32_t)size;
+		stamp.source_size[1] = (uint32_t)(size >> 32);
+		stamp.source_mtime[0] = (uint32_t)mtime;
+		stamp.source_mtime[1] = (uint32_t)(mtime >> 32);
+		return true;
+	}
+
+	/*
+	@returns The amount of levels of a full mip chain down to 1x1
+	*/
+	static unsigned int CountLevels(unsigned int width, unsigned int height) {
+		unsigned int levels = 1;
+		while (width > 1 || height > 1) {
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+			levels++;
+		}
+		return levels;
+	}
+
+	/*
+	Returns the path of the cache file that belongs to the texture
+	@param texturePath - The path of the .bmp file
+	@returns The path of the cache file
+	*/
+	std::string GetCachePath(const char* texturePath) {
+		return std::string(texturePath) + ".dds";
+	}
+
+	/*
+	Sets the quality that cache files are made with, cache files of another quality are made again.
+	Must be called before the AssetLoader starts loading
+	@param newQuality - The quality
+	*/
+	void SetQuality(CompressionQuality newQuality) {
+		quality = newQuality;
+	}
+
+	/*
+	@param texture - The texture
+	@param level - The mip level
+	@returns The size of the blocks of the level in bytes
+	*/
+	size_t GetLevelSize(const CompressedTexture& texture, unsigned int level) {
+		return BlockCompression::GetCompressedSize(std::max(1u, texture.width >> level), std::max(1u, texture.height >> level), texture.format);
+	}
+
+	/*
+	Loads the texture from its cache file if there is an up to date one
+	@param texturePath - The path of the .bmp file (not the cache file)
+	@param size - The width and height the texture must have, 0 for the size of the image
+	@param texture - The texture to fill
+	@returns True if the texture was loaded from the cache, false if the cache is missing, stale, of another quality or size or corrupt
+	*/
+	bool Load(const char* texturePath, unsigned int size, CompressedTexture& texture) {
+		Stamp source;
+		if (!GetSourceStamp(texturePath, source))
+			return false;
+
+		std::string cachePath = GetCachePath(texturePath);
+		MappedFile file;
+		if (!file.Open(cachePath.c_str()))
+			return false;
+
+		if (file.Size() < 4 + sizeof(Header) || memcmp(file.Data(), "DDS ", 4) != 0)
+			return false;
+		Header header;
+		memcpy(&header, file.Data() + 4, sizeof(Header));
+		const Stamp& stamp = header.stamp;
+		if (header.size != sizeof(Header) || memcmp(stamp.magic, MAGIC, sizeof(MAGIC)) != 0 || stamp.version != VERSION)
+			return false;
+		if (memcmp(stamp.source_size, source.source_size, sizeof(stamp.source_size)) != 0 || memcmp(stamp.source_mtime, source.source_mtime, sizeof(stamp.source_mtime)) != 0)
+			return false;
+		if (stamp.quality != (uint32_t)quality)
+			return false;
+		if (header.four_cc != FOURCC_DXT1 && header.four_cc != FOURCC_DXT5)
+			return false;
+		if (header.width == 0 || header.height == 0 || header.mip_map_count != CountLevels(header.width, header.height))
+			return false;
+		if (size != 0 && (header.width != size || header.height != size))
+			return false;
+
+		texture.width = header.width;
+		texture.height = header.height;
+		texture.levels = header.mip_map_count;
+		texture.format = header.four_cc == FOURCC_DXT1 ? BlockFormat::BC1 : BlockFormat::BC3;
+		size_t dataSize = 0;
+		for (unsigned int level = 0; level < texture.levels; level++)
+			dataSize += GetLevelSize(texture, level);
+		if (4 + sizeof(Header) + dataSize > file.Size())
+			return false;
+
+		printf("Loading texture cache %s...\n", cachePath.c_str());
+		const unsigned char* data = file.Data() + 4 + sizeof(Header);
+		texture.data.assign(data, data + dataSize);
+		return true;
+	}
+
+	/*
+	Reads the .bmp file, compresses it with a full mip chain and writes the cache file.
+	The mip levels are filtered in linear space, with a Kaiser filter for CompressionQuality::HIGH and a box filter for CompressionQuality::FAST.
+	An image of another size is resized with the Kaiser filter first, whatever the quality.
+	Prints the size before and after and the PSNR of the first level, so the loss of every texture can be checked
+	@param texturePath - The path of the .bmp file
+	@param size - The width and height of the texture, 0 keeps the size of the image
+	@param texture - The texture to fill
+	@returns True if the image could be read, the cache file may still have failed to write
+	*/
+	bool Compress(const char* texturePath, unsigned int size, CompressedTexture& texture) {
+		unsigned int width, height;
+		std::vector<unsigned char> rgba;
+		if (!TextureProcessing::LoadBMP(texturePath, width, height, rgba))
+			return false;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		size_t sourceBytes = (size_t)width * height * 3;
+		if (size != 0 && (width != size || height != size)) {
+			printf("Resizing %s from %ux%u to %ux%u\n", texturePath, width, height, size, size);
+			rgba = TextureProcessing::Resize(rgba.data(), width, height, size, size, MipFilter::KAISER);
+			width = height = size;
+		}
+		MipFilter filter = quality == CompressionQuality::HIGH ? MipFilter::KAISER : MipFilter::BOX;
+		std::vector<std::vector<unsigned char>> levels = TextureProcessing::BuildMipChain(std::move(rgba), width, height, filter);
+
+		// 24-bit images have no alpha, so they always fit BC1
+		texture.width = width;
+		texture.height = height;
+		texture.levels = (unsigned int)levels.size();
+		texture.format = BlockFormat::BC1;
+		texture.data.clear();
+		double psnr = 0;
+		for (unsigned int level = 0; level < texture.levels; level++) {
+			unsigned int levelWidth = std::max(1u, width >> level), levelHeight = std::max(1u, height >> level);
+			std::vector<unsigned char> blocks = BlockCompression::Compress(levels[level].data(), levelWidth, levelHeight, texture.format, quality);
+			if (level == 0) {
+				std::vector<unsigned char> decoded = BlockCompression::Decompress(blocks.data(), width, height, texture.format);
+				psnr = BlockCompression::ComputePSNR(levels[0].data(), decoded.data(), (size_t)width * height);
+			}
+			texture.data.insert(texture.data.end(), blocks.begin(), blocks.end());
+		}
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("Compressed %s to BC1 with %u %s filtered levels (%s quality) in %.0f ms: %zu KB -> %zu KB, PSNR %.2f dB\n", texturePath, texture.levels,
+			filter == MipFilter::KAISER ? "Kaiser" : "box", quality == CompressionQuality::HIGH ? "high" : "fast", ms, sourceBytes / 1024, texture.data.size() / 1024, psnr);
+		Write(texturePath, texture);
+		return true;
+	}
+
+	/*
+	Writes the texture to the cache file of the image.
+	The file is written to a temporary path first and then renamed, so a crash never leaves a half written cache behind
+	@param texturePath - The path of the .bmp file (not the cache file)
+	@param texture - The compressed texture
+	@returns True if the cache file was written
+	*/
+	bool Write(const char* texturePath, const CompressedTexture& texture) {
+		Header header;
+		memset(&header, 0, sizeof(Header));
+		Stamp& stamp = header.stamp;
+		if (!GetSourceStamp(texturePath, stamp))
+			return false;
+
+		memcpy(stamp.magic, MAGIC, sizeof(MAGIC));
+		stamp.version = VERSION;
+		stamp.quality = (uint32_t)quality;
+		header.size = sizeof(Header);
+		header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+		header.height = texture.height;
+		header.width = texture.width;
+		header.linear_size = (uint32_t)GetLevelSize(texture, 0);
+		header.mip_map_count = texture.levels;
+		header.pixel_format_size = 32;
+		header.pixel_format_flags = DDPF_FOURCC;
+		header.four_cc = texture.format == BlockFormat::BC1 ? FOURCC_DXT1 : FOURCC_DXT5;
+		header.caps = DDSCAPS_TEXTURE | (texture.levels > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+		std::string cachePath = GetCachePath(texturePath);
+		std::string tempPath = cachePath + ".tmp";
+		FILE* file = fopen(tempPath.c_str(), "wb");
+		if (file == nullptr) {
+			printf("Could not write texture cache %s\n", cachePath.c_str());
+			return false;
+		}
+
+		bool ok = fwrite("DDS ", 1, 4, file) == 4 && fwrite(&header, sizeof(Header), 1, file) == 1;
+		if (ok && !texture.data.empty())
+			ok = fwrite(texture.data.data(), 1, texture.data.size(), file) == texture.data.size();
+		ok = fclose(file) == 0 && ok;
+
+		if (ok) {
+			remove(cachePath.c_str());
+			ok = rename(tempPath.c_str(), cachePath.c_str()) == 0;
+		}
+		if (!ok) {
+			remove(tempPath.c_str());
+			printf("Could not write texture cache %s\n", cachePath.c_str());
+		}
+		return ok;
+	}
+}
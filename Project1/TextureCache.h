@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+
+/*
+A block compressed image with all of its mip levels
+*/
+struct CompressedTexture {
+	unsigned int width = 0, height = 0; // The size of the first level
+	unsigned int levels = 0; // The amount of mip levels, down to 1x1
+	BlockFormat format = BlockFormat::BC1; // The format of the blocks
+	std::vector<unsigned char> data; // The blocks of every level, largest level first
+};
+
+/*
+A block compressed copy of a texture that sits next to the .bmp it was made from (e.g. Textures/wood.bmp.dds).
+The file is a regular DDS that loadDDS can read as well, with the size and modification time of the source and the quality stored in the reserved header fields.
+Rows are kept bottom-up like in the BMP, so the UVs of the models don't change.
+The image may be resized before it is compressed (to the layer size of the TextureArrays), a cache of another size is made again
+*/
+namespace TextureCache {
+	// Documented in TextureCache.cpp
+	std::string GetCachePath(const char* texturePath);
+	void SetQuality(CompressionQuality quality);
+	bool Load(const char* texturePath, unsigned int size, CompressedTexture& texture);
+	bool Compress(const char* texturePath, unsigned int size, CompressedTexture& texture);
+	bool Write(const char* texturePath, const CompressedTexture& texture);
+	size_t GetLevelSize(const CompressedTexture& texture, unsigned int level);
+}
@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <GL/glew.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_PROCESSING_SSE
+#endif
+
+#include "TextureProcessing.h"
+#include "JobSystem.h"
+#include "texture.h"
+
+namespace TextureProcessing {
+	const size_t GRAIN = 16; // The amount of rows per job, small enough that the frame never waits long for a chunk it picked up
+	const double KAISER_RADIUS = 3.0; // The half width of the Kaiser filter, in pixels of the smaller image
+	const double KAISER_BETA = 4.0; // The shape of the Kaiser window, higher trades sharpness for less ringing
+	const double PI = 3.141592653589793;
+
+	/*
+	Lookup tables for the sRGB transfer function
+	*/
+	struct SRGBTables {
+		float toLinear[256]; // The linear value of every 8 bit sRGB value
+		float thresholds[255]; // The linear value halfway between two sRGB values, in sRGB space
+
+		SRGBTables() {
+			for (int i = 0; i < 256; i++)
+				toLinear[i] = (float)ToLinear(i / 255.0);
+			for (int i = 0; i < 255; i++)
+				thresholds[i] = (float)ToLinear((i + 0.5) / 255.0);
+		}
+
+		static double ToLinear(double c) {
+			return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+		}
+	};
+
+	/*
+	@returns The sRGB tables, made on first use (thread safe since C++11)
+	*/
+	static const SRGBTables& GetTables() {
+		static SRGBTables tables;
+		return tables;
+	}
+
+	/*
+	@returns The 8 bit sRGB value closest to the linear value
+	*/
+	static unsigned char ToSRGB(const SRGBTables& tables, float linear) {
+		return (unsigned char)(std::upper_bound(tables.thresholds, tables.thresholds + 255, linear) - tables.thresholds);
+	}
+
+	/*
+	The source pixels and weights of every pixel of a smaller level, along one axis
+	*/
+	struct FilterTaps {
+		int count = 0; // The amount of taps per pixel
+		std::vector<int> index; // The source pixel of every tap, count per pixel
+		std::vector<float> weight; // The weight of every tap, they add up to 1 per pixel
+	};
+
+	/*
+	The zeroth order modified Bessel function of the first kind, for the Kaiser window
+	*/
+	static double BesselI0(double x) {
+		double sum = 1, term = 1;
+		for (int k = 1; k < 32; k++) {
+			term *= (x / (2 * k)) * (x / (2 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	/*
+	@returns The Kaiser windowed sinc at x, in pixels of the filter
+	*/
+	static double Kaiser(double x) {
+		if (std::fabs(x) >= KAISER_RADIUS)
+			return 0;
+		double t = x / KAISER_RADIUS;
+		double sinc = x == 0 ? 1 : std::sin(PI * x) / (PI * x);
+		return sinc * BesselI0(KAISER_BETA * std::sqrt(1 - t * t)) / BesselI0(KAISER_BETA);
+	}
+
+	/*
+	Makes the taps to resize one axis.
+	The box filter only halves, it repeats the last pixel for odd sizes. The Kaiser filter wraps around since the textures repeat,
+	when enlarging it stays as wide as a source pixel so it interpolates instead of skipping pixels
+	@param size - The size of the axis
+	@param newSize - The size of the axis in the resized image
+	*/
+	static FilterTaps MakeTaps(unsigned int size, unsigned int newSize, MipFilter filter) {
+		FilterTaps taps;
+		if (filter == MipFilter::BOX) {
+			taps.count = 2;
+			for (unsigned int i = 0; i < newSize; i++) {
+				taps.index.push_back(std::min(i * 2, size - 1));
+				taps.index.push_back(std::min(i * 2 + 1, size - 1));
+				taps.weight.push_back(0.5f);
+				taps.weight.push_back(0.5f);
+			}
+			return taps;
+		}
+
+		double scale = (double)size / newSize;
+		double width = std::max(scale, 1.0); // The size of a pixel of the filter, in source pixels
+		double radius = KAISER_RADIUS * width;
+		taps.count = (int)std::ceil(radius * 2) + 1;
+		for (unsigned int i = 0; i < newSize; i++) {
+			double center = (i + 0.5) * scale;
+			int first = (int)std::floor(center - radius);
+			double sum = 0;
+			size_t start = taps.weight.size();
+			for (int k = 0; k < taps.count; k++) {
+				int j = first + k;
+				double weight = Kaiser(((j + 0.5) - center) / width);
+				taps.index.push_back((int)(((j % (int)size) + size) % size));
+				taps.weight.push_back((float)weight);
+				sum += weight;
+			}
+			for (size_t k = start; k < taps.weight.size(); k++)
+				taps.weight[k] = (float)(taps.weight[k] / sum);
+		}
+		return taps;
+	}
+
+	/*
+	Adds up weighted RGBA pixels
+	@param base - The first pixel
+	@param stride - The distance between two pixels in floats
+	@param index - The pixels to add, in strides from base
+	@param weight - The weight of every pixel
+	@param count - The amount of pixels
+	@param out - Set to the weighted sum
+	*/
+	static void WeightedSum(const float* base, size_t stride, const int* index, const float* weight, int count, float* out) {
+#ifdef TEXTURE_PROCESSING_SSE
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < count; k++)
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(base + index[k] * stride)));
+		_mm_storeu_ps(out, sum);
+#else
+		float sum[4] = {};
+		for (int k = 0; k < count; k++) {
+			const float* pixel = base + index[k] * stride;
+			for (int c = 0; c < 4; c++)
+				sum[c] += weight[k] * pixel[c];
+		}
+		memcpy(out, sum, sizeof(sum));
+#endif
+	}
+
+	/*
+	Swizzles the rows of a BMP to RGBA, the rows stay bottom-up as GL expects
+	@param bgr - The BGR rows, height * rowBytes bytes
+	@param width - The width of the image
+	@param height - The height of the image
+	@param rowBytes - The size of a row including its padding
+	@param rgba - Set to the RGBA pixels, width * height * 4 bytes
+	*/
+	void ConvertBGRToRGBA(const unsigned char* bgr, unsigned int width, unsigned int height, size_t rowBytes, unsigned char* rgba) {
+		JobSystem::ParallelFor(height, GRAIN, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				const unsigned char* row = bgr + y * rowBytes;
+				unsigned char* out = rgba + y * width * 4;
+				unsigned int x = 0;
+#ifdef TEXTURE_PROCESSING_SSE
+				// Four pixels per load, the load reads 4 bytes past them so it stops 16 bytes before the end of the image
+				size_t available = (height - y) * rowBytes;
+				const __m128i low = _mm_set1_epi32(0xFF);
+				const __m128i green = _mm_set1_epi32(0xFF00);
+				const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+				for (; x + 4 <= width && x * 3 + 16 <= available; x += 4) {
+					__m128i v = _mm_loadu_si128((const __m128i*)(row + x * 3));
+					__m128i p01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+					__m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+					__m128i bgrx = _mm_unpacklo_epi64(p01, p23);
+					__m128i r = _mm_and_si128(_mm_srli_epi32(bgrx, 16), low);
+					__m128i b = _mm_slli_epi32(_mm_and_si128(bgrx, low), 16);
+					__m128i pixels = _mm_or_si128(_mm_or_si128(r, _mm_and_si128(bgrx, green)), _mm_or_si128(b, alpha));
+					_mm_storeu_si128((__m128i*)(out + x * 4), pixels);
+				}
+#endif
+				// The rest of the row, or all of it without SSE
+				for (; x < width; x++) {
+					out[x * 4] = row[x * 3 + 2];
+					out[x * 4 + 1] = row[x * 3 + 1];
+					out[x * 4 + 2] = row[x * 3];
+					out[x * 4 + 3] = 255;
+				}
+			}
+		});
+	}
+
+	/*
+	Resizes an image. The colours are filtered in linear space so the result is as bright as the image it came from,
+	alpha is filtered as is
+	@param rgba - The pixels
+	@param width - The width of the image
+	@param height - The height of the image
+	@param newWidth - The width of the result
+	@param newHeight - The height of the result
+	@param filter - The filter, MipFilter::BOX can only halve
+	@returns The RGBA pixels of the result
+	*/
+	std::vector<unsigned char> Resize(const unsigned char* rgba, unsigned int width, unsigned int height, unsigned int newWidth, unsigned int newHeight, MipFilter filter) {
+		const SRGBTables& tables = GetTables();
+		FilterTaps columns = MakeTaps(width, newWidth, filter);
+		FilterTaps rows = MakeTaps(height, newHeight, filter);
+
+		std::vector<float> linear((size_t)width * height * 4);
+		JobSystem::ParallelFor(height, GRAIN, [&](size_t begin, size_t end) {
+			for (size_t i = begin * width * 4; i < end * width * 4; i += 4) {
+				for (int c = 0; c < 3; c++)
+					linear[i + c] = tables.toLinear[rgba[i + c]];
+				linear[i + 3] = rgba[i + 3] / 255.0f;
+			}
+		});
+
+		// Separable: first the rows are resized, then the columns
+		std::vector<float> narrow((size_t)newWidth * height * 4);
+		JobSystem::ParallelFor(height, GRAIN, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				for (unsigned int x = 0; x < newWidth; x++) {
+					size_t tap = (size_t)x * columns.count;
+					WeightedSum(&linear[y * width * 4], 4, &columns.index[tap], &columns.weight[tap], columns.count, &narrow[(y * newWidth + x) * 4]);
+				}
+			}
+		});
+
+		std::vector<unsigned char> resized((size_t)newWidth * newHeight * 4);
+		JobSystem::ParallelFor(newHeight, GRAIN, [&](size_t begin, size_t end) {
+			float pixel[4];
+			for (size_t y = begin; y < end; y++) {
+				size_t tap = y * rows.count;
+				for (unsigned int x = 0; x < newWidth; x++) {
+					WeightedSum(&narrow[(size_t)x * 4], (size_t)newWidth * 4, &rows.index[tap], &rows.weight[tap], rows.count, pixel);
+					unsigned char* out = &resized[(y * newWidth + x) * 4];
+					for (int c = 0; c < 3; c++)
+						out[c] = ToSRGB(tables, pixel[c]);
+					out[3] = (unsigned char)std::min(std::max(pixel[3] * 255.0f + 0.5f, 0.0f), 255.0f);
+				}
+			}
+		});
+		return resized;
+	}
+
+	/*
+	Makes the next mip level of an image
+	@param rgba - The pixels
+	@param width - The width of the image
+	@param height - The height of the image
+	@param filter - The filter
+	@returns The RGBA pixels of the level, half the size of the image (at least 1)
+	*/
+	std::vector<unsigned char> Downsample(const unsigned char* rgba, unsigned int width, unsigned int height, MipFilter filter) {
+		return Resize(rgba, width, height, std::max(1u, width / 2), std::max(1u, height / 2), filter);
+	}
+
+	/*
+	Makes every mip level of an image down to 1x1
+	@param rgba - The pixels of the image, they become the first level
+	@param width - The width of the image
+	@param height - The height of the image
+	@param filter - The filter
+	@returns The RGBA pixels of every level, largest first
+	*/
+	std::vector<std::vector<unsigned char>> BuildMipChain(std::vector<unsigned char> rgba, unsigned int width, unsigned int height, MipFilter filter) {
+		std::vector<std::vector<unsigned char>> levels;
+		levels.push_back(std::move(rgba));
+		while (width > 1 || height > 1) {
+			levels.push_back(Downsample(levels.back().data(), width, height, filter));
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+		}
+		return levels;
+	}
+
+	/*
+	Reads a .bmp file as RGBA, bottom-up like GL expects
+	@param imagePath - The path of the .bmp file
+	@param width - Set to the width of the image
+	@param height - Set to the height of the image
+	@param rgba - Set to the pixels
+	@returns True if the image could be read
+	*/
+	bool LoadBMP(const char* imagePath, unsigned int& width, unsigned int& height, std::vector<unsigned char>& rgba) {
+		std::vector<unsigned char> bgr;
+		if (!readBMP(imagePath, width, height, bgr) || width == 0 || height == 0)
+			return false;
+		// The rows are padded to 4 bytes, files that are too short are padded with black
+		size_t rowBytes = ((size_t)width * 3 + 3) & ~(size_t)3;
+		if (bgr.size() < rowBytes * height)
+			bgr.resize(rowBytes * height, 0);
+		rgba.resize((size_t)width * height * 4);
+		ConvertBGRToRGBA(bgr.data(), width, height, rowBytes, rgba.data());
+		return true;
+	}
+}
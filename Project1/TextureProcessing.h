@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/*
+The filter used to make every mip level from the one above it
+*/
+enum class MipFilter {
+	BOX, // The average of every 2x2 square
+	KAISER, // A Kaiser windowed sinc, keeps more detail without ringing much
+};
+
+/*
+The CPU side of turning an image file into texture levels, without touching GL.
+The pixel loops use SSE2 when available and are split over the JobSystem by rows
+*/
+namespace TextureProcessing {
+	// Documented in TextureProcessing.cpp
+	void ConvertBGRToRGBA(const unsigned char* bgr, unsigned int width, unsigned int height, size_t rowBytes, unsigned char* rgba);
+	std::vector<unsigned char> Resize(const unsigned char* rgba, unsigned int width, unsigned int height, unsigned int newWidth, unsigned int newHeight, MipFilter filter);
+	std::vector<unsigned char> Downsample(const unsigned char* rgba, unsigned int width, unsigned int height, MipFilter filter);
+	std::vector<std::vector<unsigned char>> BuildMipChain(std::vector<unsigned char> rgba, unsigned int width, unsigned int height, MipFilter filter);
+	bool LoadBMP(const char* imagePath, unsigned int& width, unsigned int& height, std::vector<unsigned char>& rgba);
+}
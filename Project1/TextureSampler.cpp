@@ -0,0 +1,93 @@
+#include <algorithm>
+
+#include "TextureSampler.h"
+
+namespace TextureSampler {
+	const float MAX_ANISOTROPY = 16.0f; // The most samples the anisotropic filter takes, if the driver allows it
+
+	GLuint samplers[(int)TextureFilter::COUNT] = {}; // The sampler of every filter, 0 without sampler object support
+	TextureFilter current = TextureFilter::TRILINEAR; // The filter that is bound
+	float anisotropy = 1.0f; // The anisotropy of TextureFilter::ANISOTROPIC, 1 if the driver doesn't support it
+
+	/*
+	Makes the samplers, must be called once GL is initialised
+	*/
+	void Init() {
+		Clear();
+		if (!glewIsSupported("GL_ARB_sampler_objects"))
+			return;
+		if (glewIsSupported("GL_EXT_texture_filter_anisotropic")) {
+			glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &anisotropy);
+			anisotropy = std::min(anisotropy, MAX_ANISOTROPY);
+		}
+
+		const GLint minFilters[(int)TextureFilter::COUNT] = { GL_NEAREST, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR_MIPMAP_LINEAR };
+		const GLint magFilters[(int)TextureFilter::COUNT] = { GL_NEAREST, GL_LINEAR, GL_LINEAR, GL_LINEAR };
+		glGenSamplers((GLsizei)TextureFilter::COUNT, samplers);
+		for (int i = 0; i < (int)TextureFilter::COUNT; i++) {
+			glSamplerParameteri(samplers[i], GL_TEXTURE_MIN_FILTER, minFilters[i]);
+			glSamplerParameteri(samplers[i], GL_TEXTURE_MAG_FILTER, magFilters[i]);
+			glSamplerParameteri(samplers[i], GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glSamplerParameteri(samplers[i], GL_TEXTURE_WRAP_T, GL_REPEAT);
+		}
+		if (anisotropy > 1.0f)
+			glSamplerParameterf(samplers[(int)TextureFilter::ANISOTROPIC], GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+		Bind(TextureFilter::ANISOTROPIC);
+	}
+
+	/*
+	Deletes the samplers, textures fall back to their own parameters
+	*/
+	void Clear() {
+		if (samplers[0] != 0) {
+			glBindSampler(0, 0);
+			glDeleteSamplers((GLsizei)TextureFilter::COUNT, samplers);
+		}
+		std::fill(samplers, samplers + (int)TextureFilter::COUNT, 0);
+		current = TextureFilter::TRILINEAR;
+		anisotropy = 1.0f;
+	}
+
+	/*
+	Samples every texture on unit 0 with the given filter from now on
+	@param filter - The filter, ignored without sampler object support
+	*/
+	void Bind(TextureFilter filter) {
+		if (samplers[0] == 0)
+			return;
+		current = filter;
+		glBindSampler(0, samplers[(int)filter]);
+	}
+
+	/*
+	@returns The filter textures are sampled with
+	*/
+	TextureFilter GetFilter() {
+		return current;
+	}
+
+	/*
+	@returns The name of the filter, for the debug overlay
+	*/
+	const char* GetName(TextureFilter filter) {
+		switch (filter) {
+		case TextureFilter::NEAREST:
+			return "nearest";
+		case TextureFilter::BILINEAR:
+			return "bilinear";
+		case TextureFilter::TRILINEAR:
+			return "trilinear";
+		case TextureFilter::ANISOTROPIC:
+			return "anisotropic";
+		default:
+			return "unknown";
+		}
+	}
+
+	/*
+	@returns The anisotropy of TextureFilter::ANISOTROPIC, 1 if the driver doesn't support anisotropic filtering
+	*/
+	float GetMaxAnisotropy() {
+		return anisotropy;
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <GL/glew.h>
+
+/*
+The ways textures can be sampled, from cheapest to best looking
+*/
+enum class TextureFilter {
+	NEAREST, // The closest texel of the full size image, what the textures used before they had mipmaps
+	BILINEAR, // Blends 4 texels of the full size image
+	TRILINEAR, // Blends between the two closest mip levels
+	ANISOTROPIC, // Trilinear with extra samples along the direction the surface is stretched in
+	COUNT
+};
+
+/*
+One sampler object per TextureFilter, bound to texture unit 0 so every texture is sampled the same way without touching its own parameters.
+Without sampler object support the textures keep their own trilinear parameters and the filter can't be changed
+*/
+namespace TextureSampler {
+	// Documented in TextureSampler.cpp
+	void Init();
+	void Clear();
+	void Bind(TextureFilter filter);
+	TextureFilter GetFilter();
+	const char* GetName(TextureFilter filter);
+	float GetMaxAnisotropy();
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <cstring>
+#include <vector>
+
+#include "UniformBuffers.h"
+
+namespace UniformBuffers {
+	GLuint frameBuffer = 0; // The buffer behind FrameData
+	GLuint materialBuffer = 0; // The buffer behind MaterialData
+	std::vector<const Material*> materials; // The registered materials, in block order
+	std::vector<const LightSource*> lights; // The registered lights, in block order
+	MaterialBlock materialBlock; // The material data as last uploaded
+	bool materialsUploaded = false; // If materialBlock was uploaded at least once
+
+	/*
+	Returns the index of a pointer in a registry, adding it if it is new
+	@returns The index, the first entry if the registry is full
+	*/
+	template <typename T>
+	static int Register(std::vector<const T*>& registry, const T* value, int max, const char* what) {
+		for (size_t i = 0; i < registry.size(); i++) {
+			if (registry[i] == value)
+				return (int)i;
+		}
+		if ((int)registry.size() == max) {
+			printf("Too many %s, the uniform block has room for %d\n", what, max);
+			return 0;
+		}
+		registry.push_back(value);
+		return (int)registry.size() - 1;
+	}
+
+	/*
+	Makes the buffers and binds them to their binding points, the first time a block is used
+	*/
+	static void InitBuffers() {
+		if (frameBuffer != 0)
+			return;
+		glGenBuffers(1, &frameBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), nullptr, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, frameBuffer);
+
+		glGenBuffers(1, &materialBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialBlock), nullptr, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BINDING, materialBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	/*
+	Adds a material to the MaterialData block
+	@param material - The material, must stay alive until Clear
+	@returns The index of the material in the block, what the object sends as material_index
+	*/
+	int RegisterMaterial(const Material* material) {
+		return Register(materials, material, MAX_MATERIALS, "materials");
+	}
+
+	/*
+	Adds a light to the FrameData block
+	@param light - The light, must stay alive until Clear
+	@returns The index of the light in the block, what the object sends as light_index
+	*/
+	int RegisterLight(const LightSource* light) {
+		return Register(lights, light, MAX_LIGHTS, "lights");
+	}
+
+	/*
+	Writes the FrameData block, once per frame before anything is drawn.
+	The materials are read back from their registered pointers and only uploaded when one of them changed
+	@param view - The view matrix
+	@param projection - The projection matrix
+	*/
+	void UpdateFrame(const glm::mat4* view, const glm::mat4* projection) {
+		InitBuffers();
+
+		FrameBlock frame{};
+		frame.view = *view;
+		frame.projection = *projection;
+		for (size_t i = 0; i < lights.size(); i++)
+			frame.light_pos[i] = glm::vec4(lights[i]->position, 1.0f);
+		glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+
+		MaterialBlock block{}; // Value initialised, the unused entries are compared with memcmp
+		for (size_t i = 0; i < materials.size(); i++) {
+			block.materials[i].ambient = glm::vec4(materials[i]->ambient_colour, 0.0f);
+			block.materials[i].diffuse = glm::vec4(materials[i]->diffuse_colour, 0.0f);
+			block.materials[i].specular = glm::vec4(materials[i]->specular, materials[i]->power);
+		}
+		if (!materialsUploaded || memcmp(&block, &materialBlock, sizeof(block)) != 0) {
+			materialBlock = block;
+			materialsUploaded = true;
+			glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	/*
+	Deletes the buffers and forgets the registered materials and lights
+	*/
+	void Clear() {
+		if (frameBuffer != 0) {
+			glDeleteBuffers(1, &frameBuffer);
+			glDeleteBuffers(1, &materialBuffer);
+		}
+		frameBuffer = 0;
+		materialBuffer = 0;
+		materials.clear();
+		lights.clear();
+		materialsUploaded = false;
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Material.h"
+#include "LightSource.h"
+
+/*
+The std140 uniform blocks shared by all programs.
+FrameData (binding 0) holds what is the same for every draw of a frame: view, projection and the light positions.
+MaterialData (binding 1) holds every material in use, a draw only selects its entry with material_index.
+The layouts must match the blocks in vertexshader.vert and the fragment shaders
+*/
+namespace UniformBuffers {
+	const GLuint FRAME_BINDING = 0; // The binding point of the FrameData block
+	const GLuint MATERIAL_BINDING = 1; // The binding point of the MaterialData block
+	const int MAX_LIGHTS = 8; // The length of the light array, MAX_LIGHTS in vertexshader.vert
+	const int MAX_MATERIALS = 16; // The length of the material array, MAX_MATERIALS in the fragment shaders
+
+	/*
+	The FrameData block in std140 layout, vec3s are padded to vec4
+	*/
+	struct FrameBlock {
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec4 light_pos[MAX_LIGHTS];
+	};
+
+	/*
+	A Material in std140 layout, the specular power is stored in specular.w
+	*/
+	struct MaterialEntry {
+		glm::vec4 ambient;
+		glm::vec4 diffuse;
+		glm::vec4 specular;
+	};
+
+	/*
+	The MaterialData block in std140 layout
+	*/
+	struct MaterialBlock {
+		MaterialEntry materials[MAX_MATERIALS];
+	};
+
+	static_assert(sizeof(FrameBlock) == 2 * 64 + MAX_LIGHTS * 16, "FrameBlock must match the std140 layout of FrameData");
+	static_assert(sizeof(MaterialBlock) == MAX_MATERIALS * 48, "MaterialBlock must match the std140 layout of MaterialData");
+
+	// Documented in UniformBuffers.cpp
+	int RegisterMaterial(const Material* material);
+	int RegisterLight(const LightSource* light);
+	void UpdateFrame(const glm::mat4* view, const glm::mat4* projection);
+	void Clear();
+}
@@ -0,0 +1,179 @@
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#include "VertexFormat.h"
+#include "Mesh.h"
+
+namespace VertexPacking {
+	/*
+	The vertex of the FLOAT format
+	*/
+	struct FloatVertex {
+		GLfloat position[3];
+		GLfloat normal[3];
+		GLfloat uv[2];
+	};
+
+	/*
+	The vertex of the COMPACT format
+	*/
+	struct CompactVertex {
+		GLushort position[4]; // The 4th component is padding
+		GLshort normal[2];
+		GLushort uv[2];
+	};
+
+	/*
+	Quantizes a value in the 0-1 range to an unsigned normalized 16-bit integer
+	*/
+	static GLushort ToUnorm16(float value) {
+		if (!(value > 0.0f))
+			return 0;
+		if (value >= 1.0f)
+			return 65535;
+		return (GLushort)std::lround(value * 65535.0f);
+	}
+
+	/*
+	Quantizes a value in the -1 to 1 range to a signed normalized 16-bit integer
+	*/
+	static GLshort ToSnorm16(float value) {
+		if (value <= -1.0f)
+			return -32767;
+		if (value >= 1.0f)
+			return 32767;
+		return (GLshort)std::lround(value * 32767.0f);
+	}
+
+	/*
+	Returns 1 for positive numbers and zero, -1 for negative numbers
+	*/
+	static float SignNotZero(float value) {
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	/*
+	Encodes a unit normal onto the octahedron and stores it as 2 signed normalized 16-bit integers
+	@param normal - The normal to encode, does not need to be normalised
+	@param out - The 2 encoded components
+	*/
+	void OctEncode(const glm::vec3& normal, GLshort out[2]) {
+		float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+		if (l1 == 0.0f) {
+			out[0] = out[1] = 0;
+			return;
+		}
+		float x = normal.x / l1, y = normal.y / l1;
+		if (normal.z < 0.0f) {
+			float folded_x = (1.0f - std::fabs(y)) * SignNotZero(x);
+			float folded_y = (1.0f - std::fabs(x)) * SignNotZero(y);
+			x = folded_x;
+			y = folded_y;
+		}
+		out[0] = ToSnorm16(x);
+		out[1] = ToSnorm16(y);
+	}
+
+	/*
+	Decodes an octahedral encoded normal, the same way vertexshader.vert does
+	@param in - The 2 encoded components
+	@returns The unit normal
+	*/
+	glm::vec3 OctDecode(const GLshort in[2]) {
+		glm::vec3 n(std::fmax(in[0] / 32767.0f, -1.0f), std::fmax(in[1] / 32767.0f, -1.0f), 0.0f);
+		n.z = 1.0f - std::fabs(n.x) - std::fabs(n.y);
+		float t = std::fmax(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+		return glm::normalize(n);
+	}
+
+	/*
+	Packs the geometry of a mesh into one interleaved vertex buffer in the given format
+	@param mesh - The mesh to pack, its bounds must be calculated
+	@param format - The vertex format to pack into
+	@param out - The packed vertices
+	*/
+	void Pack(const MeshData& mesh, VertexFormat format, PackedVertices& out) {
+		size_t count = mesh.vertices.size();
+		if (format == VertexFormat::FLOAT) {
+			out.stride = sizeof(FloatVertex);
+			out.position_offset = glm::vec3(0.0f);
+			out.position_scale = glm::vec3(1.0f);
+			out.uv_offset = glm::vec2(0.0f);
+			out.uv_scale = glm::vec2(1.0f);
+			out.oct_normals = false;
+			out.data.resize(count * sizeof(FloatVertex));
+			FloatVertex* vertices = (FloatVertex*)out.data.data();
+			for (size_t i = 0; i < count; i++) {
+				memcpy(vertices[i].position, &mesh.vertices[i], sizeof(vertices[i].position));
+				memcpy(vertices[i].normal, &mesh.normals[i], sizeof(vertices[i].normal));
+				memcpy(vertices[i].uv, &mesh.uvs[i], sizeof(vertices[i].uv));
+			}
+			return;
+		}
+
+		glm::vec2 uv_min(0.0f), uv_max(0.0f);
+		if (count > 0) {
+			uv_min = uv_max = mesh.uvs[0];
+			for (size_t i = 1; i < count; i++) {
+				uv_min = glm::min(uv_min, mesh.uvs[i]);
+				uv_max = glm::max(uv_max, mesh.uvs[i]);
+			}
+		}
+		out.stride = sizeof(CompactVertex);
+		out.position_offset = mesh.bounds_min;
+		out.position_scale = mesh.bounds_max - mesh.bounds_min;
+		out.uv_offset = uv_min;
+		out.uv_scale = uv_max - uv_min;
+		out.oct_normals = true;
+
+		// An axis without any extent (e.g. the flat ground) quantizes to 0
+		glm::vec3 position_inverse;
+		for (int a = 0; a < 3; a++)
+			position_inverse[a] = out.position_scale[a] > 0.0f ? 1.0f / out.position_scale[a] : 0.0f;
+		glm::vec2 uv_inverse;
+		for (int a = 0; a < 2; a++)
+			uv_inverse[a] = out.uv_scale[a] > 0.0f ? 1.0f / out.uv_scale[a] : 0.0f;
+
+		out.data.resize(count * sizeof(CompactVertex));
+		CompactVertex* vertices = (CompactVertex*)out.data.data();
+		for (size_t i = 0; i < count; i++) {
+			glm::vec3 p = (mesh.vertices[i] - out.position_offset) * position_inverse;
+			vertices[i].position[0] = ToUnorm16(p.x);
+			vertices[i].position[1] = ToUnorm16(p.y);
+			vertices[i].position[2] = ToUnorm16(p.z);
+			vertices[i].position[3] = 0;
+			OctEncode(mesh.normals[i], vertices[i].normal);
+			glm::vec2 uv = (mesh.uvs[i] - out.uv_offset) * uv_inverse;
+			vertices[i].uv[0] = ToUnorm16(uv.x);
+			vertices[i].uv[1] = ToUnorm16(uv.y);
+		}
+	}
+
+	/*
+	Describes the interleaved vertex buffer to the currently bound vao, using the VertexAttribute locations.
+	The vertex buffer must be bound to GL_ARRAY_BUFFER
+	@param format - The format the buffer was packed in
+	*/
+	void SetupAttributes(VertexFormat format) {
+		const GLuint position_id = VertexAttribute::POSITION;
+		const GLuint normal_id = VertexAttribute::NORMAL;
+		const GLuint uv_id = VertexAttribute::UV;
+		if (format == VertexFormat::FLOAT) {
+			GLsizei stride = sizeof(FloatVertex);
+			glVertexAttribPointer(position_id, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FloatVertex, position));
+			glVertexAttribPointer(normal_id, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FloatVertex, normal));
+			glVertexAttribPointer(uv_id, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FloatVertex, uv));
+		} else {
+			GLsizei stride = sizeof(CompactVertex);
+			glVertexAttribPointer(position_id, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(CompactVertex, position));
+			glVertexAttribPointer(normal_id, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(CompactVertex, normal));
+			glVertexAttribPointer(uv_id, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(CompactVertex, uv));
+		}
+		glEnableVertexAttribArray(position_id);
+		glEnableVertexAttribArray(normal_id);
+		glEnableVertexAttribArray(uv_id);
+	}
+}
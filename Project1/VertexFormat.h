@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+struct MeshData;
+
+/*
+The layout of the interleaved vertex buffer of a mesh
+FLOAT stores exact 32-bit floats: position (12 bytes), normal (12 bytes), uv (8 bytes) = 32 bytes per vertex
+COMPACT stores 16-bit values: position as unorm16 within the mesh bounds (8 bytes, padded to keep 4 byte alignment),
+	the normal octahedral encoded as 2 snorm16 (4 bytes) and the uv as unorm16 within the uv bounds of the mesh (4 bytes) = 16 bytes per vertex
+*/
+enum class VertexFormat {
+	FLOAT, COMPACT
+};
+
+/*
+The fixed attribute locations of the vertex shader, so one vao works with every program
+*/
+namespace VertexAttribute {
+	const GLuint POSITION = 0;
+	const GLuint NORMAL = 1;
+	const GLuint UV = 2;
+	const GLuint INSTANCE_MODEL = 3; // The per-instance model matrix, one column per location (3 to 6)
+	const GLuint INSTANCE_LAYER = 7; // The per-instance layer of the texture in the TextureArrays, an integer attribute
+	const GLuint DRAW_INDEX = 8; // The entry of the instance in the DrawData buffer of the IndirectRenderer, an integer attribute
+}
+
+/*
+An interleaved vertex buffer ready to be uploaded, plus what the vertex shader needs to undo the quantization
+*/
+struct PackedVertices {
+	std::vector<unsigned char> data; // The interleaved vertex data
+	GLsizei stride = 0; // The size of one vertex in bytes
+	glm::vec3 position_offset = glm::vec3(0.0f); // Added to the dequantized position (the minimum of the bounds)
+	glm::vec3 position_scale = glm::vec3(1.0f); // Multiplied with the dequantized position (the size of the bounds)
+	glm::vec2 uv_offset = glm::vec2(0.0f); // Added to the dequantized uv
+	glm::vec2 uv_scale = glm::vec2(1.0f); // Multiplied with the dequantized uv
+	bool oct_normals = false; // If the normals are octahedral encoded
+};
+
+namespace VertexPacking {
+	// Documented in VertexFormat.cpp
+	void Pack(const MeshData& mesh, VertexFormat format, PackedVertices& out);
+	void SetupAttributes(VertexFormat format);
+	void OctEncode(const glm::vec3& normal, GLshort out[2]);
+	glm::vec3 OctDecode(const GLshort in[2]);
+}
@@ -9,17 +9,35 @@ in VS_OUT
 } fs_in;
 
 in vec2 UV;
-uniform sampler2D texsampler;
+flat in uint Layer;
+flat in int MaterialIndex; // The material of this draw
+
+// Every texture of the scene, the object samples its own layer (TextureArrays)
+uniform sampler2DArray texsampler;
+
+const int MAX_MATERIALS = 16; // UniformBuffers::MAX_MATERIALS
+
+// Material properties, the power of the specular is stored in specular.w (UniformBuffers::MaterialBlock)
+struct Material
+{
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+layout(std140, binding = 1) uniform MaterialData
+{
+    Material materials[MAX_MATERIALS];
+};
 
-// Material properties
-uniform vec3 mat_ambient;
-uniform vec3 mat_diffuse;
-uniform vec3 mat_specular;
-uniform float mat_power;
 out vec4 colour;
 
 void main()
 {
+    vec3 mat_ambient = materials[MaterialIndex].ambient.xyz;
+    vec3 mat_specular = materials[MaterialIndex].specular.xyz;
+    float mat_power = materials[MaterialIndex].specular.w;
+
     // Normalize the incoming N, L and V vectors
     vec3 N = normalize(fs_in.N);
     vec3 L = normalize(fs_in.L);
@@ -29,7 +47,7 @@ void main()
     vec3 R = reflect(-L, N);
 
     // Compute the diffuse and specular components for each fragment
-    vec3 diffuse = max(dot(N, L), 0.0) * texture(texsampler, UV).rgb;
+    vec3 diffuse = max(dot(N, L), 0.0) * texture(texsampler, vec3(UV, Layer)).rgb;
 
     vec3 specular = pow(max(dot(R, V), 0.0), mat_power) * mat_specular;
 
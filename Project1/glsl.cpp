@@ -5,7 +5,12 @@ char* glsl::contents;
 char* glsl::readFile(const char* filename)
 {
     // Open the file
-    FILE* fp = fopen(filename, "r");
+    FILE* fp = fopen(filename, "rb");
+    if (fp == NULL)
+    {
+        printf("Could not open shader %s\n", filename);
+        return NULL;
+    }
     // Move the file pointer to the end of the file and determing the length
     fseek(fp, 0, SEEK_END);
     long file_length = ftell(fp);
@@ -19,7 +24,7 @@ char* glsl::readFile(const char* filename)
     // Here's the actual read
     fread(contents, 1, file_length, fp);
     // This is how you denote the end of a string in C
-    contents[file_length + 1] = '\0';
+    contents[file_length] = '\0';
     fclose(fp);
     return contents;
 }
@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 
@@ -18,6 +23,23 @@
 #include "Shader.h"
 #include "MathsHelper.h"
 #include "ObjectFactory.h"
+#include "IndirectRenderer.h"
+#include "InstancedRenderer.h"
+#include "ShaderCache.h"
+#include "StateCache.h"
+#include "UniformBuffers.h"
+#include "SceneRegistry.h"
+#include "ObjectStore.h"
+#include "JobSystem.h"
+#include "AssetLoader.h"
+#include "TextureCache.h"
+#include "TextureArrays.h"
+#include "TextureSampler.h"
+#include "MeshOptimizer.h"
+#include "Profiler.h"
+#ifdef CG_BENCH
+#include "Benchmark.h"
+#endif
 
 //--------------------------------------------------------------------------------
 // Consts
@@ -27,13 +49,26 @@ const int WIDTH = 800, HEIGHT = 600;
 
 const char* vertexshader_name = "vertexshader.vert";
 
-unsigned const int DELTA_TIME = 10;
+const int MAX_TICKS_PER_FRAME = 10; // The most ticks a frame catches up on, the rest of a very slow frame is dropped so it can't snowball
+const float WALK_SPEED = 15.0f; // The speed of the camera in walk mode in metres per second, drone mode is 4 times faster
+const float TURN_SPEED = 150.0f; // The speed of looking around with IJKL in degrees per second
+const float JUMP_SPEED = 5.0f; // The vertical speed of jumping and falling in metres per second
+
+const float PROFILER_X = 470, PROFILER_Y = 0; // The top left of the profiler in the debug information, right of the text
+const float PROFILER_WIDTH = 320; // The width of the frame graph, one bar per frame of the profiler history
+const float PROFILER_GRAPH_HEIGHT = 100; // The height of the frame graph
+const float PROFILER_GRAPH_MS = 1000.0f / 30.0f; // The frame time at the top of the graph, unless a frame in it took longer
+const float PROFILER_HISTOGRAM_WIDTH = 96; // The width of the histogram of a scope
 
 //--------------------------------------------------------------------------------
 // Variables
 //--------------------------------------------------------------------------------
 
 std::vector<SceneObject*> objects;
+SceneRegistry scene; // Finds the objects by name or by position
+IndirectRenderer indirectRenderer; // Draws the objects, one multi draw indirect per shader
+InstancedRenderer renderer; // Draws the objects, one instanced draw call per group of objects with the same model and shader
+bool indirectDraw = true; // If the indirectRenderer draws the scene, otherwise the instanced renderer
 
 // Matrices
 glm::mat4 view, projection;
@@ -53,6 +88,13 @@ bool keystates[256]; // All possible keystates of the keyboard within glut, mapp
 bool mouseTrackingToggle = true; // A toggle for first-time focus within the game
 bool walkMode = true; // Default walking mode or drone mode
 bool animationOn = true; // Default animation on or off
+double animationTime = 0; // The time in seconds the animations are at, stands still while the animation is off
+int tickRate = 100; // The amount of simulation ticks per second, halved with '-' and doubled with '='
+double accumulator = 0; // The elapsed time in seconds that was not simulated yet, less than one tick after every frame
+int lastFrameTick = 0; // The elapsed time in milliseconds at the last Frame
+glm::vec3 previousCameraPos = cameraPos; // The position of the camera before the last tick, frames are drawn in between this and cameraPos
+double previousAnimationTime = 0; // The animation time before the last tick
+double simulationMs = 0, renderMs = 0; // The smoothed time in milliseconds one tick and the CPU side of one frame take
 bool isJumping = false, isFalling = false; // Booleans for jumping logic
 bool debugMode = true; // Default for debug mode (Text printed on screen)
 float eyePos = 1.75f; // Eye position to reset cameraPos to
@@ -61,6 +103,8 @@ float eyePos = 1.75f; // Eye position to reset cameraPos to
 Cleans up all the heap-allocated variables
 */
 void Cleanup() {
+	indirectRenderer.Clear();
+	renderer.Clear();
 	for (int i = 0; i < objects.size(); i++) {
 		if (objects.at(i) != nullptr) {
 			delete objects.at(i);
@@ -68,6 +112,23 @@ void Cleanup() {
 		}
 	}
 	objects.clear();
+	AssetLoader::Stop();
+	Profiler::Clear();
+	TextureSampler::Clear();
+	ShaderCache::Clear();
+	StateCache::Reset();
+	UniformBuffers::Clear();
+	JobSystem::Stop();
+}
+
+/*
+Changes the amount of simulation ticks per second. The time that was not simulated yet is scaled along,
+so the frame is still drawn at the same point in between the last two ticks and doesn't jump back
+@param rate - The new amount of ticks per second
+*/
+void SetTickRate(int rate) {
+	accumulator *= (double)tickRate / rate;
+	tickRate = rate;
 }
 
 //--------------------------------------------------------------------------------
@@ -87,12 +148,14 @@ void keyboardDownHandler(unsigned char key, int x, int y) {
 			cameraFront = lastWalkFront;
 			yaw = lastWalkYaw;
 			pitch = lastWalkPitch;
+			previousCameraPos = cameraPos;
 		} else {
 			lastWalkPos = cameraPos;
 			lastWalkFront = cameraFront;
 			lastWalkYaw = yaw;
 			lastWalkPitch = pitch;
 			cameraPos = glm::vec3(-50, 70, +50);
+			previousCameraPos = cameraPos;
 			pitch = -50;
 			yaw = -60;
 		}
@@ -110,6 +173,21 @@ void keyboardDownHandler(unsigned char key, int x, int y) {
 	case ' ':
 		isJumping = true;
 		break;
+	case '-':
+		SetTickRate(std::max(tickRate / 2, 10));
+		break;
+	case '=':
+		SetTickRate(std::min(tickRate * 2, 1000));
+		break;
+	case 't':
+		TextureSampler::Bind((TextureFilter)(((int)TextureSampler::GetFilter() + 1) % (int)TextureFilter::COUNT));
+		break;
+	case 'm':
+		indirectDraw = !indirectDraw;
+		break;
+	case 'n':
+		indirectRenderer.SetLodEnabled(!indirectRenderer.IsLodEnabled());
+		break;
 	}
 }
 
@@ -122,13 +200,14 @@ void keyboardUpHandler(unsigned char key, int x, int y) {
 
 /*
 Handles the movement of the camera based on the keystates, allows for smoother movement
+@param dt - The length of the tick in seconds
 */
-void movementHandler() {
+void movementHandler(float dt) {
 	float speedMult = 1;
 	if (!walkMode)
 		speedMult = 4;
-	float cameraSpeed = 0.015f * DELTA_TIME * speedMult;
-	float rotationSpeed = 10 * cameraSpeed / speedMult;
+	float cameraSpeed = WALK_SPEED * dt * speedMult;
+	float rotationSpeed = TURN_SPEED * dt;
 	if (keystates['w'])
 		cameraPos += cameraSpeed * cameraFront;
 	if (keystates['a'])
@@ -204,16 +283,12 @@ void mouseMotionHandler(int x, int y) {
 }
 
 /*
-Returns the index of the object in the objects vector by name. Returns -1 if not found
+Returns the object by name. Returns nullptr if not found
 @param name - The name of the object to search for
-@returns - The index of the object in the objects vector or -1 if not found
+@returns - The object or nullptr if not found
 */
-int GetObjectByName(const char* name) {
-	for (int i = 0; i < objects.size(); i++) {
-		if (objects.at(i)->Name == name)
-			return i;
-	}
-	return -1;
+SceneObject* GetObjectByName(const char* name) {
+	return scene.Get(scene.Find(name));
 }
 
 //--------------------------------------------------------------------------------
@@ -238,6 +313,85 @@ void RenderString(float x, float y, void* font, const char* string, Colour const
 	glutBitmapString(font, (unsigned char*)string);
 }
 
+/*
+Renders a filled rectangle on top of the scene, with the same coordinates as RenderString
+*/
+void RenderRectangle(float x, float y, float width, float height, Colour const& rgb) {
+	glColor4f(rgb.r, rgb.g, rgb.b, 1.0f);
+	float left = MathsHelper::lerp(-1, 1, x / WIDTH);
+	float right = MathsHelper::lerp(-1, 1, (x + width) / WIDTH);
+	float top = MathsHelper::lerp(-1, 1, y / HEIGHT) * -1;
+	float bottom = MathsHelper::lerp(-1, 1, (y + height) / HEIGHT) * -1;
+	glRectf(left, bottom, right, top);
+}
+
+/*
+@returns A time in milliseconds with two decimals
+*/
+std::string FormatMs(float ms) {
+	char text[32];
+	snprintf(text, sizeof(text), "%.2f", ms);
+	return text;
+}
+
+/*
+Renders the profiler next to the debug information: a graph of the CPU (bars) and GPU (line) time of the last frames with marks at 60 and 30 fps,
+and for every scope its average times and a histogram of its CPU times over the same frames, so a spike can be traced back to a stage
+*/
+void RenderProfiler() {
+	// Drawn with the fixed function pipeline, the scene leaves its last program bound
+	StateCache::UseProgram(0);
+	StateCache::BindVertexArray(0);
+	glDisable(GL_DEPTH_TEST);
+
+	const std::vector<float>& frameTimes = Profiler::GetFrameTimes();
+	const std::vector<float>& gpuFrameTimes = Profiler::GetGpuFrameTimes();
+	size_t frameCount = Profiler::GetFrameCount();
+	float scale = std::max(PROFILER_GRAPH_MS, Profiler::GetMaximum(frameTimes));
+	float bottom = PROFILER_Y + PROFILER_GRAPH_HEIGHT;
+	float barWidth = PROFILER_WIDTH / Profiler::HISTORY;
+	RenderRectangle(PROFILER_X, PROFILER_Y, PROFILER_WIDTH, PROFILER_GRAPH_HEIGHT, Colour(0.15f, 0.15f, 0.15f));
+	for (float mark : { 1000.0f / 60.0f, 1000.0f / 30.0f })
+		RenderRectangle(PROFILER_X, bottom - mark / scale * PROFILER_GRAPH_HEIGHT, PROFILER_WIDTH, 1, Colour(0.5f, 0.5f, 0.5f));
+	for (size_t i = 0; i < std::min(frameCount, Profiler::HISTORY); i++) {
+		// The newest frame is on the right
+		size_t slot = (frameCount - 1 - i) % Profiler::HISTORY;
+		float left = PROFILER_X + PROFILER_WIDTH - (i + 1) * barWidth;
+		float cpu = frameTimes[slot];
+		Colour colour = cpu > 1000.0f / 30.0f ? Colour(1, 0, 0) : cpu > 1000.0f / 60.0f ? Colour(1, 1, 0) : Colour(0, 1, 0);
+		float height = cpu / scale * PROFILER_GRAPH_HEIGHT;
+		RenderRectangle(left, bottom - height, barWidth, height, colour);
+		if (gpuFrameTimes[slot] >= 0.0f) {
+			float gpu = std::min(gpuFrameTimes[slot] / scale, 1.0f) * PROFILER_GRAPH_HEIGHT;
+			RenderRectangle(left, bottom - gpu - 1, barWidth, 2, Colour(0, 1, 1));
+		}
+	}
+
+	Colour colour(1.0f, 1.0f, 0.0f);
+	RenderString(PROFILER_X, bottom + 2, GLUT_BITMAP_HELVETICA_12, ("Frame: " + FormatMs(Profiler::GetAverage(frameTimes)) + " ms CPU (max " + FormatMs(Profiler::GetMaximum(frameTimes)) + "), " + FormatMs(Profiler::GetAverage(gpuFrameTimes)) + " ms GPU, graph to " + FormatMs(scale) + " ms").c_str(), Colour(0, 1, 0));
+	float y = bottom + 18;
+	for (const ProfilerScope& scope : Profiler::GetScopes()) {
+		RenderString(PROFILER_X + scope.depth * 10.0f, y, GLUT_BITMAP_HELVETICA_12, (std::string(scope.name) + ": " + FormatMs(Profiler::GetAverage(scope.cpu_ms)) + " / " + FormatMs(Profiler::GetAverage(scope.gpu_ms)) + " ms").c_str(), colour);
+
+		// The histogram runs from 0 to the slowest frame of the scope, the bars are scaled to the fullest one
+		float histogramX = PROFILER_X + PROFILER_WIDTH - PROFILER_HISTOGRAM_WIDTH;
+		float maxMs = Profiler::GetMaximum(scope.cpu_ms);
+		std::vector<int> counts = Profiler::GetHistogram(scope.cpu_ms, maxMs);
+		int fullest = std::max(*std::max_element(counts.begin(), counts.end()), 1);
+		float bucketWidth = PROFILER_HISTOGRAM_WIDTH / Profiler::HISTOGRAM_BUCKETS;
+		RenderRectangle(histogramX, y, PROFILER_HISTOGRAM_WIDTH, 12, Colour(0.15f, 0.15f, 0.15f));
+		for (int i = 0; i < Profiler::HISTOGRAM_BUCKETS; i++) {
+			float height = 12.0f * counts[i] / fullest;
+			RenderRectangle(histogramX + i * bucketWidth, y + 12 - height, bucketWidth - 1, height, Colour(0, 1, 1));
+		}
+		RenderString(histogramX - 52, y, GLUT_BITMAP_HELVETICA_12, ("< " + FormatMs(maxMs)).c_str(), Colour(0.6f, 0.6f, 0.6f));
+		y += 16;
+	}
+	RenderString(PROFILER_X, y + 2, GLUT_BITMAP_HELVETICA_12, "Scope: average CPU / GPU ms, histogram of the CPU ms", Colour(0, 1, 0));
+
+	glEnable(GL_DEPTH_TEST);
+}
+
 /*
 Renders the debug information that helped me debug my code while working
 */
@@ -255,47 +409,68 @@ void RenderDebugInformation() {
 	RenderString(14, 124, GLUT_BITMAP_HELVETICA_12, ("Camera Front Z: " + std::to_string(cameraFront.z)).c_str(), colour);
 	RenderString(0, 138, GLUT_BITMAP_HELVETICA_12, ("Walking Mode: " + std::to_string(walkMode)).c_str(), colour);
 	RenderString(0, 152, GLUT_BITMAP_HELVETICA_12, ("Animation: " + std::to_string(animationOn)).c_str(), colour);
-	SceneObject* car = objects.at(GetObjectByName("Car"));
+	SceneObject* car = GetObjectByName("Car");
 	RenderString(0, 166, GLUT_BITMAP_HELVETICA_12, "Car Pos: ", Colour(0, 1, 0));
-	RenderString(14, 180, GLUT_BITMAP_HELVETICA_12, ("Car Pos X: " + std::to_string(car->m_Position.x)).c_str(), colour);
-	RenderString(14, 194, GLUT_BITMAP_HELVETICA_12, ("Car Pos Y: " + std::to_string(car->m_Position.y)).c_str(), colour);
-	RenderString(14, 208, GLUT_BITMAP_HELVETICA_12, ("Car Pos Z: " + std::to_string(car->m_Position.z)).c_str(), colour);
+	RenderString(14, 180, GLUT_BITMAP_HELVETICA_12, ("Car Pos X: " + std::to_string(car->GetPosition().x)).c_str(), colour);
+	RenderString(14, 194, GLUT_BITMAP_HELVETICA_12, ("Car Pos Y: " + std::to_string(car->GetPosition().y)).c_str(), colour);
+	RenderString(14, 208, GLUT_BITMAP_HELVETICA_12, ("Car Pos Z: " + std::to_string(car->GetPosition().z)).c_str(), colour);
 	RenderString(0, 222, GLUT_BITMAP_HELVETICA_12, "Car Rot: ", Colour(0, 1, 0));
-	RenderString(14, 236, GLUT_BITMAP_HELVETICA_12, ("Car Rot X: " + std::to_string(car->m_Rotation.x)).c_str(), colour);
-	RenderString(14, 250, GLUT_BITMAP_HELVETICA_12, ("Car Rot Y: " + std::to_string(car->m_Rotation.y)).c_str(), colour);
-	RenderString(14, 264, GLUT_BITMAP_HELVETICA_12, ("Car Rot Z: " + std::to_string(car->m_Rotation.z)).c_str(), colour);
-}
-
-/*
-Animates the models with an animation set
-*/
-void RenderAnimation() {
-	for (int i = 0; i < objects.size(); i++) {
-		objects.at(i)->Animate();
-	}
+	RenderString(14, 236, GLUT_BITMAP_HELVETICA_12, ("Car Rot X: " + std::to_string(car->GetRotation().x)).c_str(), colour);
+	RenderString(14, 250, GLUT_BITMAP_HELVETICA_12, ("Car Rot Y: " + std::to_string(car->GetRotation().y)).c_str(), colour);
+	RenderString(14, 264, GLUT_BITMAP_HELVETICA_12, ("Car Rot Z: " + std::to_string(car->GetRotation().z)).c_str(), colour);
+	if (indirectDraw)
+		RenderString(0, 278, GLUT_BITMAP_HELVETICA_12, ("Draw calls: " + std::to_string(indirectRenderer.GetDrawCalls()) + " multi draw indirect (" + std::to_string(indirectRenderer.GetCommandCount()) + " commands) for " + std::to_string(objects.size()) + " objects").c_str(), colour);
+	else
+		RenderString(0, 278, GLUT_BITMAP_HELVETICA_12, ("Draw calls: " + std::to_string(renderer.GetDrawCalls()) + " instanced for " + std::to_string(objects.size()) + " objects").c_str(), colour);
+	const StateCache::Counters& state = StateCache::GetCounters();
+	RenderString(0, 292, GLUT_BITMAP_HELVETICA_12, ("Binds: " + std::to_string(state.binds) + " (" + std::to_string(state.binds_skipped) + " skipped)").c_str(), colour);
+	RenderString(0, 306, GLUT_BITMAP_HELVETICA_12, ("Uniforms: " + std::to_string(state.uniforms) + " (" + std::to_string(state.uniforms_skipped) + " skipped)").c_str(), colour);
+	int visible = indirectDraw ? indirectRenderer.GetVisibleCount() : renderer.GetVisibleCount();
+	int culled = indirectDraw ? indirectRenderer.GetCulledCount() : renderer.GetCulledCount();
+	RenderString(0, 320, GLUT_BITMAP_HELVETICA_12, ("Visible: " + std::to_string(visible) + ", culled: " + std::to_string(culled)).c_str(), colour);
+	std::vector<ObjectHandle> nearby;
+	scene.QueryRadius(cameraPos, 20.0f, nearby);
+	RenderString(0, 334, GLUT_BITMAP_HELVETICA_12, ("Objects within 20m: " + std::to_string(nearby.size())).c_str(), colour);
+	RenderString(0, 348, GLUT_BITMAP_HELVETICA_12, ("Simulation: " + std::to_string(tickRate) + " ticks/s, " + std::to_string(simulationMs) + " ms per tick").c_str(), colour);
+	RenderString(0, 362, GLUT_BITMAP_HELVETICA_12, ("Render: " + std::to_string(renderMs) + " ms per frame").c_str(), colour);
+	RenderString(0, 376, GLUT_BITMAP_HELVETICA_12, ("Loading: " + std::to_string(AssetLoader::GetPendingCount()) + " assets, " + std::to_string(AssetLoader::GetUploadedBytes() / 1024) + " KB uploaded this frame").c_str(), colour);
+	RenderString(0, 390, GLUT_BITMAP_HELVETICA_12, ("Texture filter: " + std::string(TextureSampler::GetName(TextureSampler::GetFilter())) + " (" + std::to_string((int)TextureSampler::GetMaxAnisotropy()) + "x anisotropy)").c_str(), colour);
+	RenderString(0, 404, GLUT_BITMAP_HELVETICA_12, ("Texture array: " + std::to_string(TextureArrays::GetLayerCount()) + " of " + std::to_string(TextureArrays::GetCapacity()) + " layers, " + std::to_string(TextureArrays::GetMemorySize() / 1024) + " KB").c_str(), colour);
+	if (indirectDraw)
+		RenderString(0, 418, GLUT_BITMAP_HELVETICA_12, ("Triangles: " + std::to_string(indirectRenderer.GetTriangleCount()) + " of " + std::to_string(indirectRenderer.GetFullTriangleCount()) + " (levels of detail " + (indirectRenderer.IsLodEnabled() ? "on" : "off") + ")").c_str(), colour);
+	else
+		RenderString(0, 418, GLUT_BITMAP_HELVETICA_12, "Triangles: full models (levels of detail need multi draw indirect)", colour);
+	RenderProfiler();
 }
 
 /*
-The main render method
+Points cameraFront in the direction of the yaw and pitch
 */
-void Render() {
-	glClearColor(0.0, 0.0, 0.0, 1.0);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
+void UpdateCameraFront() {
 	glm::vec3 direction{};
 	direction.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
 	direction.y = sin(glm::radians(pitch));
 	direction.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
 	cameraFront = glm::normalize(direction);
-	view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-	movementHandler();
+}
+
+/*
+Advances the simulation by one tick: the camera movement, jumping and the animation clock
+@param dt - The length of the tick in seconds
+*/
+void Simulate(float dt) {
+	previousCameraPos = cameraPos;
+	previousAnimationTime = animationTime;
+
+	UpdateCameraFront();
+	movementHandler(dt);
 
 	if (walkMode && isJumping) {
 		if (cameraPos.y <= 2.5 && !isFalling)
-			cameraPos.y += 0.05f;
+			cameraPos.y += JUMP_SPEED * dt;
 		else {
 			isFalling = true;
-			cameraPos.y -= 0.05f;
+			cameraPos.y -= JUMP_SPEED * dt;
 		}
 		if (cameraPos.y <= 1.75 && isFalling) {
 			isJumping = false;
@@ -303,24 +478,112 @@ void Render() {
 		}
 	}
 
-	for (int i = 0; i < objects.size(); i++) {
-		objects.at(i)->Render(&view);
-	}
 	if (animationOn)
-		RenderAnimation();
+		animationTime += dt;
+}
+
+/*
+Animates the models with an animation set.
+The animations are evaluated at any time in between two ticks, which is as smooth as interpolating their transforms
+@param time - The animation time to show
+*/
+void RenderAnimation(double time) {
+	ObjectStore::Animate(time);
+}
+
+/*
+Draws the scene in between the last two ticks, without the debug information
+@param alpha - How far the frame is from the previous tick to the last tick, from 0 to 1
+*/
+void DrawScene(float alpha) {
+	Profiler::Begin("Clear");
+	glClearColor(0.0, 0.0, 0.0, 1.0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	Profiler::End();
+
+	// Looking around follows the mouse right away, only the movement of the ticks is interpolated
+	UpdateCameraFront();
+	glm::vec3 eye = glm::mix(previousCameraPos, cameraPos, alpha);
+	view = glm::lookAt(eye, eye + cameraFront, cameraUp);
+
+	Profiler::Begin("Animation");
+	RenderAnimation(previousAnimationTime + (animationTime - previousAnimationTime) * alpha);
+	Profiler::End();
+	Profiler::Begin("Transforms");
+	StateCache::BeginFrame();
+	UniformBuffers::UpdateFrame(&view, &projection);
+	ObjectStore::UpdateTransforms(view);
+	Profiler::End();
+	Profiler::Begin("Draw");
+	if (indirectDraw)
+		indirectRenderer.Render(&view, &projection);
+	else
+		renderer.Render(&view, &projection);
+	Profiler::End();
+}
+
+/*
+The main render method, draws the scene in between the last two ticks and the debug information
+@param alpha - How far the frame is from the previous tick to the last tick, from 0 to 1
+*/
+void Render(float alpha) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Profiler::Begin("Render");
+	DrawScene(alpha);
+	Profiler::Begin("Debug text");
 	if (debugMode)
 		RenderDebugInformation();
 	else
 		RenderString(0, 4, GLUT_BITMAP_HELVETICA_12, "Enter debug mode: ']'", Colour(0, 1, 0));
+	Profiler::End();
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	renderMs = renderMs * 0.95 + ms * 0.05;
+	Profiler::Begin("Swap");
 	glutSwapBuffers();
+	Profiler::End();
+	Profiler::End();
 }
 
 /*
-Render method that is called by the timer function
+Runs the simulation ticks that fit in the time since the last frame, uploads what the AssetLoader loaded and renders one frame.
+Called whenever glut is idle, so the simulation keeps a fixed pace however often the display allows a frame
 */
-void Render(int n) {
-	Render();
-	glutTimerFunc(DELTA_TIME, Render, 0);
+void Frame() {
+	int tick = glutGet(GLUT_ELAPSED_TIME);
+	accumulator += (tick - lastFrameTick) / 1000.0;
+	lastFrameTick = tick;
+	Profiler::BeginFrame();
+
+	Profiler::Begin("Simulation");
+	double tickLength = 1.0 / tickRate;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int ticks = 0;
+	while (accumulator >= tickLength && ticks < MAX_TICKS_PER_FRAME) {
+		Simulate((float)tickLength);
+		accumulator -= tickLength;
+		ticks++;
+	}
+	if (ticks > 0) {
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / ticks;
+		simulationMs = simulationMs * 0.95 + ms * 0.05;
+	}
+	accumulator = std::fmod(accumulator, tickLength);
+	Profiler::End();
+
+	// Objects whose model just arrived switch from the placeholder, which changes their batches
+	Profiler::Begin("Assets");
+	if (AssetLoader::Update() > 0) {
+		bool changed = false;
+		for (int i = 0; i < objects.size(); i++)
+			changed |= objects.at(i)->RefreshAssets();
+		if (changed) {
+			indirectRenderer.Build(objects);
+			renderer.Build(objects);
+		}
+	}
+	Profiler::End();
+	Render((float)(accumulator / tickLength));
+	Profiler::EndFrame();
 }
 
 /*
@@ -331,12 +594,12 @@ void InitGlutGlew(int argc, char** argv) {
 	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
 	glutInitWindowSize(WIDTH, HEIGHT);
 	glutCreateWindow("OpenGL assigment Lilith Houtjes");
-	glutDisplayFunc(Render);
+	glutDisplayFunc(Frame);
 	glutIgnoreKeyRepeat(GLUT_DEVICE_IGNORE_KEY_REPEAT);
 	glutKeyboardFunc(keyboardDownHandler);
 	glutKeyboardUpFunc(keyboardUpHandler);
 	glutPassiveMotionFunc(mouseMotionHandler);
-	glutTimerFunc(DELTA_TIME, Render, 0);
+	glutIdleFunc(Frame);
 
 	glewInit();
 }
@@ -482,6 +745,10 @@ void InitObjects() {
 	objects.push_back(generalWaste);
 	objects.push_back(paper_recycling);
 	delete factory;
+
+	for (int i = 0; i < objects.size(); i++) {
+		scene.Add(objects.at(i));
+	}
 }
 
 /*
@@ -491,8 +758,8 @@ Each stage has a type of transformation, a speed, the required vec3 for that tra
 After all stages are done it will either: loop back to the first (default), not repeat at all, or go through them in reverse order
 */
 void InitAnimations() {
-	int carIndex = GetObjectByName("Car");
-	if (carIndex > 0) {
+	SceneObject* car = GetObjectByName("Car");
+	if (car != nullptr) {
 		Animation* carAnimation = new Animation(AnimationRepeat::REPEAT);
 		carAnimation->AddStage(AnimationStage(AnimationType::MOVETO, glm::vec3(0, 0.5f, 17), 150));
 		carAnimation->AddStage(AnimationStage(AnimationType::ROTATE, glm::vec3(0, 1, 0), 90, glm::radians(-1.0f)));
@@ -502,7 +769,7 @@ void InitAnimations() {
 		carAnimation->AddStage(AnimationStage(AnimationType::ROTATE, glm::vec3(0, 1, 0), 90, glm::radians(-1.0f)));
 		carAnimation->AddStage(AnimationStage(AnimationType::MOVETO, glm::vec3(0, 0.5f, -27), 150));
 		carAnimation->AddStage(AnimationStage(AnimationType::ROTATE, glm::vec3(0, 1, 0), 90, glm::radians(-1.0f)));
-		objects.at(carIndex)->SetAnimation(carAnimation);
+		car->SetAnimation(carAnimation);
 	}
 }
 
@@ -547,43 +814,170 @@ void InitLightAndMaterials() {
 Positions the objects in the scene that were not made through the factory
 */
 void PositionObjectsInScene() {
-	int busstopIndex = GetObjectByName("Busstop");
-	if (busstopIndex > 0) {
-		objects.at(busstopIndex)->Translate(glm::vec3(50, 0, 85));
-		objects.at(busstopIndex)->Scale(glm::vec3(1.5f));
-		objects.at(busstopIndex)->Rotate(glm::radians(180.0f), glm::vec3(0, 1, 0));
+	SceneObject* busstop = GetObjectByName("Busstop");
+	if (busstop != nullptr) {
+		busstop->Translate(glm::vec3(50, 0, 85));
+		busstop->Scale(glm::vec3(1.5f));
+		busstop->Rotate(glm::radians(180.0f), glm::vec3(0, 1, 0));
 	}
-	int streetlampIndex = GetObjectByName("Street Lantern");
-	if (streetlampIndex > 0) {
-		objects.at(streetlampIndex)->Rotate(glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		objects.at(streetlampIndex)->Scale(glm::vec3(1.0f, 0.75f, 1.0f));
+	SceneObject* streetlamp = GetObjectByName("Street Lantern");
+	if (streetlamp != nullptr) {
+		streetlamp->Rotate(glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		streetlamp->Scale(glm::vec3(1.0f, 0.75f, 1.0f));
 	}
-	int treeIndex = GetObjectByName("Tree");
-	if (treeIndex > 0) {
-		objects.at(treeIndex)->Translate(glm::vec3(2.5f, 0, 0));
-		objects.at(treeIndex)->Scale(glm::vec3(0.75, 0.5, 0.75));
+	SceneObject* tree = GetObjectByName("Tree");
+	if (tree != nullptr) {
+		tree->Translate(glm::vec3(2.5f, 0, 0));
+		tree->Scale(glm::vec3(0.75, 0.5, 0.75));
 	}
-	int carIndex = GetObjectByName("Car");
-	if (carIndex > 0) {
-		objects.at(carIndex)->Translate(glm::vec3(0, 0.5f, 10));
+	SceneObject* car = GetObjectByName("Car");
+	if (car != nullptr) {
+		car->Translate(glm::vec3(0, 0.5f, 10));
 	}
-	int groundIndex = GetObjectByName("Ground");
-	if (groundIndex > 0) {
-		objects.at(groundIndex)->Translate(glm::vec3(0, -0.01f, 0));
+	SceneObject* ground = GetObjectByName("Ground");
+	if (ground != nullptr) {
+		ground->Translate(glm::vec3(0, -0.01f, 0));
 	}
 }
 
 /*
-Initialises the buffers for each object
+Initialises the buffers for each object and groups the objects for instanced rendering
 */
 void InitBuffers() {
 	for (int i = 0; i < objects.size(); i++) {
-		objects.at(i)->InitBuffers(&view, &projection);
+		objects.at(i)->InitBuffers();
 	}
+	indirectRenderer.Build(objects);
+	renderer.Build(objects);
 }
 
+#ifdef CG_BENCH
+/*
+Draws the scene without a window along the camera path of the Benchmark for a fixed amount of frames and writes the timings.
+The animations are stepped by a fixed 1/60 s per frame instead of the clock, so every run draws exactly the same frames.
+Options: --frames N, --warmup N, --out prefix (writes prefix.csv and prefix.json), --instanced, --no-lod,
+--filter nearest|bilinear|trilinear|anisotropic and --fast-textures
+@returns The exit code of the program
+*/
+int RunBenchmark(int argc, char** argv) {
+	int frames = 600, warmup = 30;
+	std::string out = "bench";
+	BenchmarkInfo info;
+	TextureFilter filter = TextureFilter::TRILINEAR;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+			warmup = std::max(0, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			out = argv[++i];
+		else if (strcmp(argv[i], "--instanced") == 0)
+			indirectDraw = false;
+		else if (strcmp(argv[i], "--no-lod") == 0)
+			info.lod = false;
+		else if (strcmp(argv[i], "--fast-textures") == 0)
+			TextureCache::SetQuality(CompressionQuality::FAST);
+		else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			i++;
+			for (int f = 0; f < (int)TextureFilter::COUNT; f++) {
+				if (strcmp(argv[i], TextureSampler::GetName((TextureFilter)f)) == 0)
+					filter = (TextureFilter)f;
+			}
+		}
+		else {
+			printf("Unknown benchmark option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (!Benchmark::CreateContext(WIDTH, HEIGHT))
+		return 1;
+	JobSystem::Start();
+	TextureSampler::Init();
+	AssetLoader::Start();
+	InitObjects();
+	InitLightAndMaterials();
+	InitShaders();
+	InitMatrices();
+	InitBuffers();
+	InitAnimations();
+	PositionObjectsInScene();
+	glEnable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+
+	// Every model and texture is loaded before the first frame, so no frame is measured with placeholders
+	AssetLoader::Finish();
+	for (int i = 0; i < objects.size(); i++)
+		objects.at(i)->RefreshAssets();
+	indirectRenderer.Build(objects);
+	renderer.Build(objects);
+	indirectRenderer.SetLodEnabled(info.lod);
+	TextureSampler::Bind(filter);
+
+	info.renderer = indirectDraw ? "indirect" : "instanced";
+	info.lod = indirectDraw && info.lod;
+	info.texture_filter = TextureSampler::GetName(TextureSampler::GetFilter());
+	info.warmup = warmup;
+	info.width = WIDTH;
+	info.height = HEIGHT;
+
+	// The warmup frames stand still at the start of the path so the driver has compiled and uploaded everything
+	for (int i = -warmup; i < frames; i++) {
+		glm::vec3 front;
+		Benchmark::GetCameraPath(std::max(i, 0) / (float)frames, cameraPos, front);
+		previousCameraPos = cameraPos;
+		yaw = glm::degrees(atan2(front.z, front.x));
+		pitch = glm::degrees(asin(glm::clamp(front.y, -1.0f, 1.0f)));
+		animationTime = previousAnimationTime = std::max(i, 0) / 60.0;
+
+		if (i >= 0)
+			Benchmark::BeginFrame();
+		DrawScene(1.0f);
+		if (i < 0) {
+			glFinish();
+			continue;
+		}
+		FrameSample counts;
+		counts.draw_calls = indirectDraw ? indirectRenderer.GetDrawCalls() : renderer.GetDrawCalls();
+		counts.commands = indirectDraw ? indirectRenderer.GetCommandCount() : 0;
+		counts.visible = indirectDraw ? indirectRenderer.GetVisibleCount() : renderer.GetVisibleCount();
+		counts.triangles = indirectDraw ? indirectRenderer.GetTriangleCount() : 0;
+		Benchmark::EndFrame(counts);
+		// The stand-in for glutSwapBuffers, which ends the frame for the driver
+		glFlush();
+	}
+
+	const std::vector<FrameSample>& samples = Benchmark::Finish();
+	Benchmark::PrintSummary(info, samples);
+	bool written = Benchmark::WriteCsv(out + ".csv", samples) && Benchmark::WriteJson(out + ".json", info, samples);
+	if (written)
+		printf("Wrote %s.csv and %s.json\n", out.c_str(), out.c_str());
+
+	Cleanup();
+	Benchmark::DestroyContext();
+	return written ? 0 : 1;
+}
+#endif
+
 int main(int argc, char** argv) {
+	// --mesh-report Objects/*.obj prints how the optimizer changes the vertex cache and overdraw figures of the models and exits
+	if (argc > 1 && strcmp(argv[1], "--mesh-report") == 0) {
+		for (int i = 2; i < argc; i++)
+			MeshOptimizer::PrintReport(argv[i]);
+		return 0;
+	}
+#ifdef CG_BENCH
+	return RunBenchmark(argc, argv);
+#endif
 	InitGlutGlew(argc, argv);
+	// Textures are compressed once and cached next to the .bmp, --fast-textures trades some quality for a quicker first start
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--fast-textures") == 0)
+			TextureCache::SetQuality(CompressionQuality::FAST);
+	}
+	JobSystem::Start();
+	TextureSampler::Init();
+	AssetLoader::Start();
 	InitObjects();
 	InitLightAndMaterials();
 	InitShaders();
@@ -591,6 +985,7 @@ int main(int argc, char** argv) {
 	InitBuffers();
 	InitAnimations();
 	PositionObjectsInScene();
+	lastFrameTick = glutGet(GLUT_ELAPSED_TIME);
 
 	glEnable(GL_DEPTH_TEST);
 	glDisable(GL_CULL_FACE);
@@ -2,109 +2,509 @@
 #include <stdio.h>
 #include <string>
 #include <cstring>
+#include <cstdint>
+#include <thread>
+#include <algorithm>
 
 #include <glm/glm.hpp>
 
 #include "objloader.h"
 
-// Very, VERY simple OBJ loader.
-// Here is a short list of features a real function would provide : 
-// - Binary files. Reading a model should be just a few memcpy's away, not parsing a file at runtime. In short : OBJ is not very great.
+// Small, fast OBJ loader.
+// The whole file is read into one buffer, split into chunks on line boundaries and every chunk is parsed on its own thread.
+// Supported: v, vt, vn and f statements, polygons of any size (triangulated as a fan), negative (relative) indices
+// and faces without uv and/or normal indices. Everything else (o, g, s, usemtl, comments, ...) is skipped.
+// The output is indexed: corners with the same position, uv and normal are welded into one vertex.
+// Still missing compared to a real loader:
 // - Animations & bones (includes bones weights)
 // - Multiple UVs
-// - All attributes should be optional, not "forced"
-// - More stable. Change a line in the OBJ file and it crashes.
-// - More secure. Change another line and you can inject code.
-// - Loading from memory, stream, etc
+// - Materials (.mtl files)
+
+namespace {
+
+    const size_t MIN_CHUNK_SIZE = 256 * 1024; // Files smaller than this are parsed on a single thread
+
+    // One corner of a face as written in the file.
+    // Indices are 0-based, -1 means the attribute was not given.
+    // Relative (negative) indices are resolved against the chunk and fixed up once the chunk's base index is known.
+    struct Corner {
+        int v, vt, vn;
+    };
+
+    // Bit flags telling which indices of a corner are still chunk relative
+    enum RelativeFlags : uint8_t {
+        RELATIVE_V = 1, RELATIVE_VT = 2, RELATIVE_VN = 4
+    };
+
+    // Everything parsed from one chunk of the file
+    struct Chunk {
+        const char* begin;
+        const char* end;
+        std::vector<glm::vec3> vertices;
+        std::vector<glm::vec2> uvs;
+        std::vector<glm::vec3> normals;
+        std::vector<Corner> corners; // The corners of all faces, face after face
+        std::vector<uint8_t> relative; // RelativeFlags per corner
+        std::vector<uint32_t> faceSizes; // The amount of corners of every face
+        size_t triangleCount = 0;
+        size_t firstTriangle = 0; // The index of the first output triangle of this chunk
+        int vertexBase = 0, uvBase = 0, normalBase = 0; // The amount of v, vt and vn statements in the chunks before this one
+        bool error = false;
+        int errorLine = 0; // Line within the chunk
+    };
+
+    // Powers of ten that are exactly representable as doubles
+    const double POW10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    inline bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline bool isDigit(char c) {
+        return (unsigned char)(c - '0') < 10;
+    }
+
+    inline const char* skipSpace(const char* p) {
+        while (isSpace(*p))
+            p++;
+        return p;
+    }
+
+    inline const char* skipLine(const char* p, const char* end) {
+        const char* newline = (const char*)memchr(p, '\n', end - p);
+        return newline ? newline + 1 : end;
+    }
+
+    // Parses a decimal floating point number ([+-]digits[.digits][(e|E)[+-]digits]) without going through the locale.
+    // The significand is accumulated in a 64-bit integer (the first 19 digits are kept) and scaled by an exact power of ten,
+    // which is exact for everything an exporter writes and at most one float ulp off otherwise.
+    // Returns the position after the number, or the input position if there is no number.
+    const char* parseFloat(const char* p, float& out) {
+        const char* start = p;
+        bool negative = false;
+        if (*p == '-' || *p == '+') {
+            negative = *p == '-';
+            p++;
+        }
+
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        int digits = 0;
+        bool any = false;
+        for (; isDigit(*p); p++, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa != 0)
+                    digits++;
+            } else {
+                exponent++;
+            }
+        }
+        if (*p == '.') {
+            p++;
+            for (; isDigit(*p); p++, any = true) {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    if (mantissa != 0)
+                        digits++;
+                    exponent--;
+                }
+            }
+        }
+        if (!any) {
+            out = 0.0f;
+            return start;
+        }
+        if (*p == 'e' || *p == 'E') {
+            const char* e = p + 1;
+            bool expNegative = false;
+            if (*e == '-' || *e == '+') {
+                expNegative = *e == '-';
+                e++;
+            }
+            if (isDigit(*e)) {
+                int value = 0;
+                for (; isDigit(*e); e++) {
+                    if (value < 10000)
+                        value = value * 10 + (*e - '0');
+                }
+                exponent += expNegative ? -value : value;
+                p = e;
+            }
+        }
+
+        double result = (double)mantissa;
+        if (mantissa != 0) {
+            while (exponent > 22) {
+                result *= 1e22;
+                exponent -= 22;
+            }
+            while (exponent < -22) {
+                result /= 1e22;
+                exponent += 22;
+            }
+            result = exponent < 0 ? result / POW10[-exponent] : result * POW10[exponent];
+        }
+        out = (float)(negative ? -result : result);
+        return p;
+    }
+
+    // Parses a (possibly negative) integer, returns the input position if there is none
+    inline const char* parseInt(const char* p, int& out) {
+        const char* start = p;
+        bool negative = false;
+        if (*p == '-' || *p == '+') {
+            negative = *p == '-';
+            p++;
+        }
+        if (!isDigit(*p))
+            return start;
+        int value = 0;
+        for (; isDigit(*p); p++)
+            value = value * 10 + (*p - '0');
+        out = negative ? -value : value;
+        return p;
+    }
+
+    // Turns an index as written in the file into a 0-based index.
+    // Positive indices are absolute, negative ones count back from the last element defined so far in this chunk.
+    // Returns false for the invalid index 0.
+    inline bool resolveIndex(int index, size_t localCount, int& out, uint8_t& relative, uint8_t flag) {
+        if (index > 0) {
+            out = index - 1;
+        } else if (index < 0) {
+            out = (int)localCount + index;
+            relative |= flag;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // Parses one "f" statement, p points right after the "f"
+    bool parseFace(const char* p, Chunk& chunk) {
+        uint32_t count = 0;
+        while (true) {
+            p = skipSpace(p);
+            if (*p == '\n' || *p == '\0' || *p == '#')
+                break;
+
+            Corner corner = { -1, -1, -1 };
+            uint8_t relative = 0;
+            int index;
+            const char* next = parseInt(p, index);
+            if (next == p || !resolveIndex(index, chunk.vertices.size(), corner.v, relative, RELATIVE_V))
+                return false;
+            p = next;
+            if (*p == '/') {
+                p++;
+                if (*p != '/') { // v/vt or v/vt/vn
+                    next = parseInt(p, index);
+                    if (next == p || !resolveIndex(index, chunk.uvs.size(), corner.vt, relative, RELATIVE_VT))
+                        return false;
+                    p = next;
+                }
+                if (*p == '/') { // v//vn or v/vt/vn
+                    p++;
+                    next = parseInt(p, index);
+                    if (next == p || !resolveIndex(index, chunk.normals.size(), corner.vn, relative, RELATIVE_VN))
+                        return false;
+                    p = next;
+                }
+            }
+            if (!isSpace(*p) && *p != '\n' && *p != '\0' && *p != '#')
+                return false;
+
+            chunk.corners.push_back(corner);
+            chunk.relative.push_back(relative);
+            count++;
+        }
+        if (count < 3)
+            return false;
+        chunk.faceSizes.push_back(count);
+        chunk.triangleCount += count - 2;
+        return true;
+    }
+
+    // Parses all lines of a chunk
+    void parseChunk(Chunk& chunk) {
+        const char* p = chunk.begin;
+        int line = 0;
+        while (p < chunk.end) {
+            line++;
+            const char* lineStart = skipSpace(p);
+            const char* s = lineStart;
+            bool ok = true;
+            if (s[0] == 'v' && isSpace(s[1])) {
+                glm::vec3 vertex;
+                s = parseFloat(skipSpace(s + 2), vertex.x);
+                s = parseFloat(skipSpace(s), vertex.y);
+                s = parseFloat(skipSpace(s), vertex.z);
+                chunk.vertices.push_back(vertex);
+            } else if (s[0] == 'v' && s[1] == 't' && isSpace(s[2])) {
+                glm::vec2 uv;
+                s = parseFloat(skipSpace(s + 3), uv.x);
+                s = parseFloat(skipSpace(s), uv.y);
+                uv.y = -uv.y; // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders.
+                chunk.uvs.push_back(uv);
+            } else if (s[0] == 'v' && s[1] == 'n' && isSpace(s[2])) {
+                glm::vec3 normal;
+                s = parseFloat(skipSpace(s + 3), normal.x);
+                s = parseFloat(skipSpace(s), normal.y);
+                s = parseFloat(skipSpace(s), normal.z);
+                chunk.normals.push_back(normal);
+            } else if (s[0] == 'f' && isSpace(s[1])) {
+                ok = parseFace(s + 1, chunk);
+            }
+            // Anything else is a comment or a statement we don't use, eat up the rest of the line
+            if (!ok && !chunk.error) {
+                chunk.error = true;
+                chunk.errorLine = line;
+            }
+            p = skipLine(lineStart, chunk.end);
+        }
+    }
+
+    // Looks up one attribute of a corner, returns false if the index is out of range
+    template<typename T>
+    inline bool fetch(const std::vector<T>& values, int index, T& out) {
+        if (index < 0 || (size_t)index >= values.size())
+            return false;
+        out = values[index];
+        return true;
+    }
+
+    // Writes the de-indexed triangles of a chunk into the output arrays
+    bool emitTriangles(
+        const Chunk& chunk,
+        const std::vector<glm::vec3>& vertices,
+        const std::vector<glm::vec2>& uvs,
+        const std::vector<glm::vec3>& normals,
+        glm::vec3* outVertices, glm::vec2* outUvs, glm::vec3* outNormals
+    ){
+        size_t out = chunk.firstTriangle * 3;
+        size_t corner = 0;
+        for (size_t f = 0; f < chunk.faceSizes.size(); f++) {
+            const Corner* face = &chunk.corners[corner];
+            uint32_t count = chunk.faceSizes[f];
+            corner += count;
+
+            // Triangulate as a fan around the first corner
+            for (uint32_t t = 1; t + 1 < count; t++) {
+                const Corner* tri[3] = { &face[0], &face[t], &face[t + 1] };
+                bool missingNormal = false;
+                for (int k = 0; k < 3; k++) {
+                    if (!fetch(vertices, tri[k]->v, outVertices[out + k]))
+                        return false;
+                    if (tri[k]->vt < 0)
+                        outUvs[out + k] = glm::vec2(0.0f);
+                    else if (!fetch(uvs, tri[k]->vt, outUvs[out + k]))
+                        return false;
+                    if (tri[k]->vn < 0)
+                        missingNormal = true;
+                    else if (!fetch(normals, tri[k]->vn, outNormals[out + k]))
+                        return false;
+                }
+                if (missingNormal) {
+                    // No normals in the file, use the flat face normal
+                    glm::vec3 n = glm::cross(outVertices[out + 1] - outVertices[out], outVertices[out + 2] - outVertices[out]);
+                    float length = glm::length(n);
+                    n = length > 0.0f ? n / length : glm::vec3(0, 1, 0);
+                    for (int k = 0; k < 3; k++) {
+                        if (tri[k]->vn < 0)
+                            outNormals[out + k] = n;
+                    }
+                }
+                out += 3;
+            }
+        }
+        return true;
+    }
+
+    // Returns the bits of a float with -0 turned into +0, so values that compare equal hash equal
+    inline uint32_t floatBits(float f) {
+        f += 0.0f;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+
+    inline uint32_t hashCorner(const glm::vec3& v, const glm::vec2& uv, const glm::vec3& n) {
+        const uint32_t values[8] = {
+            floatBits(v.x), floatBits(v.y), floatBits(v.z), floatBits(uv.x), floatBits(uv.y), floatBits(n.x), floatBits(n.y), floatBits(n.z)
+        };
+        uint32_t hash = 2166136261u; // FNV-1a over the 32-bit words, good enough for a table that is at most half full
+        for (int i = 0; i < 8; i++)
+            hash = (hash ^ values[i]) * 16777619u;
+        return hash ^ (hash >> 15);
+    }
+
+    // Welds identical (position, uv, normal) corners of a triangle list into unique vertices and an index buffer.
+    // Uses an open addressing hash table that holds indices into the output arrays.
+    void weldVertices(
+        const std::vector<glm::vec3>& vertices,
+        const std::vector<glm::vec2>& uvs,
+        const std::vector<glm::vec3>& normals,
+        std::vector<glm::vec3>& out_vertices,
+        std::vector<glm::vec2>& out_uvs,
+        std::vector<glm::vec3>& out_normals,
+        std::vector<unsigned int>& out_indices
+    ){
+        const uint32_t EMPTY = 0xffffffffu;
+        size_t tableSize = 16;
+        while (tableSize < vertices.size() * 2)
+            tableSize *= 2;
+        std::vector<uint32_t> table(tableSize, EMPTY);
+        size_t mask = tableSize - 1;
+
+        out_vertices.clear();
+        out_uvs.clear();
+        out_normals.clear();
+        out_indices.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            size_t slot = hashCorner(vertices[i], uvs[i], normals[i]) & mask;
+            while (true) {
+                uint32_t index = table[slot];
+                if (index == EMPTY) {
+                    index = (uint32_t)out_vertices.size();
+                    table[slot] = index;
+                    out_vertices.push_back(vertices[i]);
+                    out_uvs.push_back(uvs[i]);
+                    out_normals.push_back(normals[i]);
+                    out_indices[i] = index;
+                    break;
+                }
+                if (out_vertices[index] == vertices[i] && out_uvs[index] == uvs[i] && out_normals[index] == normals[i]) {
+                    out_indices[i] = index;
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+        }
+    }
+
+    // Runs func(i) for every chunk, on its own thread when there is more than one chunk
+    template<typename Func>
+    void forEachChunk(std::vector<Chunk>& chunks, Func func) {
+        if (chunks.size() == 1) {
+            func(0);
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < chunks.size(); i++)
+            threads.push_back(std::thread(func, i));
+        func(0);
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }
+}
 
 bool loadOBJ(
     const char * path, 
     std::vector<glm::vec3> & out_vertices, 
     std::vector<glm::vec2> & out_uvs,
-    std::vector<glm::vec3> & out_normals
+    std::vector<glm::vec3> & out_normals,
+    std::vector<unsigned int> & out_indices
 ){
     printf("Loading OBJ file %s...\n", path);
 
-    std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
-    std::vector<glm::vec3> temp_vertices; 
-    std::vector<glm::vec2> temp_uvs;
-    std::vector<glm::vec3> temp_normals;
-
-    FILE * file = fopen(path, "r");
+    FILE * file = fopen(path, "rb");
     if( file == nullptr ){
         printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
         getchar();
         return false;
     }
 
-    while( 1 ){
-
-        char lineHeader[128];
-        // read the first word of the line
-        int res = fscanf(file, "%s", lineHeader);
-        if (res == EOF)
-            break; // EOF = End Of File. Quit the loop.
-
-        // else : parse lineHeader
-        
-        if ( strcmp( lineHeader, "v" ) == 0 ){
-            glm::vec3 vertex;
-            fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z );
-            temp_vertices.push_back(vertex);
-        }else if ( strcmp( lineHeader, "vt" ) == 0 ){
-            glm::vec2 uv;
-            fscanf(file, "%f %f\n", &uv.x, &uv.y );
-            uv.y = -uv.y; // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders.
-            temp_uvs.push_back(uv);
-        }else if ( strcmp( lineHeader, "vn" ) == 0 ){
-            glm::vec3 normal;
-            fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z );
-            temp_normals.push_back(normal);
-        }else if ( strcmp( lineHeader, "f" ) == 0 ){
-            std::string vertex1, vertex2, vertex3;
-            unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-            int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &vertexIndex[0], &uvIndex[0], &normalIndex[0], &vertexIndex[1], &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2] );
-            if (matches != 9){
-                printf("File can't be read by our simple parser :-( Try exporting with other options\n");
-                return false;
-            }
-            vertexIndices.push_back(vertexIndex[0]);
-            vertexIndices.push_back(vertexIndex[1]);
-            vertexIndices.push_back(vertexIndex[2]);
-            uvIndices    .push_back(uvIndex[0]);
-            uvIndices    .push_back(uvIndex[1]);
-            uvIndices    .push_back(uvIndex[2]);
-            normalIndices.push_back(normalIndex[0]);
-            normalIndices.push_back(normalIndex[1]);
-            normalIndices.push_back(normalIndex[2]);
-        }else{
-            // Probably a comment, eat up the rest of the line
-            char stupidBuffer[1000];
-            fgets(stupidBuffer, 1000, file);
-        }
-
-    }
-
-    // For each vertex of each triangle
-    for( unsigned int i=0; i<vertexIndices.size(); i++ ){
-
-        // Get the indices of its attributes
-        unsigned int vertexIndex = vertexIndices[i];
-        unsigned int uvIndex = uvIndices[i];
-        unsigned int normalIndex = normalIndices[i];
-        
-        // Get the attributes thanks to the index
-        glm::vec3 vertex = temp_vertices[ vertexIndex-1 ];
-        glm::vec2 uv = temp_uvs[ uvIndex-1 ];
-        glm::vec3 normal = temp_normals[ normalIndex-1 ];
-        
-        // Put the attributes in buffers
-        out_vertices.push_back(vertex);
-        out_uvs     .push_back(uv);
-        out_normals .push_back(normal);
-    
+    // Read the whole file in one go, terminated with a newline and a 0 so the parser never needs to check for the end of a line
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (fileSize < 0) {
+        fclose(file);
+        return false;
+    }
+    std::vector<char> buffer(fileSize + 2);
+    size_t size = fread(&buffer[0], 1, fileSize, file);
+    fclose(file);
+    buffer[size] = '\n';
+    buffer[size + 1] = '\0';
+    const char* data = &buffer[0];
+    const char* end = data + size + 1;
+
+    // Split the file into chunks that start at the beginning of a line
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunkCount = std::max((size_t)1, std::min(threadCount, size / MIN_CHUNK_SIZE));
+    std::vector<Chunk> chunks(chunkCount);
+    const char* begin = data;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char* chunkEnd = i + 1 == chunkCount ? end : skipLine(std::max(begin, data + size * (i + 1) / chunkCount), end);
+        chunks[i].begin = begin;
+        chunks[i].end = chunkEnd;
+        begin = chunkEnd;
     }
 
+    forEachChunk(chunks, [&chunks](size_t i) { parseChunk(chunks[i]); });
+
+    // Merge the attribute arrays and work out where every chunk starts
+    std::vector<glm::vec3> temp_vertices;
+    std::vector<glm::vec2> temp_uvs;
+    std::vector<glm::vec3> temp_normals;
+    size_t triangleCount = 0;
+    int lineBase = 0;
+    for (size_t i = 0; i < chunkCount; i++) {
+        Chunk& chunk = chunks[i];
+        if (chunk.error) {
+            printf("File can't be read by our parser :-( Bad face statement on line %d\n", lineBase + chunk.errorLine);
+            return false;
+        }
+        lineBase += (int)std::count(chunk.begin, chunk.end, '\n');
+        chunk.vertexBase = (int)temp_vertices.size();
+        chunk.uvBase = (int)temp_uvs.size();
+        chunk.normalBase = (int)temp_normals.size();
+        chunk.firstTriangle = triangleCount;
+        triangleCount += chunk.triangleCount;
+        temp_vertices.insert(temp_vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+        temp_uvs.insert(temp_uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+        temp_normals.insert(temp_normals.end(), chunk.normals.begin(), chunk.normals.end());
+    }
+
+    // Resolve relative indices and write the triangles, every chunk into its own part of the triangle list
+    std::vector<glm::vec3> corner_vertices(triangleCount * 3);
+    std::vector<glm::vec2> corner_uvs(triangleCount * 3);
+    std::vector<glm::vec3> corner_normals(triangleCount * 3);
+    out_vertices.clear();
+    out_uvs.clear();
+    out_normals.clear();
+    out_indices.clear();
+    if (triangleCount == 0)
+        return true;
+    std::vector<char> results(chunkCount, 0);
+    forEachChunk(chunks, [&](size_t i) {
+        Chunk& chunk = chunks[i];
+        for (size_t c = 0; c < chunk.corners.size(); c++) {
+            uint8_t relative = chunk.relative[c];
+            if (relative & RELATIVE_V)
+                chunk.corners[c].v += chunk.vertexBase;
+            if (relative & RELATIVE_VT)
+                chunk.corners[c].vt += chunk.uvBase;
+            if (relative & RELATIVE_VN)
+                chunk.corners[c].vn += chunk.normalBase;
+        }
+        results[i] = emitTriangles(chunk, temp_vertices, temp_uvs, temp_normals, &corner_vertices[0], &corner_uvs[0], &corner_normals[0]);
+    });
+    for (size_t i = 0; i < chunkCount; i++) {
+        if (!results[i]) {
+            printf("File can't be read by our parser :-( A face refers to a vertex that does not exist\n");
+            return false;
+        }
+    }
+
+    // Share the corners that are exactly the same between triangles
+    weldVertices(corner_vertices, corner_uvs, corner_normals, out_vertices, out_uvs, out_normals, out_indices);
+
     return true;
 }
 
@@ -1,11 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
 
 #include <GL/glew.h>
 
+#include "TextureProcessing.h"
 
-GLuint loadBMP(const char * imagepath) {
+
+bool readBMP(const char * imagepath, unsigned int & width, unsigned int & height, std::vector<unsigned char> & data) {
 
     printf("Reading image %s\n", imagepath);
 
@@ -13,49 +16,72 @@ GLuint loadBMP(const char * imagepath) {
     unsigned char header[54];
     unsigned int dataPos;
     unsigned int imageSize;
-    unsigned int width, height;
-    // Actual RGB data
-    unsigned char * data;
 
     // Open the file
     FILE * file = fopen(imagepath, "rb");
-    if (!file) { printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath); getchar(); return 0; }
+    if (!file) { printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath); return false; }
 
     // Read the header, i.e. the 54 first bytes
 
     // If less than 54 bytes are read, problem
     if (fread(header, 1, 54, file) != 54) {
         printf("Not a correct BMP file\n");
-        return 0;
+        fclose(file);
+        return false;
     }
     // A BMP files always begins with "BM"
     if (header[0] != 'B' || header[1] != 'M') {
         printf("Not a correct BMP file\n");
-        return 0;
+        fclose(file);
+        return false;
     }
     // Make sure this is a 24bpp file
-    if (*(int*)&(header[0x1E]) != 0) { printf("Not a correct BMP file\n");    return 0; }
-    if (*(int*)&(header[0x1C]) != 24) { printf("Not a correct BMP file\n");    return 0; }
+    if (*(int*)&(header[0x1E]) != 0) { printf("Not a correct BMP file\n"); fclose(file); return false; }
+    if (*(int*)&(header[0x1C]) != 24) { printf("Not a correct BMP file\n"); fclose(file); return false; }
 
     // Read the information about the image
     dataPos = *(int*)&(header[0x0A]);
     imageSize = *(int*)&(header[0x22]);
     width = *(int*)&(header[0x12]);
-    height = *(int*)&(header[0x16]);
+    int signedHeight = *(int*)&(header[0x16]);
+    // A negative height means the rows are stored top-down
+    height = signedHeight < 0 ? -signedHeight : signedHeight;
+    unsigned int rowSize = (width * 3 + 3) & ~3u; // Every row is padded to 4 bytes
 
     // Some BMP files are misformatted, guess missing information
-    if (imageSize == 0)    imageSize = width*height * 3; // 3 : one byte for each Red, Green and Blue component
+    if (imageSize == 0)    imageSize = rowSize * height;
     if (dataPos == 0)      dataPos = 54; // The BMP header is done that way
 
-    // Create a buffer
-    data = new unsigned char[imageSize];
-
-    // Read the actual data from the file into the buffer
-    fread(data, 1, imageSize, file);
+    // Read the actual data from the file into the buffer, the pixels don't always follow the 54 byte header directly
+    data.assign(imageSize, 0);
+    fseek(file, dataPos, SEEK_SET);
+    fread(data.data(), 1, imageSize, file);
 
     // Everything is in memory now, the file wan be closed
     fclose(file);
 
+    // GL expects the bottom row first, like most BMP files have it
+    if (signedHeight < 0 && data.size() >= (size_t)rowSize * height) {
+        std::vector<unsigned char> row(rowSize);
+        for (unsigned int y = 0; y < height / 2; y++) {
+            unsigned char * top = &data[(size_t)y * rowSize];
+            unsigned char * bottom = &data[(size_t)(height - 1 - y) * rowSize];
+            memcpy(row.data(), top, rowSize);
+            memcpy(top, bottom, rowSize);
+            memcpy(bottom, row.data(), rowSize);
+        }
+    }
+    return true;
+}
+
+GLuint loadBMP(const char * imagepath) {
+    unsigned int width, height;
+    std::vector<unsigned char> data;
+    if (!TextureProcessing::LoadBMP(imagepath, width, height, data)) {
+        getchar();
+        return 0;
+    }
+
     // Create one OpenGL texture
     GLuint textureID;
     glGenTextures(1, &textureID);
@@ -63,14 +89,18 @@ GLuint loadBMP(const char * imagepath) {
     // "Bind" the newly created texture : all future texture functions will modify this texture
     glBindTexture(GL_TEXTURE_2D, textureID);
 
-    // Give the image to OpenGL
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
-
-    // OpenGL has now copied the data. Free our own version
-    delete[] data;
+    // Give the image and its gamma correct mipmaps to OpenGL
+    std::vector<std::vector<unsigned char>> levels = TextureProcessing::BuildMipChain(std::move(data), width, height, MipFilter::KAISER);
+    for (size_t level = 0; level < levels.size(); ++level)
+    {
+        glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[level].data());
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    // Trilinear filtering, the TextureSampler overrides this when sampler objects are supported
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 
     // Return the ID of the texture we just created
     return textureID;
@@ -138,16 +168,6 @@ GLuint loadDDS(const char * imagepath) {
     unsigned int fourCC = *(unsigned int*)&(header[80]);
 
 
-    unsigned char * buffer;
-    unsigned int bufsize;
-    /* how big is it going to be including all mipmaps? */
-    bufsize = mipMapCount > 1 ? linearSize * 2 : linearSize;
-    buffer = (unsigned char*)malloc(bufsize * sizeof(unsigned char));
-    fread(buffer, 1, bufsize, fp);
-    /* close the file pointer */
-    fclose(fp);
-
-    unsigned int components = (fourCC == FOURCC_DXT1) ? 3 : 4;
     unsigned int format;
     switch (fourCC)
     {
@@ -161,9 +181,26 @@ GLuint loadDDS(const char * imagepath) {
         format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
         break;
     default:
-        free(buffer);
+        fclose(fp);
         return 0;
     }
+    unsigned int blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
+
+    unsigned char * buffer;
+    unsigned int bufsize = 0;
+    /* how big is it going to be including all mipmaps? the small levels still take a whole block, so this can be more than linearSize * 2 */
+    if (mipMapCount == 0) mipMapCount = 1;
+    for (unsigned int level = 0, w = width, h = height; level < mipMapCount; ++level)
+    {
+        bufsize += ((w + 3) / 4)*((h + 3) / 4)*blockSize;
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    if (bufsize < linearSize) bufsize = linearSize;
+    buffer = (unsigned char*)calloc(bufsize, sizeof(unsigned char));
+    fread(buffer, 1, bufsize, fp);
+    /* close the file pointer */
+    fclose(fp);
 
     // Create one OpenGL texture
     GLuint textureID;
@@ -173,7 +210,6 @@ GLuint loadDDS(const char * imagepath) {
     glBindTexture(GL_TEXTURE_2D, textureID);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    unsigned int blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
     unsigned int offset = 0;
 
     /* load the mipmaps */
@@ -1,6 +1,11 @@
 #ifndef TEXTURE_HPP
 #define TEXTURE_HPP
 
+#include <vector>
+
+// Read a .BMP file into memory without touching OpenGL, safe to call from any thread
+bool readBMP(const char * imagepath, unsigned int & width, unsigned int & height, std::vector<unsigned char> & data);
+
 // Load a .BMP file using our custom loader
 GLuint loadBMP(const char * imagepath);
 
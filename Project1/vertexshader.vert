@@ -1,16 +1,60 @@
 #version 430 core
 
-// Uniform matrices
-uniform mat4 mv;
-uniform mat4 projection;
-uniform vec3 light_pos;
+const int MAX_LIGHTS = 8; // UniformBuffers::MAX_LIGHTS
 
-// Per-vertex inputs
-in vec3 position;
-in vec3 normal;
+// Per-frame data, written once per frame (UniformBuffers::FrameBlock)
+layout(std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec4 light_pos[MAX_LIGHTS];
+};
+
+// The light and material of this draw
+uniform int light_index;
+uniform int material_index;
+
+// Vertex dequantization, identity for float vertices
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+uniform vec2 uv_offset;
+uniform vec2 uv_scale;
+uniform bool oct_normals;
+
+// Per-vertex inputs, the locations match VertexAttribute in VertexFormat.h
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal; // Only xy is used when the normal is octahedral encoded
+layout(location = 2) in vec2 uv;
+
+// Per-instance inputs, constant attribute values when an object is drawn on its own
+layout(location = 3) in mat4 instance_model;
+layout(location = 7) in uint instance_layer; // The layer of the texture array
+
+// Everything above for one instance of the IndirectRenderer (IndirectRenderer.h)
+struct DrawData
+{
+    mat4 model;
+    vec4 position_offset;
+    vec4 position_scale;
+    vec4 uv_offset_scale; // The offset in xy, the scale in zw
+    uint layer;
+    int material_index;
+    int light_index;
+    uint oct_normals;
+};
+
+layout(std430, binding = 0) readonly buffer DrawDataBuffer
+{
+    DrawData draws[];
+};
+
+// If the uniforms and per-instance attributes are replaced by draws[draw_index]
+uniform bool indirect_draw;
+layout(location = 8) in uint draw_index; // Counts up from the base instance of the draw command
 
-in vec2 uv;
 out vec2 UV;
+flat out uint Layer;
+flat out int MaterialIndex;
 
 out VS_OUT
 {
@@ -19,20 +63,56 @@ out VS_OUT
    vec3 V;
 } vs_out;
 
+// Decodes a normal stored on the octahedron
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main()
 {
+    mat4 model = instance_model;
+    vec3 pos_offset = position_offset, pos_scale = position_scale;
+    vec2 tex_offset = uv_offset, tex_scale = uv_scale;
+    bool oct = oct_normals;
+    int light = light_index;
+    Layer = instance_layer;
+    MaterialIndex = material_index;
+    if (indirect_draw)
+    {
+        DrawData draw = draws[draw_index];
+        model = draw.model;
+        pos_offset = draw.position_offset.xyz;
+        pos_scale = draw.position_scale.xyz;
+        tex_offset = draw.uv_offset_scale.xy;
+        tex_scale = draw.uv_offset_scale.zw;
+        oct = draw.oct_normals != 0u;
+        light = draw.light_index;
+        Layer = draw.layer;
+        MaterialIndex = draw.material_index;
+    }
+
+    vec3 object_position = pos_offset + position * pos_scale;
+    vec3 object_normal = oct ? octDecode(normal.xy) : normal;
+
+    mat4 mv = view * model;
+
     // Calculate view-space coordinate
-    vec4 P = mv * vec4(position, 1.0);
+    vec4 P = mv * vec4(object_position, 1.0);
 
     // Calculate normal in view-space
-    vs_out.N = mat3(mv) * normal;
+    vs_out.N = mat3(mv) * object_normal;
 
     // Calculate light vector
-    vs_out.L = light_pos - P.xyz;
+    vs_out.L = light_pos[light].xyz - P.xyz;
 
     // Calculate view vector;
     vs_out.V = -P.xyz;
-    UV = uv;
+    UV = tex_offset + uv * tex_scale;
 
     // Calculate the clip-space position of each vertex
     gl_Position = projection * P;